@@ -0,0 +1,31 @@
+# Precompiles a permutation of a shader with each define of ARGN, written as "<name> <value>". The output is named
+# like the permutations generated at runtime by lop::ShaderCache, <stem>.<hash><extension>.spv, hash being the lowest
+# 32 bits of the 64-bit FNV-1a of the concatenated defines.
+function(add_shader_permutation folder_target glslc shader_folder shader_name)
+	set(hash 2216829733) # Lowest 32 bits of the FNV-1a offset basis
+	set(definitions "")
+	foreach(define ${ARGN})
+		string(HEX "${define}" bytes)
+		string(LENGTH "${bytes}" length)
+		math(EXPR last "${length} - 2")
+		foreach(offset RANGE 0 ${last} 2)
+			string(SUBSTRING "${bytes}" ${offset} 2 byte)
+			math(EXPR hash "((${hash} ^ 0x${byte}) * 435) & 0xFFFFFFFF") # Lowest 32 bits of the FNV prime
+		endforeach()
+
+		string(REPLACE " " "=" definition "${define}")
+		list(APPEND definitions "-D${definition}")
+	endforeach()
+
+	math(EXPR hash "${hash} + 0x100000000" OUTPUT_FORMAT HEXADECIMAL)
+	string(SUBSTRING "${hash}" 3 8 hash)
+	string(TOLOWER "${hash}" hash)
+
+	get_filename_component(stem ${shader_name} NAME_WLE)
+	get_filename_component(extension ${shader_name} LAST_EXT)
+	add_custom_command(TARGET ${folder_target} POST_BUILD
+	                   COMMAND ${glslc} --target-env=vulkan1.2 -O ${definitions}
+	                           -I ${shader_folder}
+	                           -o ${shader_folder}/${stem}.${hash}${extension}.spv
+	                           ${shader_folder}/${shader_name})
+endfunction()
@@ -0,0 +1,40 @@
+#ifndef LOP_MATH_LOWDISCREPANCY_HPP
+#define LOP_MATH_LOWDISCREPANCY_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace lop
+{
+    // Sobol generator matrices stored as 32 direction numbers per dimension, most significant bit first.
+    // Reference: Joe, S., & Kuo, F. Y. (2008). Constructing Sobol sequences with better two-dimensional projections.
+    constexpr uint32_t    SobolMaxDimensions = 8;
+    std::vector<uint32_t> getSobolMatrices(uint32_t dimensions);
+
+    // Tileable size x size blue noise mask, as ranks in [0, size * size), built with the void-and-cluster method.
+    // Reference: Ulichney, R. A. (1993). Void-and-cluster method for dither array generation.
+    std::vector<uint32_t> getBlueNoise(uint32_t size, uint32_t seed = 0);
+
+    // Must match lop/sampler.glsl
+    enum class SampleSequence : uint32_t
+    {
+        Pcg   = 0, // White noise
+        Sobol = 1, // Owen scrambled Sobol sequence
+        Rank1 = 2, // Rank-1 lattice rotated per pixel by blue noise
+    };
+
+    // Must match lop/sampler.glsl
+    struct SamplerTables
+    {
+        static constexpr uint32_t SobolDimensions = 4;
+        static constexpr uint32_t BlueNoiseSize   = 64;
+
+        uint32_t sobolMatrices[SobolDimensions * 32];
+        uint32_t rank1Generator[4];
+        uint32_t blueNoise[BlueNoiseSize * BlueNoiseSize]; // Rotations in 0.32 fixed point
+    };
+
+    SamplerTables getSamplerTables();
+} // namespace lop
+
+#endif // LOP_MATH_LOWDISCREPANCY_HPP
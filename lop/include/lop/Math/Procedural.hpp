@@ -0,0 +1,19 @@
+#ifndef LOP_MATH_PROCEDURAL_HPP
+#define LOP_MATH_PROCEDURAL_HPP
+
+#include <vzt/Core/Math.hpp>
+#include <vzt/Data/Mesh.hpp>
+
+namespace lop
+{
+    // Gradient sky with a sun spot around +Z
+    vzt::Vec3 proceduralSky(const vzt::Vec3 direction);
+
+    vzt::Mesh createSphere(float radius, uint32_t rings = 32, uint32_t sectors = 64);
+    vzt::Mesh createQuad(float halfSize);
+
+    // Random triangles uniformly spread in [-extent, extent]^3, reproducible from the seed
+    vzt::Mesh createTriangleSoup(uint32_t triangleNb, float extent, float triangleSize, uint32_t seed);
+} // namespace lop
+
+#endif // LOP_MATH_PROCEDURAL_HPP
@@ -1,13 +1,79 @@
 #ifndef LOP_MATH_SAMPLING_HPP
 #define LOP_MATH_SAMPLING_HPP
 
+#include <vector>
+
+#include <vzt/Core/Math.hpp>
 #include <vzt/Core/Type.hpp>
 #include <vzt/Data/Image.hpp>
 
 namespace lop
 {
-    float              getCumulativeDistributionFunctions(vzt::CSpan<float> data, vzt::Span<float> cdf);
-    std::vector<float> getCumulativeDistributionFunctions(const Image<float>& pixels);
+    // Normalized cdf of data in [1, data.size], preceded by 0 and followed by the mean of data, which is returned.
+    // A null function gets the cdf of a uniform distribution.
+    float getCumulativeDistributionFunctions(vzt::CSpan<float> data, vzt::Span<float> cdf);
+
+    // Per row cdfs of the first pixels.width * pixels.height values, each with the layout above, followed by the cdf
+    // of their means. Rows are processed across threadCount threads, or every hardware thread when 0.
+    std::vector<float> getCumulativeDistributionFunctions(const Image<float>& pixels, uint32_t threadCount = 0);
+
+    // Piecewise-constant distribution over [0, 1) of a non-negative function, whose densities are read from the cdf.
+    // Samples locate their segment through a guide table, which bounds the binary search to a few entries for smooth
+    // functions.
+    // Reference: Chen, H.-C., & Asau, Y. (1974). On generating random variates from an empirical distribution.
+    class Distribution1D
+    {
+      public:
+        Distribution1D() = default;
+        Distribution1D(vzt::CSpan<float> function);
+
+        // Continuous sample in [0, 1), offset is the index of its segment
+        float    sample(float u, float& pdf, uint32_t* offset = nullptr) const;
+        uint32_t sampleDiscrete(float u, float& probability) const;
+
+        inline float getPdf(float x) const;
+        inline float getProbability(uint32_t offset) const;
+
+        inline uint32_t getSize() const;
+        inline float    getIntegral() const;
+
+        // Layout of getCumulativeDistributionFunctions, suited for an upload to the device
+        inline vzt::CSpan<float> getCdf() const;
+
+        // Last segment whose cdf lower bound is lower or equal to u, in [0, 1)
+        uint32_t find(float u) const;
+        // Same result with a binary search over the whole cdf, without the guide table
+        uint32_t findBinary(float u) const;
+
+      private:
+        std::vector<float>    m_cdf;
+        std::vector<uint32_t> m_guide;
+    };
+
+    // Piecewise-constant distribution over [0, 1)^2 of a non-negative function, sampled by its marginal over rows then
+    // by the conditional distribution of the selected row
+    class Distribution2D
+    {
+      public:
+        Distribution2D() = default;
+
+        // Row major function of width * height values, rows are built across threadCount threads, or every hardware
+        // thread when 0.
+        Distribution2D(vzt::CSpan<float> function, uint32_t width, uint32_t height, uint32_t threadCount = 0);
+
+        vzt::Vec2    sample(vzt::Vec2 u, float& pdf) const;
+        inline float getPdf(vzt::Vec2 uv) const;
+
+        inline float                 getIntegral() const;
+        inline const Distribution1D& getMarginal() const;
+        inline const Distribution1D& getConditional(uint32_t row) const;
+
+      private:
+        std::vector<Distribution1D> m_conditionals;
+        Distribution1D              m_marginal;
+    };
 } // namespace lop
 
+#include "lop/Math/Sampling.inl"
+
 #endif // LOP_MATH_SAMPLING_HPP
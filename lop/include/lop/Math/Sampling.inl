@@ -0,0 +1,36 @@
+#include "lop/Math/Sampling.hpp"
+
+#include <algorithm>
+
+namespace lop
+{
+    inline float Distribution1D::getPdf(float x) const
+    {
+        const uint32_t offset = std::min(static_cast<uint32_t>(x * static_cast<float>(getSize())), getSize() - 1);
+        return getProbability(offset) * static_cast<float>(getSize());
+    }
+
+    inline float Distribution1D::getProbability(uint32_t offset) const
+    {
+        return m_cdf[offset + 1] - m_cdf[offset];
+    }
+
+    inline uint32_t Distribution1D::getSize() const { return static_cast<uint32_t>(m_guide.size()) - 1; }
+
+    inline float Distribution1D::getIntegral() const { return m_cdf.back(); }
+
+    inline vzt::CSpan<float> Distribution1D::getCdf() const { return m_cdf; }
+
+    inline float Distribution2D::getPdf(vzt::Vec2 uv) const
+    {
+        const uint32_t row =
+            std::min(static_cast<uint32_t>(uv.y * static_cast<float>(m_marginal.getSize())), m_marginal.getSize() - 1);
+        return m_conditionals[row].getPdf(uv.x) * m_marginal.getPdf(uv.y);
+    }
+
+    inline float Distribution2D::getIntegral() const { return m_marginal.getIntegral(); }
+
+    inline const Distribution1D& Distribution2D::getMarginal() const { return m_marginal; }
+
+    inline const Distribution1D& Distribution2D::getConditional(uint32_t row) const { return m_conditionals[row]; }
+} // namespace lop
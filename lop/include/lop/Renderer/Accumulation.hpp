@@ -0,0 +1,74 @@
+#ifndef LOP_RENDERER_ACCUMULATION_HPP
+#define LOP_RENDERER_ACCUMULATION_HPP
+
+#include <optional>
+#include <vector>
+
+#include <vzt/Core/File.hpp>
+#include <vzt/Data/Image.hpp>
+
+namespace lop
+{
+    // Samples [firstSample, firstSample + sampleNb) of the sequence of a seed, see HardwarePathTracingPass::Properties
+    struct SampleRange
+    {
+        uint32_t seed        = 0;
+        uint32_t firstSample = 0;
+        uint32_t sampleNb    = 0;
+
+        inline uint32_t getEnd() const;
+        inline bool     overlaps(const SampleRange& other) const;
+    };
+
+    // RGBA radiance sums of an image in unsigned 40.24 fixed point, as accumulated by HardwarePathTracingPass with raw
+    // accumulation enabled. Sums of disjoint sample ranges are merged by integer additions: whatever their order and
+    // the processes which traced them, the result is bit-exact with a single trace of every range.
+    class RawAccumulation
+    {
+      public:
+        // Must match shaders/base.rgen. Samples are clamped to 65535, 2^24 of them fit in the sums.
+        static constexpr double SumScale = 16777216.;
+
+        RawAccumulation() = default;
+        // Without any sample
+        RawAccumulation(uint32_t width, uint32_t height);
+        // RGBA sums of the disjoint ranges, row-major
+        RawAccumulation(uint32_t width, uint32_t height, SampleRange range, std::vector<uint64_t> sums);
+        RawAccumulation(uint32_t width, uint32_t height, std::vector<SampleRange> ranges, std::vector<uint64_t> sums);
+
+        // Sums read back from the images of the pass, see HardwarePathTracingPass::getSumLowImage
+        static RawAccumulation fromWords(const Image<uint32_t>& low, const Image<uint32_t>& high, SampleRange range);
+
+        // Adds the samples of other, false and left untouched when its size or scene differs, or when it shares samples
+        bool merge(const RawAccumulation& other);
+
+        // Identifies the scene and camera the samples were traced with, 0 when unknown. Accumulations of different
+        // scenes are never merged.
+        inline void     setSceneHash(uint64_t hash);
+        inline uint64_t getSceneHash() const;
+
+        inline uint32_t                        getWidth() const;
+        inline uint32_t                        getHeight() const;
+        inline const std::vector<uint64_t>&    getSums() const;
+        inline const std::vector<SampleRange>& getRanges() const; // Sorted, adjacent ranges being joined
+        uint32_t                               getSampleNb() const;
+
+        // Mean radiance of every sample
+        Image<float> getAverage() const;
+
+      private:
+        uint32_t                 m_width     = 0;
+        uint32_t                 m_height    = 0;
+        uint64_t                 m_sceneHash = 0;
+        std::vector<SampleRange> m_ranges;
+        std::vector<uint64_t>    m_sums;
+    };
+
+    // Binary file of the sums, their ranges and scene hash, in the byte order of the host
+    bool                           writeRawAccumulation(const vzt::Path& path, const RawAccumulation& accumulation);
+    std::optional<RawAccumulation> readRawAccumulation(const vzt::Path& path);
+} // namespace lop
+
+#include "lop/Renderer/Accumulation.inl"
+
+#endif // LOP_RENDERER_ACCUMULATION_HPP
@@ -0,0 +1,19 @@
+#include "lop/Renderer/Accumulation.hpp"
+
+namespace lop
+{
+    inline uint32_t SampleRange::getEnd() const { return firstSample + sampleNb; }
+
+    inline bool SampleRange::overlaps(const SampleRange& other) const
+    {
+        return seed == other.seed && firstSample < other.getEnd() && other.firstSample < getEnd();
+    }
+
+    inline uint32_t                        RawAccumulation::getWidth() const { return m_width; }
+    inline uint32_t                        RawAccumulation::getHeight() const { return m_height; }
+    inline const std::vector<uint64_t>&    RawAccumulation::getSums() const { return m_sums; }
+    inline const std::vector<SampleRange>& RawAccumulation::getRanges() const { return m_ranges; }
+
+    inline void     RawAccumulation::setSceneHash(uint64_t hash) { m_sceneHash = hash; }
+    inline uint64_t RawAccumulation::getSceneHash() const { return m_sceneHash; }
+} // namespace lop
@@ -0,0 +1,110 @@
+#ifndef LOP_RENDERER_BUFFERPOOL_HPP
+#define LOP_RENDERER_BUFFERPOOL_HPP
+
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include <vzt/Vulkan/Buffer.hpp>
+
+#include "lop/System/RangeAllocator.hpp"
+
+namespace lop
+{
+    struct BufferAllocation
+    {
+        static constexpr uint32_t NoBlock = ~0u;
+
+        uint32_t block = NoBlock;
+        Range    range = {};
+
+        inline bool isValid() const;
+    };
+
+    // Suballocates ranges of a few large buffers, which are created on demand, instead of creating a device allocation
+    // per resource. Ranges are placed by a RangeAllocator in each block, requests larger than the block size get a
+    // dedicated block. Offsets are multiples of the alignment, which must be a power of two.
+    class BufferPool
+    {
+      public:
+        static constexpr uint64_t DefaultBlockSize = uint64_t(16) << 20;
+        static constexpr uint64_t DefaultAlignment = 256; // Above minStorageBufferOffsetAlignment of every device
+
+        // Blocks of mappable pools stay mapped for their whole lifetime
+        BufferPool(vzt::View<vzt::Device> device, vzt::BufferUsage usage, bool mappable,
+                   uint64_t blockSize = DefaultBlockSize, uint64_t alignment = DefaultAlignment);
+
+        BufferPool(const BufferPool&)            = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+
+        BufferPool(BufferPool&&) noexcept            = default;
+        BufferPool& operator=(BufferPool&&) noexcept = default;
+
+        ~BufferPool();
+
+        BufferAllocation allocate(uint64_t size);
+        void             release(BufferAllocation& allocation);
+
+        // Allocate and fill a range of a mappable pool
+        template <class Type>
+        BufferAllocation upload(vzt::CSpan<Type> data);
+
+        // Destroy every block holding no allocation, except the first one which is kept for the next requests
+        void trim();
+
+        // Moves each allocation to a free range of a lower block, if any fits, so that trim can release the blocks left
+        // empty. The data is copied by the host, mappable pools only. Frames in flight may still read the previous
+        // ranges: they are appended to retired instead of being released. Returns the number of moved allocations.
+        uint32_t defragment(std::initializer_list<BufferAllocation*> allocations,
+                            std::vector<BufferAllocation>&          retired);
+
+        inline vzt::BufferCSpan getSpan(const BufferAllocation& allocation) const;
+        inline uint64_t         getDeviceAddress(const BufferAllocation& allocation) const;
+        inline uint8_t*         getData(const BufferAllocation& allocation) const;
+
+        // Device allocations currently held by the pool, and the use of their ranges
+        inline uint32_t getBlockNb() const;
+        RangeStatistics getStatistics() const;
+
+      private:
+        struct Block
+        {
+            vzt::Buffer    buffer;
+            RangeAllocator allocator;
+            uint8_t*       data = nullptr;
+        };
+
+        // Searches the blocks [0, blockEnd) without creating any
+        BufferAllocation allocateExisting(uint64_t size, std::size_t blockEnd);
+
+        vzt::View<vzt::Device> m_device;
+        vzt::BufferUsage       m_usage;
+        bool                   m_mappable;
+        uint64_t               m_blockSize;
+        uint64_t               m_alignment;
+
+        // Released blocks leave an empty slot so that the block index of live allocations stays valid
+        std::vector<std::unique_ptr<Block>> m_blocks;
+    };
+
+    // Device scratch memory of acceleration structure builds. Builds are waited for one after the other and each one
+    // uses the whole buffer from its start, so that sharing it is a linear allocator reset after every build. Grows
+    // geometrically to the largest build and is never shrunk, a scene growing by small edits only reallocates it a
+    // few times.
+    class ScratchBuffer
+    {
+      public:
+        ScratchBuffer(vzt::View<vzt::Device> device);
+
+        const vzt::Buffer& get(uint64_t size);
+        inline uint64_t    getSize() const;
+
+      private:
+        vzt::View<vzt::Device> m_device;
+        vzt::Buffer            m_buffer;
+    };
+} // namespace lop
+
+#include "lop/Renderer/BufferPool.inl"
+
+#endif // LOP_RENDERER_BUFFERPOOL_HPP
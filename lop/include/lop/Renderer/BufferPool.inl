@@ -0,0 +1,44 @@
+#include "lop/Renderer/BufferPool.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace lop
+{
+    inline bool BufferAllocation::isValid() const { return block != NoBlock && range.isValid(); }
+
+    template <class Type>
+    BufferAllocation BufferPool::upload(vzt::CSpan<Type> data)
+    {
+        assert(m_mappable && "Only mappable pools can be written by the host");
+
+        BufferAllocation allocation = allocate(sizeof(Type) * data.size);
+        std::memcpy(getData(allocation), data.data, sizeof(Type) * data.size);
+        return allocation;
+    }
+
+    inline vzt::BufferCSpan BufferPool::getSpan(const BufferAllocation& allocation) const
+    {
+        return vzt::BufferCSpan{m_blocks[allocation.block]->buffer, allocation.range.size, allocation.range.offset};
+    }
+
+    inline uint64_t BufferPool::getDeviceAddress(const BufferAllocation& allocation) const
+    {
+        return m_blocks[allocation.block]->buffer.getDeviceAddress() + allocation.range.offset;
+    }
+
+    inline uint8_t* BufferPool::getData(const BufferAllocation& allocation) const
+    {
+        return m_blocks[allocation.block]->data + allocation.range.offset;
+    }
+
+    inline uint32_t BufferPool::getBlockNb() const
+    {
+        uint32_t blockNb = 0;
+        for (const std::unique_ptr<Block>& block : m_blocks)
+            blockNb += block != nullptr;
+        return blockNb;
+    }
+
+    inline uint64_t ScratchBuffer::getSize() const { return m_buffer.size(); }
+} // namespace lop
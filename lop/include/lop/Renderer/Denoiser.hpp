@@ -0,0 +1,25 @@
+#ifndef LOP_RENDERER_DENOISER_HPP
+#define LOP_RENDERER_DENOISER_HPP
+
+#include <vzt/Data/Image.hpp>
+
+namespace lop
+{
+    // Must match shaders/denoise.comp
+    struct DenoiserSettings
+    {
+        uint32_t iterations = 5;     // Filter footprint doubles at each iteration
+        float    colorPhi   = 0.5f;  // Relative luminance tolerance, halved at each iteration
+        float    normalPhi  = 64.f;  // Exponent of the normal similarity
+        float    depthPhi   = 0.05f; // Relative depth tolerance per pixel of distance
+    };
+
+    // Edge-avoiding a-trous wavelet filter applied to the albedo-demodulated radiance, guided by first hit normals and
+    // depth, on the CPU. Rows are split across threadCount threads, or every hardware thread when 0.
+    // Reference: Dammertz, H., Sewtz, D., Hanika, J., & Lensch, H. P. A. (2010). Edge-avoiding A-Trous wavelet
+    // transform for fast global illumination filtering. High Performance Graphics.
+    Image<float> denoise(const Image<float>& color, const Image<float>& albedo, const Image<float>& normal,
+                         const DenoiserSettings& settings = {}, uint32_t threadCount = 0);
+} // namespace lop
+
+#endif // LOP_RENDERER_DENOISER_HPP
@@ -1,10 +1,19 @@
 #ifndef LOP_RENDERER_GEOMETRY_HPP
 #define LOP_RENDERER_GEOMETRY_HPP
 
+#include <memory>
+#include <memory_resource>
+#include <utility>
+#include <vector>
+
 #include <vzt/Core/Math.hpp>
 #include <vzt/Vulkan/AccelerationStructure.hpp>
 #include <vzt/Vulkan/Buffer.hpp>
 
+#include "lop/Renderer/BufferPool.hpp"
+#include "lop/Renderer/LightTree.hpp"
+#include "lop/System/Arena.hpp"
+
 namespace vzt
 {
     struct Mesh;
@@ -12,6 +21,7 @@ namespace vzt
 
 namespace lop
 {
+    class RenderScene;
     struct System;
 
     struct VertexInput
@@ -21,10 +31,15 @@ namespace lop
         vzt::Vec2 pad;
     };
 
+    // Must match shaders/lop/object.glsl
     struct ObjectDescription
     {
         uint64_t vertexBuffer;
         uint64_t indexBuffer;
+        uint32_t lightOffset; // Index of the first triangle in the light list, NoLight if the object is not a light
+        uint32_t pad;
+
+        static constexpr uint32_t NoLight = ~0u;
     };
 
     struct Material
@@ -51,7 +66,11 @@ namespace lop
 
     struct MeshHolder
     {
-        MeshHolder(vzt::View<vzt::Device> device, const vzt::Mesh& mesh);
+        // Vertex data is staged in scratch memory. The bottom level structure is built in the build scratch buffer, if
+        // given, see MeshHandler::getBuildScratch, otherwise in a buffer of its own.
+        MeshHolder(vzt::View<vzt::Device> device, const vzt::Mesh& mesh,
+                   std::pmr::memory_resource* scratch = std::pmr::get_default_resource(),
+                   ScratchBuffer*             buildScratch = nullptr);
         ~MeshHolder() = default;
 
         inline const vzt::AccelerationStructure& getAccelerationStructure() const;
@@ -59,30 +78,132 @@ namespace lop
         vzt::Buffer vertexBuffer;
         vzt::Buffer indexBuffer;
 
+        // Host copy of the geometry, to build the light list of emissive objects
+        std::vector<vzt::Vec3> positions;
+        std::vector<uint32_t>  indices;
+
         vzt::AccelerationStructure accelerationStructure;
     };
 
+    // Material features used by at least one object of the scene
+    struct MaterialFeatures
+    {
+        bool transmission = false;
+        bool clearcoat    = false;
+    };
+
+    // Device memory held by a MeshHandler, and host memory of its last update
+    struct GeometryMemoryStatistics
+    {
+        // Blocks of the pool and scratch buffer, plus the buffers and structures of the meshes and the top level
+        // structure assuming one allocation each, vzt owning their memory. Images and buffers of the passes are not
+        // included.
+        uint32_t estimatedAllocationNb = 0;
+
+        uint64_t        scratchSize      = 0;
+        RangeStatistics pool             = {}; // Buffers rebuilt by each update
+        ArenaStatistics arena            = {};
+        uint64_t        heapAllocationNb = 0; // Of the whole process during the last update, vzt included
+    };
+
     struct MeshHandler
     {
       public:
-        MeshHandler(vzt::View<vzt::Device> device, System& system);
-        ~MeshHandler() = default;
+        // One segment per bit of the instance mask
+        static constexpr uint32_t MaxMotionSegmentNb = 8;
 
+        // frameInFlightNb is the number of frames the device may still be executing when a new one starts, 0 when each
+        // submission is waited for. Resources replaced by an update are only destroyed once as many frames started.
+        MeshHandler(vzt::View<vzt::Device> device, System& system, uint32_t frameInFlightNb = 0);
+        ~MeshHandler();
+
+        // Rebuilds the device data of the parts of the scene modified since the previous update
         void update();
 
+        // To be called at the start of each frame, releases the resources no frame in flight can still read
+        void nextFrame();
+
+        // Packed instances of the registry, to be read by host side consumers as well
+        inline const RenderScene& getScene() const;
+
         inline const vzt::AccelerationStructure& getAccelerationStructure() const;
-        inline const vzt::Buffer&                getDescriptions() const;
-        inline const vzt::Buffer&                getMaterials() const;
+        inline vzt::BufferCSpan                  getDescriptions() const;
+        inline vzt::BufferCSpan                  getMaterials() const;
+        inline MaterialFeatures                  getMaterialFeatures() const;
 
-      private:
-        vzt::View<vzt::Device> m_device;
-        System*                m_system;
+        // Moving instances are duplicated at the middle of each segment of the shutter interval, each copy being only
+        // visible to the rays of its segment through the instance mask. 1 disables motion blur.
+        void            setMotionBlur(uint32_t segmentNb);
+        inline uint32_t getMotionBlur() const;
+
+        // Segments of the top level structure, 1 when motion blur is disabled or when no instance moves
+        inline uint32_t getMotionSegmentNb() const;
 
-        vzt::Buffer                m_objectDescriptionBuffer;
-        vzt::Buffer                m_materials;
-        vzt::Buffer                m_instances;
+        // Every triangle of the static emissive objects, selected through the nodes and bit trails of a LightTree.
+        // Moving emitters are left out and only reached by BSDF sampling. Buffers hold a single unused element when the
+        // scene has no light.
+        inline vzt::BufferCSpan getLights() const;
+        inline vzt::BufferCSpan getLightTree() const;
+        inline vzt::BufferCSpan getLightBitTrails() const;
+        inline uint32_t         getLightCount() const;
+
+        GeometryMemoryStatistics getMemoryStatistics() const;
+
+        // Device scratch memory of the acceleration structure builds, shared with the meshes, see MeshHolder
+        inline ScratchBuffer& getBuildScratch();
+
+      private:
+        // Whether the instance is duplicated per segment of the shutter interval
+        bool isMoving(uint32_t instance) const;
+
+        void updateInstances();
+        void updateMaterials();
+        void updateDescriptions();
+        void updateLights(vzt::CSpan<EmissiveTriangle> lights);
+
+        // Releases the resources retired at least frameInFlightNb frames ago
+        void releaseRetired();
+
+        // Replace an allocation of the pool, the previous range is retired until no frame in flight can read it
+        template <class Type>
+        void upload(BufferAllocation& allocation, vzt::CSpan<Type> data);
+
+        vzt::View<vzt::Device>       m_device;
+        System*                      m_system;
+        std::unique_ptr<RenderScene> m_scene;
+
+        // Holds the temporary vectors of each update, so that steady-state edits make no heap allocation
+        Arena           m_arena;
+        ArenaStatistics m_arenaStatistics;
+        uint64_t        m_heapAllocationNb = 0;
+
+        // Host visible ranges rewritten by each update. Frames in flight may still read the replaced ones and the top
+        // level structure, both are kept along with the frame at which they were retired.
+        uint32_t                                                     m_frameInFlightNb;
+        uint64_t                                                     m_frame = 0;
+        BufferPool                                                   m_pool;
+        std::vector<std::pair<BufferAllocation, uint64_t>>           m_retired;
+        std::vector<std::pair<vzt::AccelerationStructure, uint64_t>> m_retiredStructures;
+
+        BufferAllocation           m_objectDescriptionBuffer;
+        BufferAllocation           m_materials;
+        BufferAllocation           m_instances;
         vzt::AccelerationStructure m_accelerationStructure;
+        ScratchBuffer              m_scratchBuffer;
         uint32_t                   m_scratchBufferAlignment;
+        MaterialFeatures           m_materialFeatures;
+        uint32_t                   m_motionBlur      = 1;
+        uint32_t                   m_motionSegmentNb = 1;
+        bool                       m_motionOutdated  = false;
+
+        // The tree is only rebuilt when emitters move or change, a change of emission alone refits it
+        std::vector<EmissiveTriangle> m_lightList;
+        LightTree                     m_lightTree;
+
+        BufferAllocation m_lights;
+        BufferAllocation m_lightTreeNodes;
+        BufferAllocation m_lightBitTrails;
+        uint32_t         m_lightCount = 0;
     };
 } // namespace lop
 
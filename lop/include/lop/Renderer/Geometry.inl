@@ -12,6 +12,24 @@ namespace lop
         return m_accelerationStructure;
     }
 
-    inline const vzt::Buffer& MeshHandler::getDescriptions() const { return m_objectDescriptionBuffer; }
-    inline const vzt::Buffer& MeshHandler::getMaterials() const { return m_materials; }
+    inline const RenderScene& MeshHandler::getScene() const { return *m_scene; }
+
+    inline vzt::BufferCSpan MeshHandler::getDescriptions() const { return m_pool.getSpan(m_objectDescriptionBuffer); }
+    inline vzt::BufferCSpan MeshHandler::getMaterials() const { return m_pool.getSpan(m_materials); }
+    inline MaterialFeatures MeshHandler::getMaterialFeatures() const { return m_materialFeatures; }
+    inline uint32_t         MeshHandler::getMotionBlur() const { return m_motionBlur; }
+    inline uint32_t         MeshHandler::getMotionSegmentNb() const { return m_motionSegmentNb; }
+    inline vzt::BufferCSpan MeshHandler::getLights() const { return m_pool.getSpan(m_lights); }
+    inline vzt::BufferCSpan MeshHandler::getLightTree() const { return m_pool.getSpan(m_lightTreeNodes); }
+    inline vzt::BufferCSpan MeshHandler::getLightBitTrails() const { return m_pool.getSpan(m_lightBitTrails); }
+    inline uint32_t         MeshHandler::getLightCount() const { return m_lightCount; }
+    inline ScratchBuffer&   MeshHandler::getBuildScratch() { return m_scratchBuffer; }
+
+    template <class Type>
+    void MeshHandler::upload(BufferAllocation& allocation, vzt::CSpan<Type> data)
+    {
+        if (allocation.isValid())
+            m_retired.emplace_back(allocation, m_frame);
+        allocation = m_pool.upload(data);
+    }
 } // namespace lop
@@ -0,0 +1,68 @@
+#ifndef LOP_RENDERER_GPUPROFILER_HPP
+#define LOP_RENDERER_GPUPROFILER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vzt/Core/Type.hpp>
+#include <vzt/Vulkan/Command.hpp>
+
+namespace vzt
+{
+    class Device;
+}
+
+namespace lop
+{
+    // Timestamp queries written in the frame command buffers. Results of a frame are read back the next time its
+    // image id is recorded, when its fence already guarantees completion, and forwarded to the global Profiler.
+    class GpuProfiler
+    {
+      public:
+        class Scope
+        {
+          public:
+            Scope(GpuProfiler& profiler, uint32_t imageId, vzt::CommandBuffer& commands, std::string_view name);
+            ~Scope();
+
+            Scope(const Scope&)            = delete;
+            Scope& operator=(const Scope&) = delete;
+
+          private:
+            GpuProfiler*        m_profiler;
+            vzt::CommandBuffer* m_commands;
+            uint32_t            m_query;
+        };
+
+        GpuProfiler(vzt::View<vzt::Device> device, uint32_t imageNb, uint32_t maxScopes = 16);
+
+        GpuProfiler(const GpuProfiler&)            = delete;
+        GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+        ~GpuProfiler();
+
+        // Must be called before any scope of the frame
+        void begin(uint32_t imageId, vzt::CommandBuffer& commands);
+
+        inline Scope scope(uint32_t imageId, vzt::CommandBuffer& commands, std::string_view name);
+
+      private:
+        uint32_t start(uint32_t imageId, vzt::CommandBuffer& commands, std::string_view name);
+        void     end(vzt::CommandBuffer& commands, uint32_t query);
+
+        vzt::View<vzt::Device> m_device;
+        uint32_t               m_imageNb;
+        uint32_t               m_maxScopes;
+        float                  m_timestampPeriod; // Nanoseconds per tick
+        bool                   m_enabled;
+
+        VkQueryPool                           m_queryPool = VK_NULL_HANDLE;
+        std::vector<std::vector<std::string>> m_scopes;
+        std::vector<uint64_t>                 m_results;
+    };
+} // namespace lop
+
+#include "lop/Renderer/GpuProfiler.inl"
+
+#endif // LOP_RENDERER_GPUPROFILER_HPP
@@ -0,0 +1,9 @@
+#include "lop/Renderer/GpuProfiler.hpp"
+
+namespace lop
+{
+    inline GpuProfiler::Scope GpuProfiler::scope(uint32_t imageId, vzt::CommandBuffer& commands, std::string_view name)
+    {
+        return Scope(*this, imageId, commands, name);
+    }
+} // namespace lop
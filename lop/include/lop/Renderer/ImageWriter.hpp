@@ -0,0 +1,73 @@
+#ifndef LOP_RENDERER_IMAGEWRITER_HPP
+#define LOP_RENDERER_IMAGEWRITER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "lop/Renderer/Accumulation.hpp"
+#include "lop/Renderer/Snapshot.hpp"
+
+namespace lop
+{
+    // Encodes and writes images on a background thread, in submission order, so that the next frame is traced
+    // meanwhile. At most maxPendingNb images wait in memory: a producer outpacing the disk blocks until one is written.
+    // Files are written next to their path then renamed, an interrupted process never leaves a truncated one behind.
+    class AsyncImageWriter
+    {
+      public:
+        AsyncImageWriter(std::size_t maxPendingNb = 4);
+
+        AsyncImageWriter(const AsyncImageWriter&)            = delete;
+        AsyncImageWriter& operator=(const AsyncImageWriter&) = delete;
+
+        // Writes every pending image
+        ~AsyncImageWriter();
+
+        void writePng(vzt::Path path, Image<uint8_t> image);
+        void writeExr(vzt::Path path, uint32_t width, uint32_t height, std::vector<ExrChannel> channels);
+        void writeRawAccumulation(vzt::Path path, RawAccumulation accumulation);
+
+        // Removes the file once every image submitted before is written. The file is kept when the last of them failed
+        // to be written, such as the checkpoint of a frame that could not be saved.
+        void remove(vzt::Path path);
+
+        // Blocks until every submitted image is written
+        void wait();
+
+        inline uint32_t getWrittenNb() const;
+        inline uint32_t getFailureNb() const;
+
+      private:
+        struct Task
+        {
+            vzt::Path                             path;
+            std::function<bool(const vzt::Path&)> write; // Empty for removals
+        };
+
+        void push(vzt::Path path, std::function<bool(const vzt::Path&)> write);
+        void run();
+
+        std::size_t m_maxPendingNb;
+
+        std::mutex              m_mutex;
+        std::condition_variable m_pushed;
+        std::condition_variable m_popped;
+        std::deque<Task>        m_tasks;
+        bool                    m_writing  = false;
+        bool                    m_stopping = false;
+
+        std::atomic<uint32_t> m_writtenNb{0};
+        std::atomic<uint32_t> m_failureNb{0};
+
+        // Started last, once every other member is initialized
+        std::thread m_thread;
+    };
+} // namespace lop
+
+#include "lop/Renderer/ImageWriter.inl"
+
+#endif // LOP_RENDERER_IMAGEWRITER_HPP
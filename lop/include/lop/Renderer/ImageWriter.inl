@@ -0,0 +1,7 @@
+#include "lop/Renderer/ImageWriter.hpp"
+
+namespace lop
+{
+    inline uint32_t AsyncImageWriter::getWrittenNb() const { return m_writtenNb.load(); }
+    inline uint32_t AsyncImageWriter::getFailureNb() const { return m_failureNb.load(); }
+} // namespace lop
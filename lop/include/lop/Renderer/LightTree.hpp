@@ -0,0 +1,88 @@
+#ifndef LOP_RENDERER_LIGHTTREE_HPP
+#define LOP_RENDERER_LIGHTTREE_HPP
+
+#include <memory_resource>
+#include <vector>
+
+#include <vzt/Core/Math.hpp>
+#include <vzt/Core/Type.hpp>
+
+namespace lop
+{
+    // World space emissive triangle, must match shaders/lop/light.glsl
+    struct EmissiveTriangle
+    {
+        vzt::Vec3 p0;
+        float     area;
+        vzt::Vec3 p1;
+        float     pad0;
+        vzt::Vec3 p2;
+        float     pad1;
+        vzt::Vec3 emission;
+        float     pad2;
+
+        // Emitted luminance over the whole surface, up to a constant factor
+        inline float getPower() const;
+    };
+
+    // Must match shaders/lop/light.glsl
+    struct LightTreeNode
+    {
+        vzt::Vec3 min;
+        float     power;
+        vzt::Vec3 max;
+        float     cosTheta; // Bounding cone of the emitters' normals, -1 when it spans the whole sphere
+        vzt::Vec3 axis;
+        uint32_t  childOrLight; // Second child of an interior node, whose first child directly follows it
+        uint32_t  leaf;         // childOrLight is then the index of the light
+        uint32_t  pad0;
+        uint32_t  pad1;
+        uint32_t  pad2;
+    };
+
+    // Bounding volume hierarchy over emitters, each node bounding the position, the normals and the power of its
+    // lights. Lights are selected by traversing the tree from the root, each child being picked proportionally to an
+    // upper bound of its contribution to the shading point. Emitters are two-sided and diffuse.
+    // Reference: Importance Sampling of Many Lights with Adaptive Tree Splitting, Conty Estevez & Kulla, 2018
+    //            Physically Based Rendering, fourth edition, Section 12.6.3
+    class LightTree
+    {
+      public:
+        static constexpr uint32_t NoLight = ~0u;
+
+        LightTree() = default;
+
+        // Splits are chosen from the surface area orientation heuristic, build data is allocated from scratch
+        void build(vzt::CSpan<EmissiveTriangle> lights,
+                   std::pmr::memory_resource*   scratch = std::pmr::get_default_resource());
+
+        // Updates the power of every node without changing the hierarchy, the lights must only differ from the ones
+        // of the last build by their emission. The tree may be less efficient than a new build but stays unbiased.
+        void refit(vzt::CSpan<EmissiveTriangle> lights);
+
+        // Index of the selected light, NoLight if no light may contribute to the shading point
+        uint32_t sample(vzt::Vec3 p, vzt::Vec3 n, float u, float& probability) const;
+        float    getProbability(vzt::Vec3 p, vzt::Vec3 n, uint32_t lightId) const;
+
+        inline vzt::CSpan<LightTreeNode> getNodes() const;
+
+        // Per light branches from the root to its leaf, the bit i being set when the second child is taken at depth i
+        inline vzt::CSpan<uint64_t> getBitTrails() const;
+
+      private:
+        struct BuildLight;
+        uint32_t build(std::pmr::vector<BuildLight>& lights, std::size_t start, std::size_t end,
+                       uint64_t bitTrail, uint32_t depth);
+
+        std::vector<LightTreeNode> m_nodes;
+        std::vector<uint64_t>      m_bitTrails;
+    };
+
+    // Upper bound of the contribution of the lights of a node to a shading point of normal n, to be compared with the
+    // importance of its sibling
+    float getImportance(const LightTreeNode& node, vzt::Vec3 p, vzt::Vec3 n);
+} // namespace lop
+
+#include "lop/Renderer/LightTree.inl"
+
+#endif // LOP_RENDERER_LIGHTTREE_HPP
@@ -0,0 +1,11 @@
+#include "lop/Renderer/LightTree.hpp"
+
+#include "lop/Math/Color.hpp"
+
+namespace lop
+{
+    inline float EmissiveTriangle::getPower() const { return getLuminance(emission) * area; }
+
+    inline vzt::CSpan<LightTreeNode> LightTree::getNodes() const { return m_nodes; }
+    inline vzt::CSpan<uint64_t>      LightTree::getBitTrails() const { return m_bitTrails; }
+} // namespace lop
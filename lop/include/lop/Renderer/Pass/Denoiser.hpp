@@ -0,0 +1,91 @@
+#ifndef LOP_RENDERER_PASS_DENOISER_HPP
+#define LOP_RENDERER_PASS_DENOISER_HPP
+
+#include <array>
+#include <vector>
+
+#include <vzt/Vulkan/Buffer.hpp>
+#include <vzt/Vulkan/Command.hpp>
+#include <vzt/Vulkan/Pipeline/ComputePipeline.hpp>
+#include <vzt/Vulkan/Program.hpp>
+
+#include "lop/Renderer/Denoiser.hpp"
+#include "lop/Renderer/ShaderCache.hpp"
+
+namespace lop
+{
+    class GpuProfiler;
+    class HardwarePathTracingPass;
+
+    // Filters the accumulated radiance of a path tracing pass into an output image, guided by its albedo and normal
+    // AOVs which must be enabled. Recorded between HardwarePathTracingPass::trace and TonemapPass::record.
+    class DenoiserPass
+    {
+      public:
+        static constexpr uint32_t MaxIterations = 8;
+
+        DenoiserPass(vzt::View<vzt::Device> device, uint32_t imageNb, vzt::Extent2D extent,
+                     vzt::View<HardwarePathTracingPass> pathtracing);
+
+        DenoiserPass(const DenoiserPass&)            = delete;
+        DenoiserPass& operator=(const DenoiserPass&) = delete;
+
+        ~DenoiserPass();
+
+        // Follows the targets of the path tracing pass, to be called whenever they are reallocated (resize or AOVs
+        // toggled). Frames in flight must be complete.
+        void resize(vzt::Extent2D extent);
+
+        void record(uint32_t imageId, vzt::CommandBuffer& commands, const DenoiserSettings& settings,
+                    GpuProfiler* profiler = nullptr);
+
+        // Filtered radiance, in General layout
+        inline vzt::View<vzt::DeviceImage> getOutputImage() const;
+
+      private:
+        // Must match DenoiserProperties of shaders/denoise.comp
+        struct Properties
+        {
+            uint32_t iteration;
+            uint32_t iterations;
+            float    colorPhi;
+            float    normalPhi;
+            float    depthPhi;
+        };
+
+        void updateDescriptors(uint32_t imageId);
+
+        vzt::View<vzt::Device>             m_device;
+        uint32_t                           m_imageNb;
+        vzt::View<HardwarePathTracingPass> m_pathtracing;
+
+        ShaderCache           m_shaderCache{};
+        vzt::DescriptorLayout m_layout;
+        vzt::Program          m_program;
+        vzt::ComputePipeline  m_pipeline;
+
+        // Iterations alternate between two intermediate images
+        std::array<vzt::DeviceImage, 2> m_pingPongImages;
+        std::array<vzt::ImageView, 2>   m_pingPongImageViews;
+
+        vzt::DeviceImage m_outputImage;
+        vzt::ImageView   m_outputImageView;
+
+        vzt::ImageView m_accumulationImageView;
+        vzt::ImageView m_albedoImageView;
+        vzt::ImageView m_normalImageView;
+
+        // A descriptor set and a UBO slot per image id and iteration
+        vzt::DescriptorPool m_descriptorPool;
+        std::vector<bool>   m_outdatedDescriptors;
+        std::size_t         m_uboAlignment;
+        vzt::Buffer         m_ubo;
+        uint8_t*            m_uboData;
+
+        vzt::Extent2D m_extent;
+    };
+} // namespace lop
+
+#include "lop/Renderer/Pass/Denoiser.inl"
+
+#endif // LOP_RENDERER_PASS_DENOISER_HPP
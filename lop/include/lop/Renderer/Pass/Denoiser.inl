@@ -0,0 +1,6 @@
+#include "lop/Renderer/Pass/Denoiser.hpp"
+
+namespace lop
+{
+    inline vzt::View<vzt::DeviceImage> DenoiserPass::getOutputImage() const { return m_outputImage; }
+} // namespace lop
@@ -1,74 +1,299 @@
 #ifndef LOP_RENDERER_PASS_HARDWAREPATHTRACING_HPP
 #define LOP_RENDERER_PASS_HARDWAREPATHTRACING_HPP
 
-#include <vzt/Utils/Compiler.hpp>
+#include <array>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
 #include <vzt/Vulkan/AccelerationStructure.hpp>
 #include <vzt/Vulkan/Buffer.hpp>
 #include <vzt/Vulkan/Command.hpp>
 #include <vzt/Vulkan/Pipeline/RaytracingPipeline.hpp>
 
+#include "lop/Math/LowDiscrepancy.hpp"
 #include "lop/Renderer/Environment.hpp"
 #include "lop/Renderer/Geometry.hpp"
+#include "lop/Renderer/RadianceCache.hpp"
+#include "lop/Renderer/ShaderCache.hpp"
 #include "lop/System/System.hpp"
 
 namespace lop
 {
+    class GpuProfiler;
+
     class HardwarePathTracingPass
     {
       public:
         struct Properties
         {
-            vzt::Mat4 view;
-            vzt::Mat4 projection;
-            uint32_t  sampleId              = 0;
-            uint32_t  maxSample             = 0;
-            uint32_t  transparentBackground = 0;
-            uint32_t  jittering             = 1;
-            uint32_t  bounces               = 16;
+            vzt::Mat4      view;
+            vzt::Mat4      projection;
+            uint32_t       sampleId              = 0;
+            uint32_t       maxSample             = 0;
+            uint32_t       transparentBackground = 0;
+            uint32_t       jittering             = 1;
+            uint32_t       bounces               = 16;
+            uint32_t       statistics            = 0;
+            SampleSequence sequence              = SampleSequence::Sobol;
+            uint32_t       aovs                  = 0; // Overwritten by the pass, see setAovs
+            uint32_t       lightCount            = 0; // Overwritten by the pass, see MeshHandler::getLightCount
+
+            // Cells are this large within a unit distance of the camera, and twice as large at each power of two beyond
+            RadianceCacheMode radianceCache         = RadianceCacheMode::Disabled;
+            float             radianceCacheCellSize = .05f;
+            uint32_t          radianceCacheCapacity = 0; // Overwritten by the pass
+            uint32_t          frameId               = 0; // Overwritten by the pass, selects the training paths
+
+            // History length at which reprojected samples stop being accumulated while the camera moves
+            uint32_t temporal           = 0; // Overwritten by the pass, see setTemporalAccumulation
+            uint32_t temporalMaxHistory = 32;
+            uint32_t temporalHistory    = 0; // Overwritten by the pass, see TemporalHistory
+
+            // Camera of the previous trace, overwritten by the pass. Keeps the matrices 16 bytes aligned.
+            vzt::Mat4 previousView;
+            vzt::Mat4 previousProjection;
+
+            // Each sample traces the instances of a random time of the shutter interval
+            uint32_t motionSegmentNb = 1; // Overwritten by the pass, see MeshHandler::getMotionSegmentNb
+
+            // Index of the first sample in the sequence of each pixel, the accumulation being weighted by sampleId
+            // only. Disjoint sample ranges of the same image can then be traced separately and merged.
+            uint32_t sampleOffset = 0;
+
+            // Offsets the dimensions of the sample sequence: images of different seeds are independent estimates
+            uint32_t seed            = 0;
+            uint32_t rawAccumulation = 0; // Overwritten by the pass, see setRawAccumulation
+
+            // Every requested sample is accumulated, the trace is skipped
+            inline bool isConverged() const;
+        };
+
+        // Must match shaders/base.rgen
+        enum class TemporalHistory : uint32_t
+        {
+            None      = 0, // The temporal images are reset
+            Reproject = 1, // The camera moved, the history is reprojected and rejected on depth or normal changes
+            Static    = 2, // The camera did not move, the history of each pixel is kept as is
         };
 
+        // Ray counts of a single frame, only gathered when Properties::statistics is set
+        struct RayStatistics
+        {
+            uint32_t primary       = 0;
+            uint32_t continuation  = 0;
+            uint32_t lightSampling = 0;
+            uint32_t bsdfSampling  = 0;
+            uint32_t terminations  = 0;
+
+            // Radiance cache lookups, the luminance sums are only gathered by RadianceCacheMode::Validation
+            uint32_t cacheLookups    = 0;
+            uint32_t cacheHits       = 0;
+            int32_t  cacheDifference = 0;
+            uint32_t cacheReference  = 0;
+
+            inline uint64_t getTotal() const;
+            inline double   getMraysPerSecond(float milliseconds) const;
+
+            inline double getCacheHitRate() const;
+            // Relative difference between the luminance of the cache and the traced one, on the validation paths
+            inline double getCacheBias() const;
+
+            RayStatistics& operator+=(const RayStatistics& other);
+        };
+
+        // Features baked as compile-time constants in the ray generation shader to remove their runtime branches. Each
+        // combination is a separate pipeline, compiled the first time it is used.
+        struct KernelVariant
+        {
+            bool jittering             = true;
+            bool transparentBackground = false;
+            bool transmission          = true;
+            bool clearcoat             = true;
+            bool aovs                  = false;
+            bool meshLights            = false;
+            bool temporal              = false;
+            bool motionBlur            = false;
+            bool rawAccumulation       = false;
+
+            RadianceCacheMode radianceCache = RadianceCacheMode::Disabled;
+            SampleSequence    sequence      = SampleSequence::Sobol;
+
+            inline uint32_t          getKey() const;
+            std::vector<std::string> getDefines() const;
+        };
+
+        // The ray tracing pipeline of every kernel is created through the pipeline cache, when given
         HardwarePathTracingPass(vzt::View<vzt::Device> device, uint32_t imageNb, vzt::Extent2D extent,
-                                vzt::View<MeshHandler> handler, Environment environment);
-        ~HardwarePathTracingPass() = default;
+                                vzt::View<MeshHandler> handler, Environment environment,
+                                VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+
+        HardwarePathTracingPass(const HardwarePathTracingPass&)            = delete;
+        HardwarePathTracingPass& operator=(const HardwarePathTracingPass&) = delete;
+
+        ~HardwarePathTracingPass();
 
         void setEnvironment(Environment environment);
 
         void resize(vzt::Extent2D extent);
         void update();
 
+        // When disabled, every feature is read at runtime by a single generic kernel
+        inline void   setKernelVariants(bool enabled);
+        KernelVariant getKernelVariant(const Properties& properties) const;
+
+        inline vzt::Extent2D               getExtent() const;
+        inline vzt::View<vzt::DeviceImage> getAccumulationImage() const;
+
+        // Display image, written by TonemapPass and kept in TransferSrcOptimal layout between frames
         inline vzt::View<vzt::DeviceImage> getRenderImage() const;
 
+        // First hit AOVs, written by the primary rays of the beauty pass. When disabled, their images are 1x1
+        // placeholders. Changing this reallocates every target and restarts the accumulation.
+        void        setAovs(bool enabled);
+        inline bool getAovs() const;
+
+        // Blend each frame with the previous ones reprojected with the previous camera, instead of restarting the
+        // accumulation when Properties::sampleId is reset. Disabled, its images are 1x1 placeholders. Changing this
+        // reallocates every target.
+        void        setTemporalAccumulation(bool enabled);
+        inline bool getTemporalAccumulation() const;
+
+        // Sum the radiance of each sample in unsigned 40.24 fixed point, split in low and high 32 bits words of two
+        // R32G32B32A32Uint images. Integer sums do not depend on the order of the samples: the sums of disjoint sample
+        // ranges add up exactly to those of a single trace, see RawAccumulation. Disabled, the images are 1x1
+        // placeholders. Changing this reallocates every target.
+        void        setRawAccumulation(bool enabled);
+        inline bool getRawAccumulation() const;
+
+        inline vzt::View<vzt::DeviceImage> getSumLowImage() const;
+        inline vzt::View<vzt::DeviceImage> getSumHighImage() const;
+
+        // Accumulated like the radiance: albedo, and shading normal with the hit distance in w (negative on background)
+        inline vzt::View<vzt::DeviceImage> getAlbedoImage() const;
+        inline vzt::View<vzt::DeviceImage> getNormalImage() const;
+
+        // R32Uint instance index of the first sample, ~0u on background
+        inline vzt::View<vzt::DeviceImage> getInstanceImage() const;
+
+        // Placeholder of a single cell while disabled
+        inline const RadianceCache& getRadianceCache() const;
+
+        // Counters of the last completed frame and their sum since the last reset
+        inline const RayStatistics& getRayStatistics() const;
+        inline const RayStatistics& getAccumulatedRayStatistics() const;
+        void                        resetRayStatistics();
+
+        // Gather the counters of every frame still pending, the device must be idle
+        void collectRayStatistics();
+
+        // Trace then copy the render image to the output image, without updating it
         void record(uint32_t imageId, vzt::CommandBuffer& commands, const vzt::View<vzt::DeviceImage> outputImage,
-                    Properties properties);
+                    Properties properties, GpuProfiler* profiler = nullptr);
+
+        // Separate steps of record, allowing other passes to process the images in between. Once the properties are
+        // converged, trace only releases the resources of completed frames and the images are left untouched.
+        void trace(uint32_t imageId, vzt::CommandBuffer& commands, Properties properties,
+                   GpuProfiler* profiler = nullptr);
+        void copy(uint32_t imageId, vzt::CommandBuffer& commands, const vzt::View<vzt::DeviceImage> outputImage,
+                  GpuProfiler* profiler = nullptr);
 
       private:
+        // The pipeline is created without vzt::RaytracingPipeline, which does not take a pipeline cache
+        struct Kernel
+        {
+            Kernel(vzt::View<vzt::Device> device);
+
+            Kernel(const Kernel&)            = delete;
+            Kernel& operator=(const Kernel&) = delete;
+
+            ~Kernel();
+
+            vzt::View<vzt::Device> device;
+            VkPipeline             pipeline = VK_NULL_HANDLE;
+
+            vzt::Buffer raygenShaderBindingTable;
+            vzt::Buffer missShaderBindingTable;
+            vzt::Buffer hitShaderBindingTable;
+        };
+
+        const Kernel& getKernel(const std::optional<KernelVariant>& variant);
+
+        void readRayStatistics(uint32_t imageId);
+        void updateDescriptors(uint32_t imageId);
+
+        // Keep a resource alive until every frame in flight which may reference it is complete
+        template <class Type>
+        void retire(Type&& resource);
+
         vzt::View<vzt::Device> m_device;
         uint32_t               m_imageNb;
 
-        vzt::ShaderGroup        m_shaderGroup;
-        vzt::Compiler           m_compiler{};
-        vzt::DescriptorLayout   m_layout;
-        vzt::RaytracingPipeline m_pipeline;
+        ShaderCache           m_shaderCache{};
+        vzt::DescriptorLayout m_layout;
+        VkPipelineCache       m_pipelineCache  = VK_NULL_HANDLE;
+        VkPipelineLayout      m_pipelineLayout = VK_NULL_HANDLE;
+
+        bool                                                  m_kernelVariants     = true;
+        bool                                                  m_subgroupArithmetic = false; // In ray generation
+        bool                                                  m_aovs               = false;
+        bool                                                  m_temporal           = false;
+        bool                                                  m_raw                = false;
+        std::unordered_map<uint32_t, std::unique_ptr<Kernel>> m_kernels;
+        uint32_t                                              m_handleSizeAligned;
+        uint32_t                                              m_handleSize;
 
         vzt::DeviceImage m_accumulationImage;
         vzt::ImageView   m_accumulationImageView;
 
+        vzt::DeviceImage m_albedoImage;
+        vzt::ImageView   m_albedoImageView;
+
+        vzt::DeviceImage m_normalImage;
+        vzt::ImageView   m_normalImageView;
+
+        vzt::DeviceImage m_instanceImage;
+        vzt::ImageView   m_instanceImageView;
+
+        // Accumulated color, and octahedral normal, first hit distance and history length, of even and odd frames
+        std::array<vzt::DeviceImage, 2> m_temporalColorImages;
+        std::array<vzt::ImageView, 2>   m_temporalColorImageViews;
+        std::array<vzt::DeviceImage, 2> m_temporalGeometryImages;
+        std::array<vzt::ImageView, 2>   m_temporalGeometryImageViews;
+        bool                            m_historyValid = false;
+        vzt::Mat4                       m_previousView{1.f};
+        vzt::Mat4                       m_previousProjection{1.f};
+
+        vzt::DeviceImage m_sumLowImage;
+        vzt::ImageView   m_sumLowImageView;
+        vzt::DeviceImage m_sumHighImage;
+        vzt::ImageView   m_sumHighImageView;
+
         vzt::DeviceImage m_renderImage;
-        vzt::ImageView   m_renderImageView;
 
         vzt::DescriptorPool m_descriptorPool;
+        std::vector<bool>   m_outdatedDescriptors;
         std::size_t         m_uboAlignment;
         vzt::Buffer         m_ubo;
+        uint8_t*            m_uboData;
 
-        uint32_t    m_handleSizeAligned;
-        uint32_t    m_handleSize;
-        vzt::Buffer m_raygenShaderBindingTable;
-        vzt::Buffer m_missShaderBindingTable;
-        vzt::Buffer m_hitShaderBindingTable;
+        vzt::Buffer m_samplerTables;
+
+        std::unique_ptr<RadianceCache> m_radianceCache;
+        uint32_t                       m_frameId = 0;
+
+        std::vector<vzt::Buffer> m_statistics;
+        std::vector<uint8_t*>    m_statisticsData;
+        std::vector<bool>        m_statisticsPending;
+        RayStatistics            m_rayStatistics{};
+        RayStatistics            m_accumulatedRayStatistics{};
 
         vzt::Extent2D          m_extent;
         vzt::View<MeshHandler> m_handler;
         Environment            m_environment;
+
+        std::vector<std::pair<std::shared_ptr<void>, uint32_t>> m_retired;
     };
 } // namespace lop
 
@@ -2,5 +2,79 @@
 
 namespace lop
 {
+    inline bool HardwarePathTracingPass::Properties::isConverged() const
+    {
+        return maxSample != 0 && sampleId >= maxSample;
+    }
+
+    inline vzt::Extent2D               HardwarePathTracingPass::getExtent() const { return m_extent; }
     inline vzt::View<vzt::DeviceImage> HardwarePathTracingPass::getRenderImage() const { return m_renderImage; }
+    inline vzt::View<vzt::DeviceImage> HardwarePathTracingPass::getAccumulationImage() const
+    {
+        return m_accumulationImage;
+    }
+    inline vzt::View<vzt::DeviceImage> HardwarePathTracingPass::getAlbedoImage() const { return m_albedoImage; }
+    inline vzt::View<vzt::DeviceImage> HardwarePathTracingPass::getNormalImage() const { return m_normalImage; }
+    inline vzt::View<vzt::DeviceImage> HardwarePathTracingPass::getInstanceImage() const { return m_instanceImage; }
+
+    inline bool HardwarePathTracingPass::getAovs() const { return m_aovs; }
+    inline bool HardwarePathTracingPass::getTemporalAccumulation() const { return m_temporal; }
+    inline bool HardwarePathTracingPass::getRawAccumulation() const { return m_raw; }
+    inline vzt::View<vzt::DeviceImage> HardwarePathTracingPass::getSumLowImage() const { return m_sumLowImage; }
+    inline vzt::View<vzt::DeviceImage> HardwarePathTracingPass::getSumHighImage() const { return m_sumHighImage; }
+
+    inline const RadianceCache& HardwarePathTracingPass::getRadianceCache() const { return *m_radianceCache; }
+
+    inline const HardwarePathTracingPass::RayStatistics& HardwarePathTracingPass::getRayStatistics() const
+    {
+        return m_rayStatistics;
+    }
+
+    inline const HardwarePathTracingPass::RayStatistics& HardwarePathTracingPass::getAccumulatedRayStatistics() const
+    {
+        return m_accumulatedRayStatistics;
+    }
+
+    inline void HardwarePathTracingPass::setKernelVariants(bool enabled) { m_kernelVariants = enabled; }
+
+    inline uint32_t HardwarePathTracingPass::KernelVariant::getKey() const
+    {
+        return uint32_t(jittering) | uint32_t(transparentBackground) << 1u | uint32_t(transmission) << 2u |
+               uint32_t(clearcoat) << 3u | static_cast<uint32_t>(sequence) << 4u | uint32_t(aovs) << 6u |
+               uint32_t(meshLights) << 7u | static_cast<uint32_t>(radianceCache) << 8u | uint32_t(temporal) << 10u |
+               uint32_t(motionBlur) << 11u | uint32_t(rawAccumulation) << 12u;
+    }
+
+    template <class Type>
+    void HardwarePathTracingPass::retire(Type&& resource)
+    {
+        using ResourceType = std::remove_reference_t<Type>;
+        m_retired.emplace_back(std::make_shared<ResourceType>(std::forward<Type>(resource)), m_imageNb);
+    }
+
+    inline uint64_t HardwarePathTracingPass::RayStatistics::getTotal() const
+    {
+        return uint64_t(primary) + continuation + lightSampling + bsdfSampling;
+    }
+
+    inline double HardwarePathTracingPass::RayStatistics::getMraysPerSecond(float milliseconds) const
+    {
+        if (milliseconds <= 0.f)
+            return 0.;
+        return static_cast<double>(getTotal()) / (static_cast<double>(milliseconds) * 1e3);
+    }
+
+    inline double HardwarePathTracingPass::RayStatistics::getCacheHitRate() const
+    {
+        if (cacheLookups == 0)
+            return 0.;
+        return static_cast<double>(cacheHits) / static_cast<double>(cacheLookups);
+    }
+
+    inline double HardwarePathTracingPass::RayStatistics::getCacheBias() const
+    {
+        if (cacheReference == 0)
+            return 0.;
+        return static_cast<double>(cacheDifference) / static_cast<double>(cacheReference);
+    }
 } // namespace lop
@@ -0,0 +1,106 @@
+#ifndef LOP_RENDERER_PASS_TONEMAP_HPP
+#define LOP_RENDERER_PASS_TONEMAP_HPP
+
+#include <vector>
+
+#include <vzt/Vulkan/Buffer.hpp>
+#include <vzt/Vulkan/Command.hpp>
+#include <vzt/Vulkan/Pipeline/ComputePipeline.hpp>
+#include <vzt/Vulkan/Program.hpp>
+
+#include "lop/Renderer/ShaderCache.hpp"
+
+namespace lop
+{
+    class DenoiserPass;
+    class GpuProfiler;
+    class HardwarePathTracingPass;
+
+    // Must match shaders/tonemap.comp
+    enum class TonemapOperator : uint32_t
+    {
+        Aces     = 0, // Narkowicz fit of the ACES filmic curve
+        AgX      = 1, // Sobotka's AgX, desaturates highlights
+        Reinhard = 2, // Luminance-based Reinhard
+    };
+
+    // Must match shaders/tonemap.comp
+    enum class OutputTransform : uint32_t
+    {
+        Linear = 0, // Written as is
+        Srgb   = 1, // sRGB transfer function
+    };
+
+    struct TonemapSettings
+    {
+        float           exposure        = 0.f; // In stops
+        TonemapOperator tonemapOperator = TonemapOperator::Aces;
+        OutputTransform outputTransform = OutputTransform::Linear;
+    };
+
+    // Converts the radiance of a path tracing or denoiser pass to the render image of the path tracing pass. Display
+    // settings are independent of the accumulation: the pass only needs to be recorded when either of them changed,
+    // the render image keeps the previous result otherwise.
+    class TonemapPass
+    {
+      public:
+        enum class Source
+        {
+            Accumulation, // HardwarePathTracingPass::getAccumulationImage
+            Denoised,     // DenoiserPass::getOutputImage
+        };
+
+        TonemapPass(vzt::View<vzt::Device> device, uint32_t imageNb, vzt::View<HardwarePathTracingPass> pathtracing,
+                    vzt::View<DenoiserPass> denoiser);
+
+        TonemapPass(const TonemapPass&)            = delete;
+        TonemapPass& operator=(const TonemapPass&) = delete;
+
+        ~TonemapPass();
+
+        // Follows the images of both sources, to be called after they are reallocated. Frames in flight must be
+        // complete.
+        void resize();
+
+        void record(uint32_t imageId, vzt::CommandBuffer& commands, Source source, const TonemapSettings& settings,
+                    GpuProfiler* profiler = nullptr);
+
+      private:
+        // Must match TonemapProperties of shaders/tonemap.comp
+        struct Properties
+        {
+            float    exposure;
+            uint32_t tonemapOperator;
+            uint32_t outputTransform;
+        };
+
+        static constexpr uint32_t SourceNb = 2;
+
+        void updateDescriptors(uint32_t imageId);
+
+        vzt::View<vzt::Device>             m_device;
+        uint32_t                           m_imageNb;
+        vzt::View<HardwarePathTracingPass> m_pathtracing;
+        vzt::View<DenoiserPass>            m_denoiser;
+
+        ShaderCache           m_shaderCache{};
+        vzt::DescriptorLayout m_layout;
+        vzt::Program          m_program;
+        vzt::ComputePipeline  m_pipeline;
+
+        vzt::ImageView m_accumulationImageView;
+        vzt::ImageView m_denoisedImageView;
+        vzt::ImageView m_renderImageView;
+
+        // A descriptor set per image id and source, a UBO slot per image id
+        vzt::DescriptorPool m_descriptorPool;
+        std::vector<bool>   m_outdatedDescriptors;
+        std::size_t         m_uboAlignment;
+        vzt::Buffer         m_ubo;
+        uint8_t*            m_uboData;
+
+        vzt::Extent2D m_extent;
+    };
+} // namespace lop
+
+#endif // LOP_RENDERER_PASS_TONEMAP_HPP
@@ -19,16 +19,19 @@ namespace vzt
 
 namespace lop
 {
+    class GpuProfiler;
+
     class UserInterfacePass
     {
       public:
         UserInterfacePass(vzt::Window& window, vzt::View<vzt::Instance> instance, vzt::View<vzt::Device> device,
-                          vzt::View<vzt::Swapchain> swapchain);
+                          vzt::View<vzt::Swapchain> swapchain, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
         ~UserInterfacePass();
 
         void startFrame() const;
         void resize(vzt::Extent2D extent);
-        void record(uint32_t imageId, vzt::CommandBuffer& commands, const vzt::View<vzt::DeviceImage> outputImage);
+        void record(uint32_t imageId, vzt::CommandBuffer& commands, const vzt::View<vzt::DeviceImage> outputImage,
+                    GpuProfiler* profiler = nullptr);
 
       private:
         vzt::View<vzt::Device>    m_device;
@@ -0,0 +1,39 @@
+#ifndef LOP_RENDERER_PIPELINECACHE_HPP
+#define LOP_RENDERER_PIPELINECACHE_HPP
+
+#include <vzt/Core/File.hpp>
+#include <vzt/Core/Type.hpp>
+#include <vzt/Core/Vulkan.hpp>
+
+namespace vzt
+{
+    class Device;
+}
+
+namespace lop
+{
+    // VkPipelineCache persisted on disk across runs. Blobs written by another driver or device are discarded.
+    class PipelineCache
+    {
+      public:
+        PipelineCache(vzt::View<vzt::Device> device, vzt::Path path = "cache/pipeline.bin");
+
+        PipelineCache(const PipelineCache&)            = delete;
+        PipelineCache& operator=(const PipelineCache&) = delete;
+
+        ~PipelineCache();
+
+        void save() const;
+
+        inline VkPipelineCache getHandle() const;
+
+      private:
+        vzt::View<vzt::Device> m_device;
+        vzt::Path              m_path;
+        VkPipelineCache        m_handle = VK_NULL_HANDLE;
+    };
+} // namespace lop
+
+#include "lop/Renderer/PipelineCache.inl"
+
+#endif // LOP_RENDERER_PIPELINECACHE_HPP
@@ -0,0 +1,6 @@
+#include "lop/Renderer/PipelineCache.hpp"
+
+namespace lop
+{
+    inline VkPipelineCache PipelineCache::getHandle() const { return m_handle; }
+} // namespace lop
@@ -0,0 +1,91 @@
+#ifndef LOP_RENDERER_RADIANCECACHE_HPP
+#define LOP_RENDERER_RADIANCECACHE_HPP
+
+#include <vzt/Vulkan/Buffer.hpp>
+#include <vzt/Vulkan/Command.hpp>
+#include <vzt/Vulkan/Pipeline/ComputePipeline.hpp>
+#include <vzt/Vulkan/Program.hpp>
+
+#include "lop/Renderer/ShaderCache.hpp"
+
+namespace lop
+{
+    class GpuProfiler;
+
+    // Must match shaders/lop/radiance_cache.glsl
+    enum class RadianceCacheMode : uint32_t
+    {
+        Disabled   = 0,
+        Enabled    = 1, // Paths terminate into the cache after their first bounce
+        Validation = 2, // Paths are traced entirely and compared to the cache at their first bounce
+    };
+
+    // World space hash grid of the radiance leaving path vertices. A fixed subset of the paths of each frame is traced
+    // entirely and accumulates into the cells of its vertices, which are merged into a running average after the
+    // trace. Other paths terminate into the cell of their first bounce once it gathered enough samples. Cells grow
+    // with the distance to the camera and are split by the dominant axis of the normal.
+    // The table has a fixed capacity: cells colliding with a full probe sequence are dropped and cells which are not
+    // updated for MaxAge frames are evicted. Its content does not depend on the camera and is kept across frames,
+    // it must only be reset when the scene changes.
+    // Reference: Fast Path Space Filtering by Jittered Spatial Hashing, Binder et al., 2018
+    class RadianceCache
+    {
+      public:
+        static constexpr uint32_t DefaultCapacity = 1u << 20;
+        static constexpr uint32_t MaxAge          = 64;
+
+        // Capacity must be a power of two
+        RadianceCache(vzt::View<vzt::Device> device, uint32_t capacity = DefaultCapacity);
+
+        RadianceCache(const RadianceCache&)            = delete;
+        RadianceCache& operator=(const RadianceCache&) = delete;
+
+        ~RadianceCache() = default;
+
+        // Empties every cell before the next trace
+        inline void reset();
+
+        // Recorded before the trace, clears the table when it was reset
+        void prepare(vzt::CommandBuffer& commands);
+
+        // Recorded after the trace, merges its samples into the cells and ages them
+        void resolve(uint32_t imageId, vzt::CommandBuffer& commands, GpuProfiler* profiler = nullptr);
+
+        inline uint32_t    getCapacity() const;
+        inline std::size_t getMemoryFootprint() const;
+
+        // Checksums of the cells, 0 for an empty entry
+        inline const vzt::Buffer& getKeys() const;
+        // Fixed point radiance sum and sample count of the current frame
+        inline const vzt::Buffer& getAccumulation() const;
+        // Average radiance and its sample count
+        inline const vzt::Buffer& getResolved() const;
+
+      private:
+        // Key, accumulation, resolved radiance and age
+        static constexpr std::size_t EntrySize = sizeof(uint32_t) * 6 + sizeof(vzt::Vec4);
+
+        void barrier(vzt::CommandBuffer& commands, vzt::PipelineStage src, vzt::PipelineStage dst) const;
+
+        vzt::View<vzt::Device> m_device;
+        uint32_t               m_capacity;
+        bool                   m_outdated = true;
+
+        ShaderCache           m_shaderCache{};
+        vzt::DescriptorLayout m_layout;
+        vzt::Program          m_clearProgram;
+        vzt::ComputePipeline  m_clearPipeline;
+        vzt::Program          m_resolveProgram;
+        vzt::ComputePipeline  m_resolvePipeline;
+        vzt::DescriptorPool   m_descriptorPool;
+
+        vzt::Buffer m_keys;
+        vzt::Buffer m_accumulation;
+        vzt::Buffer m_resolved;
+        vzt::Buffer m_ages;
+    };
+} // namespace lop
+
+#include "lop/Renderer/RadianceCache.inl"
+
+#endif // LOP_RENDERER_RADIANCECACHE_HPP
@@ -0,0 +1,13 @@
+#include "lop/Renderer/RadianceCache.hpp"
+
+namespace lop
+{
+    inline void RadianceCache::reset() { m_outdated = true; }
+
+    inline uint32_t    RadianceCache::getCapacity() const { return m_capacity; }
+    inline std::size_t RadianceCache::getMemoryFootprint() const { return EntrySize * m_capacity; }
+
+    inline const vzt::Buffer& RadianceCache::getKeys() const { return m_keys; }
+    inline const vzt::Buffer& RadianceCache::getAccumulation() const { return m_accumulation; }
+    inline const vzt::Buffer& RadianceCache::getResolved() const { return m_resolved; }
+} // namespace lop
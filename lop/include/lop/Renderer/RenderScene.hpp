@@ -0,0 +1,89 @@
+#ifndef LOP_RENDERER_RENDERSCENE_HPP
+#define LOP_RENDERER_RENDERSCENE_HPP
+
+#include <vector>
+
+#include <entt/entt.hpp>
+#include <vzt/Core/Math.hpp>
+#include <vzt/Core/Type.hpp>
+
+#include "lop/Renderer/Geometry.hpp"
+#include "lop/System/Hierarchy.hpp"
+
+namespace lop
+{
+    // Device addresses of the geometry of an instance
+    struct InstanceRecord
+    {
+        uint64_t vertexBuffer;
+        uint64_t indexBuffer;
+        uint64_t accelerationStructure;
+    };
+
+    // Parts of the scene modified since the last extraction
+    struct SceneChanges
+    {
+        bool instances = false; // Instances were added, removed or moved, or their geometry changed
+        bool materials = false;
+    };
+
+    // Packed arrays of the entities holding a MeshHolder, a Transform and a Material, indexed by instance. They are
+    // kept up to date from the signals of the registry, so that only modified entities are visited: components
+    // modified in place must be notified through registry.patch. World transforms at shutter open and close are the
+    // ones evaluated by the TransformHierarchy, they are equal for static instances. Removing an instance moves the
+    // last one in its place. Each object has its own material, the instance index is also its material index.
+    class RenderScene
+    {
+      public:
+        static constexpr uint32_t NoInstance = ~0u;
+
+        RenderScene(entt::registry& registry);
+
+        RenderScene(const RenderScene&)            = delete;
+        RenderScene& operator=(const RenderScene&) = delete;
+
+        RenderScene(RenderScene&&)            = delete;
+        RenderScene& operator=(RenderScene&&) = delete;
+
+        ~RenderScene();
+
+        // Returns the changes since the previous extraction, the hierarchy must be up to date
+        SceneChanges extract(const TransformHierarchy& hierarchy);
+
+        inline uint32_t getInstanceNb() const;
+        inline uint32_t getInstance(entt::entity entity) const;
+
+        inline vzt::CSpan<entt::entity>      getEntities() const;
+        inline vzt::CSpan<InstanceTransform> getTransforms() const;
+        inline vzt::CSpan<InstanceTransform> getCloseTransforms() const;
+        inline vzt::CSpan<InstanceRecord>    getRecords() const;
+        inline vzt::CSpan<Material>          getMaterials() const;
+
+      private:
+        static inline InstanceRecord getRecord(const MeshHolder& holder);
+
+        void onConstruct(entt::registry& registry, entt::entity entity);
+        void onDestroy(entt::registry& registry, entt::entity entity);
+        void onMaterialUpdate(entt::registry& registry, entt::entity entity);
+        void onGeometryUpdate(entt::registry& registry, entt::entity entity);
+
+        entt::registry* m_registry;
+        SceneChanges    m_changes;
+
+        // Instance of each entity, indexed by entity identifier
+        std::vector<uint32_t> m_instances;
+
+        // Entities added since the previous extraction, whose world transform is not known yet
+        std::vector<entt::entity> m_inserted;
+
+        std::vector<entt::entity>      m_entities;
+        std::vector<InstanceTransform> m_transforms;
+        std::vector<InstanceTransform> m_closeTransforms;
+        std::vector<InstanceRecord>    m_records;
+        std::vector<Material>          m_materials;
+    };
+} // namespace lop
+
+#include "lop/Renderer/RenderScene.inl"
+
+#endif // LOP_RENDERER_RENDERSCENE_HPP
@@ -0,0 +1,29 @@
+#include "lop/Renderer/RenderScene.hpp"
+
+namespace lop
+{
+    inline uint32_t RenderScene::getInstanceNb() const { return static_cast<uint32_t>(m_entities.size()); }
+
+    inline uint32_t RenderScene::getInstance(entt::entity entity) const
+    {
+        const std::size_t id = static_cast<std::size_t>(entt::to_entity(entity));
+        if (id >= m_instances.size() || m_instances[id] == NoInstance || m_entities[m_instances[id]] != entity)
+            return NoInstance;
+        return m_instances[id];
+    }
+
+    inline vzt::CSpan<entt::entity>      RenderScene::getEntities() const { return m_entities; }
+    inline vzt::CSpan<InstanceTransform> RenderScene::getTransforms() const { return m_transforms; }
+    inline vzt::CSpan<InstanceTransform> RenderScene::getCloseTransforms() const { return m_closeTransforms; }
+    inline vzt::CSpan<InstanceRecord>    RenderScene::getRecords() const { return m_records; }
+    inline vzt::CSpan<Material>          RenderScene::getMaterials() const { return m_materials; }
+
+    inline InstanceRecord RenderScene::getRecord(const MeshHolder& holder)
+    {
+        return InstanceRecord{
+            holder.vertexBuffer.getDeviceAddress(),
+            holder.indexBuffer.getDeviceAddress(),
+            holder.getAccelerationStructure().getDeviceAddress(),
+        };
+    }
+} // namespace lop
@@ -0,0 +1,39 @@
+#ifndef LOP_RENDERER_SHADERCACHE_HPP
+#define LOP_RENDERER_SHADERCACHE_HPP
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <vzt/Core/File.hpp>
+#include <vzt/Utils/Compiler.hpp>
+
+namespace lop
+{
+    // Resolves SPIR-V for a GLSL source in order of preference:
+    // 1. <source>.spv compiled at build time, if newer than the source and its includes
+    // 2. <cacheDirectory>/<hash>.spv from a previous run, keyed by the hash of the source and its includes
+    // 3. Runtime compilation, whose result is stored in the cache directory
+    class ShaderCache
+    {
+      public:
+        ShaderCache(vzt::Path cacheDirectory = "cache/shaders");
+
+        vzt::Shader get(const vzt::Path& path, vzt::ShaderStage stage);
+
+        // Compiles a permutation of the source with "#define <define>" inserted after its #version directive. The
+        // permutation is written in the cache directory, its includes inlined from the folder of the source. SPIR-V
+        // compiled at build time with the same defines is named <stem>.<hash><extension>.spv next to the source, see
+        // cmake/add_shader_permutation.cmake.
+        vzt::Shader get(const vzt::Path& path, vzt::ShaderStage stage, const std::vector<std::string>& defines);
+
+      private:
+        vzt::Path                    m_cacheDirectory;
+        std::optional<vzt::Compiler> m_compiler;
+    };
+
+    // 64-bit FNV-1a of a shader source and, recursively, of every file it includes
+    uint64_t hashShaderSource(const vzt::Path& path);
+} // namespace lop
+
+#endif // LOP_RENDERER_SHADERCACHE_HPP
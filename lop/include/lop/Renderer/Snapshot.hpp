@@ -1,13 +1,50 @@
 #ifndef LOP_RENDERER_SNAPSHOT_HPP
 #define LOP_RENDERER_SNAPSHOT_HPP
 
+#include <string>
+#include <variant>
+#include <vector>
+
 #include <vzt/Core/File.hpp>
+#include <vzt/Data/Image.hpp>
 #include <vzt/Vulkan/Command.hpp>
 #include <vzt/Vulkan/Image.hpp>
 
 namespace lop
 {
+    class HardwarePathTracingPass;
+
     void snapshot(vzt::View<vzt::Device> device, vzt::View<vzt::DeviceImage> outputImage, const vzt::Path& outputPath);
+
+    // Copy the B8G8R8A8Unorm display image, in TransferSrcOptimal layout, to RGBA host memory
+    Image<uint8_t> readbackDisplay(vzt::View<vzt::Device> device, vzt::View<vzt::DeviceImage> image);
+
+    bool writePng(const vzt::Path& path, const Image<uint8_t>& image);
+
+    // Copy a R32G32B32A32SFloat image in general layout to host memory
+    Image<float> readback(vzt::View<vzt::Device> device, vzt::View<vzt::DeviceImage> image);
+
+    // Copy a R32Uint image in general layout to host memory
+    Image<uint32_t> readbackUint(vzt::View<vzt::Device> device, vzt::View<vzt::DeviceImage> image);
+
+    // Copy a R32G32B32A32Uint image in general layout to host memory
+    Image<uint32_t> readbackUint4(vzt::View<vzt::Device> device, vzt::View<vzt::DeviceImage> image);
+
+    // Channel of a multi-layer OpenEXR file, whose name is prefixed by its layer (e.g. "albedo.R")
+    struct ExrChannel
+    {
+        std::string                                             name;
+        std::variant<std::vector<float>, std::vector<uint32_t>> values; // Row-major, top row first
+
+        static ExrChannel fromImage(std::string name, const Image<float>& image, uint32_t channel);
+    };
+
+    // Uncompressed scanline OpenEXR, with float channels stored at full precision
+    bool writeExr(const vzt::Path& path, uint32_t width, uint32_t height, std::vector<ExrChannel> channels);
+
+    // Beauty pass and, when enabled, every AOV of the pass in a single OpenEXR file. The depth layer Z is the hit
+    // distance along the primary rays.
+    bool snapshotLayers(vzt::View<vzt::Device> device, const HardwarePathTracingPass& pass, const vzt::Path& path);
 } // namespace lop
 
 #endif // PTO_RENDERER_VIEW_SNAPSHOT_HPP
@@ -0,0 +1,67 @@
+#ifndef LOP_SYSTEM_ARENA_HPP
+#define LOP_SYSTEM_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+namespace lop
+{
+    struct ArenaStatistics
+    {
+        uint64_t allocationNb         = 0; // Allocations served since the last reset
+        uint64_t upstreamAllocationNb = 0; // Blocks requested to the upstream resource since the last reset
+        uint64_t used                 = 0;
+        uint64_t capacity             = 0;
+    };
+
+    // Monotonic memory resource whose blocks are kept across resets. Deallocation is a no-op, every allocation is
+    // invalidated at once by reset(), which also merges the blocks into a single one when a cycle needed several of
+    // them: once a cycle of the same size ran, the next ones make no upstream allocation.
+    class Arena : public std::pmr::memory_resource
+    {
+      public:
+        static constexpr std::size_t DefaultBlockSize = std::size_t(64) << 10;
+
+        Arena(std::size_t                blockSize = DefaultBlockSize,
+              std::pmr::memory_resource* upstream  = std::pmr::new_delete_resource());
+
+        Arena(const Arena&)            = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        ~Arena() override;
+
+        void reset();
+
+        inline const ArenaStatistics& getStatistics() const;
+
+      private:
+        static constexpr std::size_t BlockAlignment = alignof(std::max_align_t);
+
+        struct Block
+        {
+            std::byte*  data;
+            std::size_t size;
+        };
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void  do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override;
+        bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        void releaseBlocks();
+
+        std::pmr::memory_resource* m_upstream;
+        std::size_t                m_blockSize;
+
+        std::vector<Block> m_blocks;
+        std::size_t        m_block  = 0;
+        std::size_t        m_offset = 0;
+
+        ArenaStatistics m_statistics;
+    };
+} // namespace lop
+
+#include "lop/System/Arena.inl"
+
+#endif // LOP_SYSTEM_ARENA_HPP
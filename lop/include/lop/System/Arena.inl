@@ -0,0 +1,6 @@
+#include "lop/System/Arena.hpp"
+
+namespace lop
+{
+    inline const ArenaStatistics& Arena::getStatistics() const { return m_statistics; }
+} // namespace lop
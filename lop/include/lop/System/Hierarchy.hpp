@@ -0,0 +1,125 @@
+#ifndef LOP_SYSTEM_HIERARCHY_HPP
+#define LOP_SYSTEM_HIERARCHY_HPP
+
+#include <array>
+#include <vector>
+
+#include <entt/entt.hpp>
+#include <vzt/Core/Type.hpp>
+
+#include "lop/System/Transform.hpp"
+
+namespace lop
+{
+    // The Transform of an entity with a parent is relative to the one of its parent. Parents without Transform, and
+    // entities closing a cycle, are roots.
+    struct Hierarchy
+    {
+        entt::entity parent = entt::null;
+    };
+
+    // World transforms of the entities holding a Transform. Nodes are stored sorted by depth, so that each level is
+    // evaluated after the one of its parents, and their local transforms are copied in separate arrays per component
+    // when they are created or patched. An update only visits the subtrees of the patched nodes: their rotations are
+    // converted by blocks which vectorize, then composed with the world transform of their parent. Levels holding
+    // many dirty nodes are split across threads.
+    // While an entity holds a Motion, world transforms at shutter close are evaluated alongside, from the local
+    // transform of the Motion or the Transform of each node.
+    // Components modified in place must be notified through registry.patch.
+    class TransformHierarchy
+    {
+      public:
+        static constexpr uint32_t NoNode = ~0u;
+
+        TransformHierarchy(entt::registry& registry);
+
+        TransformHierarchy(const TransformHierarchy&)            = delete;
+        TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+        TransformHierarchy(TransformHierarchy&&)            = delete;
+        TransformHierarchy& operator=(TransformHierarchy&&) = delete;
+
+        ~TransformHierarchy();
+
+        // Every hardware thread when threadCount is 0
+        void update(uint32_t threadCount = 0);
+
+        inline uint32_t getNodeNb() const;
+        inline uint32_t getLevelNb() const;
+
+        // Nodes are renumbered when entities or parents change, they are valid until the next update
+        inline uint32_t                 getNode(entt::entity entity) const;
+        inline entt::entity             getEntity(uint32_t node) const;
+        inline const InstanceTransform& getWorld(uint32_t node) const;
+
+        // World transform at shutter close, the one at shutter open while no entity holds a Motion
+        inline const InstanceTransform& getCloseWorld(uint32_t node) const;
+
+        // Nodes whose world transform was evaluated by the last update
+        inline vzt::CSpan<uint32_t> getUpdatedNodes() const;
+
+      private:
+        // Minimal count of dirty nodes of a level for it to be split across threads
+        static constexpr std::size_t ParallelNodeNb = 16384;
+
+        static constexpr uint8_t Pending = 1 << 0; // Patched since the last update
+        static constexpr uint8_t Visited = 1 << 1; // Reached by the traversal of a dirty subtree
+
+        using Positions = std::array<std::vector<float>, 3>;
+        using Rotations = std::array<std::vector<float>, 4>; // x, y, z, w
+
+        static void setLocal(uint32_t node, const Transform& transform, Positions& positions, Rotations& rotations);
+
+        void onConstruct(entt::registry& registry, entt::entity entity);
+        void onDestroy(entt::registry& registry, entt::entity entity);
+        void onUpdate(entt::registry& registry, entt::entity entity);
+        void onStructureUpdate(entt::registry& registry, entt::entity entity);
+        void onMotionConstruct(entt::registry& registry, entt::entity entity);
+        void onMotionDestroy(entt::registry& registry, entt::entity entity);
+        void onMotionUpdate(entt::registry& registry, entt::entity entity);
+
+        void markPending(uint32_t node);
+
+        // Sorts the nodes by depth and links them to their parent and children
+        void sort();
+
+        // World transforms of the given nodes of a level, whose parents are up to date
+        void evaluateLevel(const uint32_t* nodes, std::size_t nodeNb, uint32_t threadCount);
+        void evaluate(const uint32_t* nodes, std::size_t nodeNb);
+        void evaluate(const uint32_t* nodes, std::size_t nodeNb, const Positions& positions, const Rotations& rotations,
+                      std::vector<InstanceTransform>& worlds) const;
+
+        entt::registry* m_registry;
+        bool            m_outdated = false; // Nodes must be sorted again
+        uint32_t        m_motionNb = 0;     // Entities holding a Motion
+
+        // Node of each entity, indexed by entity identifier
+        std::vector<uint32_t> m_nodes;
+
+        std::vector<entt::entity>      m_entities;
+        std::vector<uint32_t>          m_parents;
+        std::vector<uint32_t>          m_depths;
+        std::vector<uint8_t>           m_flags;
+        Positions                      m_positions;
+        Rotations                      m_rotations;
+        std::vector<InstanceTransform> m_worlds;
+
+        // Local and world transforms at shutter close
+        Positions                      m_closePositions;
+        Rotations                      m_closeRotations;
+        std::vector<InstanceTransform> m_closeWorlds;
+
+        // Children of each node, and first node of each level
+        std::vector<uint32_t> m_childOffsets;
+        std::vector<uint32_t> m_children;
+        std::vector<uint32_t> m_levelOffsets;
+
+        std::vector<uint32_t>              m_pending;
+        std::vector<std::vector<uint32_t>> m_levels;
+        std::vector<uint32_t>              m_updated;
+    };
+} // namespace lop
+
+#include "lop/System/Hierarchy.inl"
+
+#endif // LOP_SYSTEM_HIERARCHY_HPP
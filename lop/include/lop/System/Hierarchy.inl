@@ -0,0 +1,27 @@
+#include "lop/System/Hierarchy.hpp"
+
+namespace lop
+{
+    inline uint32_t TransformHierarchy::getNodeNb() const { return static_cast<uint32_t>(m_entities.size()); }
+    inline uint32_t TransformHierarchy::getLevelNb() const
+    {
+        return m_levelOffsets.empty() ? 0 : static_cast<uint32_t>(m_levelOffsets.size() - 1);
+    }
+
+    inline uint32_t TransformHierarchy::getNode(entt::entity entity) const
+    {
+        const std::size_t id = static_cast<std::size_t>(entt::to_entity(entity));
+        if (id >= m_nodes.size() || m_nodes[id] == NoNode || m_entities[m_nodes[id]] != entity)
+            return NoNode;
+        return m_nodes[id];
+    }
+
+    inline entt::entity             TransformHierarchy::getEntity(uint32_t node) const { return m_entities[node]; }
+    inline const InstanceTransform& TransformHierarchy::getWorld(uint32_t node) const { return m_worlds[node]; }
+    inline const InstanceTransform& TransformHierarchy::getCloseWorld(uint32_t node) const
+    {
+        return m_motionNb != 0 ? m_closeWorlds[node] : m_worlds[node];
+    }
+
+    inline vzt::CSpan<uint32_t> TransformHierarchy::getUpdatedNodes() const { return m_updated; }
+} // namespace lop
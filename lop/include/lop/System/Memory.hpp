@@ -0,0 +1,13 @@
+#ifndef LOP_SYSTEM_MEMORY_HPP
+#define LOP_SYSTEM_MEMORY_HPP
+
+#include <cstdint>
+
+namespace lop
+{
+    // Allocations made through the global operator new since the start of the process. The operators are replaced by
+    // the executable linking Memory.cpp, allocations made with malloc or by drivers are not counted.
+    uint64_t getHeapAllocationNb();
+} // namespace lop
+
+#endif // LOP_SYSTEM_MEMORY_HPP
@@ -0,0 +1,18 @@
+#ifndef LOP_SYSTEM_PARALLEL_HPP
+#define LOP_SYSTEM_PARALLEL_HPP
+
+#include <cstdint>
+
+namespace lop
+{
+    // Every hardware thread when threadCount is 0
+    inline uint32_t getThreadCount(uint32_t threadCount = 0);
+
+    // Calls task(y) for every row of [0, height), split in contiguous ranges across threadCount threads
+    template <class Task>
+    void parallelRows(uint32_t height, uint32_t threadCount, Task&& task);
+} // namespace lop
+
+#include "lop/System/Parallel.inl"
+
+#endif // LOP_SYSTEM_PARALLEL_HPP
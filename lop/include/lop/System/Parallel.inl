@@ -0,0 +1,38 @@
+#include "lop/System/Parallel.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace lop
+{
+    inline uint32_t getThreadCount(uint32_t threadCount)
+    {
+        return threadCount == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threadCount;
+    }
+
+    template <class Task>
+    void parallelRows(uint32_t height, uint32_t threadCount, Task&& task)
+    {
+        threadCount                  = getThreadCount(threadCount);
+        const uint32_t rowsPerThread = (height + threadCount - 1) / threadCount;
+
+        std::vector<std::thread> threads{};
+        threads.reserve(threadCount);
+        for (uint32_t t = 0; t < threadCount; t++)
+        {
+            const uint32_t begin = t * rowsPerThread;
+            const uint32_t end   = std::min(height, begin + rowsPerThread);
+            if (begin >= end)
+                break;
+
+            threads.emplace_back([&task, begin, end]() {
+                for (uint32_t y = begin; y < end; y++)
+                    task(y);
+            });
+        }
+
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+} // namespace lop
@@ -0,0 +1,97 @@
+#ifndef LOP_SYSTEM_PROFILER_HPP
+#define LOP_SYSTEM_PROFILER_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <vzt/Core/File.hpp>
+
+namespace lop
+{
+    // Fixed size circular storage keeping the last <Capacity> pushed values
+    template <class Type, std::size_t Capacity>
+    class RingBuffer
+    {
+      public:
+        inline void push(Type value);
+
+        // Index 0 is the oldest value currently stored
+        inline Type        operator[](std::size_t i) const;
+        inline std::size_t size() const;
+        inline Type        back() const;
+
+        // Raw storage and index of the oldest value, matching ImGui::PlotLines' values_offset
+        inline const Type* data() const;
+        inline std::size_t offset() const;
+
+      private:
+        std::array<Type, Capacity> m_data{};
+        std::size_t                m_head = 0;
+        std::size_t                m_size = 0;
+    };
+
+    struct TimingStatistics
+    {
+        float       last    = 0.f;
+        float       average = 0.f;
+        float       min     = 0.f;
+        float       max     = 0.f;
+        std::size_t count   = 0;
+    };
+
+    struct TimingSeries
+    {
+        static constexpr std::size_t WindowSize = 256;
+
+        RingBuffer<float, WindowSize> samples; // Milliseconds
+        std::size_t                   total = 0;
+
+        TimingStatistics getStatistics() const;
+    };
+
+    class Profiler
+    {
+      public:
+        // CPU timers are spread across the renderer, hence a process wide instance
+        static Profiler& get();
+
+        void             record(std::string_view name, float milliseconds);
+        TimingStatistics getStatistics(std::string_view name) const;
+        void clear();
+
+        template <class Callback>
+        void forEach(Callback&& callback) const;
+
+        // Write all series as JSON or CSV depending on the path extension
+        bool dump(const vzt::Path& path) const;
+
+      private:
+        mutable std::mutex                                m_mutex;
+        std::map<std::string, TimingSeries, std::less<>> m_series;
+    };
+
+    class ScopedTimer
+    {
+      public:
+        explicit ScopedTimer(std::string_view name);
+        ~ScopedTimer();
+
+        ScopedTimer(const ScopedTimer&)            = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+      private:
+        using Clock = std::chrono::steady_clock;
+
+        std::string_view  m_name;
+        Clock::time_point m_start;
+    };
+} // namespace lop
+
+#include "lop/System/Profiler.inl"
+
+#endif // LOP_SYSTEM_PROFILER_HPP
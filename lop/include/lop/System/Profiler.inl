@@ -0,0 +1,50 @@
+#include "lop/System/Profiler.hpp"
+
+namespace lop
+{
+    template <class Type, std::size_t Capacity>
+    inline void RingBuffer<Type, Capacity>::push(Type value)
+    {
+        m_data[m_head] = value;
+        m_head         = (m_head + 1) % Capacity;
+        m_size         = std::min(m_size + 1, Capacity);
+    }
+
+    template <class Type, std::size_t Capacity>
+    inline Type RingBuffer<Type, Capacity>::operator[](std::size_t i) const
+    {
+        return m_data[(offset() + i) % Capacity];
+    }
+
+    template <class Type, std::size_t Capacity>
+    inline std::size_t RingBuffer<Type, Capacity>::size() const
+    {
+        return m_size;
+    }
+
+    template <class Type, std::size_t Capacity>
+    inline Type RingBuffer<Type, Capacity>::back() const
+    {
+        return m_data[(m_head + Capacity - 1) % Capacity];
+    }
+
+    template <class Type, std::size_t Capacity>
+    inline const Type* RingBuffer<Type, Capacity>::data() const
+    {
+        return m_data.data();
+    }
+
+    template <class Type, std::size_t Capacity>
+    inline std::size_t RingBuffer<Type, Capacity>::offset() const
+    {
+        return m_size < Capacity ? 0 : m_head;
+    }
+
+    template <class Callback>
+    void Profiler::forEach(Callback&& callback) const
+    {
+        std::lock_guard lock{m_mutex};
+        for (const auto& [name, series] : m_series)
+            callback(std::string_view(name), series);
+    }
+} // namespace lop
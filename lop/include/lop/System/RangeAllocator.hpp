@@ -0,0 +1,97 @@
+#ifndef LOP_SYSTEM_RANGEALLOCATOR_HPP
+#define LOP_SYSTEM_RANGEALLOCATOR_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace lop
+{
+    struct Range
+    {
+        static constexpr uint32_t Invalid = ~0u;
+
+        uint64_t offset = 0;
+        uint64_t size   = 0;
+        uint32_t node   = Invalid;
+
+        inline bool isValid() const;
+    };
+
+    struct RangeStatistics
+    {
+        uint64_t allocationNb = 0;
+        uint64_t capacity     = 0;
+        uint64_t used         = 0;
+        uint64_t largestFree  = 0;
+
+        // 0 when the free space is contiguous, close to 1 when it is split in many small ranges
+        inline double getFragmentation() const;
+
+        RangeStatistics& operator+=(const RangeStatistics& other);
+    };
+
+    // Two-level segregated fit allocator of offsets in [0, capacity), without any backing memory. Allocation and
+    // release are O(1): free ranges are binned by size with bitmaps and merged with their free neighbours on release.
+    // Offsets and sizes are multiples of the granularity, which must be a power of two.
+    // Reference: TLSF: a New Dynamic Memory Allocator for Real-Time Systems, Masmano et al., 2004
+    class RangeAllocator
+    {
+      public:
+        RangeAllocator() = default;
+        RangeAllocator(uint64_t capacity, uint64_t granularity = 256);
+
+        // Invalid range when no free range is large enough
+        Range allocate(uint64_t size);
+        void  release(Range range);
+
+        inline uint64_t getCapacity() const;
+        inline uint64_t getGranularity() const;
+        inline bool     isEmpty() const;
+        RangeStatistics getStatistics() const;
+
+      private:
+        static constexpr uint32_t SecondLevelBits = 4;
+        static constexpr uint32_t SecondLevelNb   = 1u << SecondLevelBits;
+        static constexpr uint32_t FirstLevelNb    = 64 - SecondLevelBits + 1;
+        static constexpr uint32_t None            = ~0u;
+
+        // Offsets and sizes are in granularity units
+        struct Node
+        {
+            uint64_t offset = 0;
+            uint64_t size   = 0;
+
+            // Physical neighbours, then neighbours in the free list of the bin
+            uint32_t previous     = None;
+            uint32_t next         = None;
+            uint32_t previousFree = None;
+            uint32_t nextFree     = None;
+            bool     free         = false;
+        };
+
+        static void getBin(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+        uint32_t createNode(uint64_t offset, uint64_t size);
+        void     insertFree(uint32_t node);
+        void     removeFree(uint32_t node);
+        uint32_t findFree(uint64_t size) const;
+
+        uint64_t m_capacity    = 0;
+        uint64_t m_granularity = 1;
+        uint64_t m_used        = 0;
+        uint64_t m_allocations = 0;
+
+        // Heads of the free lists of each bin, and bitmaps of the non-empty ones
+        uint64_t                                           m_firstLevelBitmap = 0;
+        std::array<uint32_t, FirstLevelNb>                 m_secondLevelBitmaps{};
+        std::array<uint32_t, FirstLevelNb * SecondLevelNb> m_bins{};
+
+        std::vector<Node>     m_nodes;
+        std::vector<uint32_t> m_unusedNodes;
+    };
+} // namespace lop
+
+#include "lop/System/RangeAllocator.inl"
+
+#endif // LOP_SYSTEM_RANGEALLOCATOR_HPP
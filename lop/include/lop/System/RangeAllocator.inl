@@ -0,0 +1,18 @@
+#include "lop/System/RangeAllocator.hpp"
+
+namespace lop
+{
+    inline bool Range::isValid() const { return node != Invalid; }
+
+    inline double RangeStatistics::getFragmentation() const
+    {
+        const uint64_t available = capacity - used;
+        if (available == 0)
+            return 0.;
+        return 1. - static_cast<double>(largestFree) / static_cast<double>(available);
+    }
+
+    inline uint64_t RangeAllocator::getCapacity() const { return m_capacity; }
+    inline uint64_t RangeAllocator::getGranularity() const { return m_granularity; }
+    inline bool     RangeAllocator::isEmpty() const { return m_allocations == 0; }
+} // namespace lop
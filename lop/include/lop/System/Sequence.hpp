@@ -0,0 +1,69 @@
+#ifndef LOP_SYSTEM_SEQUENCE_HPP
+#define LOP_SYSTEM_SEQUENCE_HPP
+
+#include <string>
+#include <vector>
+
+#include <entt/entt.hpp>
+#include <vzt/Core/File.hpp>
+
+#include "lop/System/Transform.hpp"
+
+namespace lop
+{
+    struct Keyframe
+    {
+        float     time = 0.f; // In seconds
+        Transform transform{};
+    };
+
+    // Transform interpolated between keyframes sorted by time: linearly for positions and along the shortest arc for
+    // rotations. It is held constant before the first and after the last keyframe.
+    struct TransformTrack
+    {
+        std::vector<Keyframe> keyframes;
+
+        // Inserted after the keyframes of the same time
+        void add(float time, const Transform& transform);
+
+        inline bool isEmpty() const;
+        Transform   evaluate(float time) const;
+
+        // Full turn of start around Transform::Up over duration, keyed every quarter turn
+        static TransformTrack turntable(const Transform& start, float duration);
+    };
+
+    // Drives the Transform of its entity during a Sequence
+    struct Animation
+    {
+        TransformTrack track;
+    };
+
+    // Fixed frame rate animation of the camera and of the entities holding an Animation
+    struct Sequence
+    {
+        uint32_t frameNb   = 1;
+        float    frameRate = 24.f;
+
+        // Fraction of the frame interval during which the shutter is open, 0 disables motion blur
+        float shutter = 0.f;
+
+        TransformTrack camera;
+
+        inline float getTime(uint32_t frame) const;
+        inline float getDuration() const;
+
+        // Sets the Transform of the animated entities at the shutter opening of the frame, and their Motion at its
+        // closing when they move while it is open. Entities whose components are unchanged are not patched, so that
+        // the rest of the scene is kept by the next update. Returns the number of patched entities.
+        uint32_t apply(entt::registry& registry, uint32_t frame) const;
+    };
+
+    // Pattern whose last run of '#' is replaced by the zero-padded frame number, or whose file name is suffixed by a
+    // 4 digits one when it has none
+    vzt::Path getFramePath(const std::string& pattern, uint32_t frame);
+} // namespace lop
+
+#include "lop/System/Sequence.inl"
+
+#endif // LOP_SYSTEM_SEQUENCE_HPP
@@ -0,0 +1,9 @@
+#include "lop/System/Sequence.hpp"
+
+namespace lop
+{
+    inline bool TransformTrack::isEmpty() const { return keyframes.empty(); }
+
+    inline float Sequence::getTime(uint32_t frame) const { return static_cast<float>(frame) / frameRate; }
+    inline float Sequence::getDuration() const { return static_cast<float>(frameNb) / frameRate; }
+} // namespace lop
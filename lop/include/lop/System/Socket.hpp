@@ -0,0 +1,75 @@
+#ifndef LOP_SYSTEM_SOCKET_HPP
+#define LOP_SYSTEM_SOCKET_HPP
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace lop
+{
+    // Blocking TCP connection with keepalive, closed on destruction. Values are sent in the byte order of the host,
+    // both ends are expected to share it.
+    class Socket
+    {
+      public:
+        Socket() = default;
+
+        // Invalid when the host can not be reached
+        static Socket connect(const std::string& host, uint16_t port);
+
+        Socket(const Socket&)            = delete;
+        Socket& operator=(const Socket&) = delete;
+
+        Socket(Socket&& other) noexcept;
+        Socket& operator=(Socket&& other) noexcept;
+
+        ~Socket();
+
+        inline bool isValid() const;
+
+        // Transfers taking longer fail as if the connection was lost, 0 waits indefinitely
+        bool setTimeout(float seconds);
+
+        // Transfer exactly size bytes, false once the connection is lost or timed out
+        bool send(const void* data, std::size_t size);
+        bool receive(void* data, std::size_t size);
+
+        template <class Type>
+        bool send(const Type& value);
+        template <class Type>
+        bool receive(Type& value);
+
+      private:
+        friend class Listener;
+
+        static constexpr intptr_t Invalid = -1;
+
+        explicit Socket(intptr_t handle);
+
+        intptr_t m_handle = Invalid;
+    };
+
+    // Accepts TCP connections on every interface
+    class Listener
+    {
+      public:
+        Listener(uint16_t port);
+
+        Listener(const Listener&)            = delete;
+        Listener& operator=(const Listener&) = delete;
+
+        ~Listener();
+
+        inline bool isValid() const;
+
+        // Blocks until a peer connects or for at most timeout seconds when it is not 0, invalid on failure
+        Socket accept(float timeout = 0.f);
+
+      private:
+        Socket m_socket;
+    };
+} // namespace lop
+
+#include "lop/System/Socket.inl"
+
+#endif // LOP_SYSTEM_SOCKET_HPP
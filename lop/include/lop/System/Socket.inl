@@ -0,0 +1,22 @@
+#include "lop/System/Socket.hpp"
+
+namespace lop
+{
+    inline bool Socket::isValid() const { return m_handle != Invalid; }
+
+    template <class Type>
+    bool Socket::send(const Type& value)
+    {
+        static_assert(std::is_trivially_copyable_v<Type>, "Values are sent as raw bytes");
+        return send(&value, sizeof(Type));
+    }
+
+    template <class Type>
+    bool Socket::receive(Type& value)
+    {
+        static_assert(std::is_trivially_copyable_v<Type>, "Values are received as raw bytes");
+        return receive(&value, sizeof(Type));
+    }
+
+    inline bool Listener::isValid() const { return m_socket.isValid(); }
+} // namespace lop
@@ -3,6 +3,8 @@
 
 #include <entt/entt.hpp>
 
+#include "lop/System/Hierarchy.hpp"
+
 namespace lop
 {
     struct Name
@@ -12,8 +14,10 @@ namespace lop
 
     struct System
     {
-        entt::registry registry;
-        entt::handle   create() { return entt::handle{registry, registry.create()}; }
+        entt::registry     registry;
+        TransformHierarchy hierarchy{registry};
+
+        entt::handle create() { return entt::handle{registry, registry.create()}; }
     };
 } // namespace lop
 
@@ -22,6 +22,26 @@ namespace lop
 
         void lookAt(const vzt::Vec3& target);
     };
+
+    // Local transform of a moving entity at shutter close, its Transform being the one at shutter open
+    struct Motion
+    {
+        Transform close{};
+    };
+
+    // Row-major 3x4 affine transformation, with the layout of VkTransformMatrixKHR
+    struct InstanceTransform
+    {
+        float rows[3][4];
+
+        static inline InstanceTransform from(const Transform& transform);
+        static inline InstanceTransform compose(const InstanceTransform& parent, const InstanceTransform& child);
+
+        // Rigid transformation at t in [0, 1] between a and b, rotations being interpolated along the shortest arc
+        static inline InstanceTransform interpolate(const InstanceTransform& a, const InstanceTransform& b, float t);
+
+        inline vzt::Vec3 apply(const vzt::Vec3& position) const;
+    };
 } // namespace lop
 
 #include "lop/System/Transform.inl"
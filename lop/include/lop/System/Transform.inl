@@ -18,4 +18,62 @@ namespace lop
     inline void Transform::rotate(const vzt::Vec3 angles) { rotation *= glm::quat(angles); }
 
     inline void Transform::translate(const vzt::Vec3& t) { position += t; }
+
+    inline InstanceTransform InstanceTransform::from(const Transform& transform)
+    {
+        // glm is column major, rotation[c][r]
+        const glm::mat3  rotation = glm::mat3_cast(transform.rotation);
+        const vzt::Vec3& p        = transform.position;
+        return InstanceTransform{{
+            {rotation[0][0], rotation[1][0], rotation[2][0], p.x},
+            {rotation[0][1], rotation[1][1], rotation[2][1], p.y},
+            {rotation[0][2], rotation[1][2], rotation[2][2], p.z},
+        }};
+    }
+
+    inline vzt::Vec3 InstanceTransform::apply(const vzt::Vec3& position) const
+    {
+        vzt::Vec3 result;
+        for (uint32_t i = 0; i < 3; i++)
+            result[i] = rows[i][0] * position.x + rows[i][1] * position.y + rows[i][2] * position.z + rows[i][3];
+        return result;
+    }
+
+    inline InstanceTransform InstanceTransform::compose(const InstanceTransform& parent, const InstanceTransform& child)
+    {
+        InstanceTransform result;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            for (uint32_t j = 0; j < 4; j++)
+            {
+                result.rows[i][j] = parent.rows[i][0] * child.rows[0][j] + parent.rows[i][1] * child.rows[1][j] +
+                                    parent.rows[i][2] * child.rows[2][j];
+            }
+
+            result.rows[i][3] += parent.rows[i][3];
+        }
+
+        return result;
+    }
+
+    inline InstanceTransform InstanceTransform::interpolate(const InstanceTransform& a, const InstanceTransform& b,
+                                                            float t)
+    {
+        const auto getRotation = [](const InstanceTransform& transform) {
+            glm::mat3 rotation;
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                for (uint32_t r = 0; r < 3; r++)
+                    rotation[c][r] = transform.rows[r][c];
+            }
+            return glm::quat_cast(rotation);
+        };
+
+        Transform transform{};
+        transform.rotation = glm::slerp(getRotation(a), getRotation(b), t);
+        for (uint32_t i = 0; i < 3; i++)
+            transform.position[i] = a.rows[i][3] + (b.rows[i][3] - a.rows[i][3]) * t;
+
+        return from(transform);
+    }
 } // namespace lop
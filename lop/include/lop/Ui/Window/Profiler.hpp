@@ -0,0 +1,20 @@
+#ifndef LOP_UI_WINDOW_PROFILER_HPP
+#define LOP_UI_WINDOW_PROFILER_HPP
+
+#include <string>
+
+namespace lop
+{
+    class Profiler;
+
+    class ProfilerWindow
+    {
+      public:
+        void render(Profiler& profiler);
+
+      private:
+        std::string m_dumpFile = "";
+    };
+} // namespace lop
+
+#endif // LOP_UI_WINDOW_PROFILER_HPP
@@ -15,4 +15,41 @@ vec3 tonemapACES(vec3 x)
     return (x * (a * x + b)) / (x * (c * x + d) + e);
 }
 
+// Luminance-based Reinhard, preserves the hue of saturated colors
+vec3 tonemapReinhard(vec3 x) { return x / (1. + getLuminance(x)); }
+
+// Reference: https://iolite-engine.com/blog_posts/minimal_agx_implementation
+vec3 agxDefaultContrastApproximation(vec3 x)
+{
+    const vec3 x2 = x * x;
+    const vec3 x4 = x2 * x2;
+    return 15.5 * x4 * x2 - 40.14 * x4 * x + 31.96 * x4 - 6.868 * x2 * x + 0.4298 * x2 + 0.1191 * x - 0.00232;
+}
+
+vec3 tonemapAgX(vec3 x)
+{
+    const mat3 inset = mat3(0.842479062253094, 0.0423282422610123, 0.0423756549057051, //
+                            0.0784335999999992, 0.878468636469772, 0.0784336,          //
+                            0.0792237451477643, 0.0791661274605434, 0.879142973793104);
+    const mat3 outset = mat3(1.19687900512017, -0.0528968517574562, -0.0529716355144438, //
+                             -0.0980208811401368, 1.15190312990417, -0.0980434501171241, //
+                             -0.0990297440797205, -0.0989611768448433, 1.15107367264116);
+
+    const float minEv = -12.47393;
+    const float maxEv = 4.026069;
+
+    x = clamp(log2(max(inset * x, vec3(1e-10))), minEv, maxEv);
+    x = agxDefaultContrastApproximation((x - minEv) / (maxEv - minEv));
+
+    // The curve outputs display encoded values, decoded to stay comparable with the other operators
+    return pow(max(outset * x, vec3(0.)), vec3(2.2));
+}
+
+// IEC 61966-2-1 encoding
+vec3 linearToSrgb(vec3 x)
+{
+    x = clamp(x, vec3(0.), vec3(1.));
+    return mix(12.92 * x, 1.055 * pow(x, vec3(1. / 2.4)) - 0.055, greaterThan(x, vec3(0.0031308)));
+}
+
 #endif // SHADERS_LOP_COLOR_GLSL
\ No newline at end of file
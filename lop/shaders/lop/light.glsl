@@ -0,0 +1,92 @@
+#ifndef SHADERS_LOP_LIGHT_GLSL
+#define SHADERS_LOP_LIGHT_GLSL
+
+// World space emissive triangle, must match lop::EmissiveTriangle
+struct EmissiveTriangle
+{
+    vec3  p0;
+    float area;
+    vec3  p1;
+    float pad0;
+    vec3  p2;
+    float pad1;
+    vec3  emission;
+    float pad2;
+};
+
+// Must match lop::LightTreeNode
+struct LightTreeNode
+{
+    vec3  min;
+    float power;
+    vec3  max;
+    float cosTheta;
+    vec3  axis;
+    uint  childOrLight;
+    uint  leaf;
+    uint  pad0;
+    uint  pad1;
+    uint  pad2;
+};
+
+// cos(max(0, a - b)) and sin(max(0, a - b)) from the sines and cosines of a and b
+float cosSubClamped(float sinA, float cosA, float sinB, float cosB)
+{
+    return cosA > cosB ? 1. : cosA * cosB + sinA * sinB;
+}
+
+float sinSubClamped(float sinA, float cosA, float sinB, float cosB)
+{
+    return cosA > cosB ? 0. : sinA * cosB - cosA * sinB;
+}
+
+// Upper bound of the contribution of the lights of a node to a shading point, see lop::getImportance
+float getImportance(LightTreeNode node, vec3 p, vec3 n)
+{
+    const vec3  center   = (node.min + node.max) * .5;
+    const float radius   = length(node.max - node.min) * .5;
+    const vec3  toPoint  = p - center;
+    const float distance = length(toPoint);
+
+    const float d2 = max(distance * distance, radius);
+    const vec3  wi = distance > 0. ? toPoint / distance : n;
+
+    const float cosW = abs(dot(node.axis, wi));
+    const float sinW = sqrt(max(0., 1. - cosW * cosW));
+
+    const float cosB = distance > radius ? sqrt(max(0., 1. - radius * radius / (distance * distance))) : -1.;
+    const float sinB = sqrt(max(0., 1. - cosB * cosB));
+
+    const float sinO = sqrt(max(0., 1. - node.cosTheta * node.cosTheta));
+    const float cosX = cosSubClamped(sinW, cosW, sinO, node.cosTheta);
+    const float sinX = sinSubClamped(sinW, cosW, sinO, node.cosTheta);
+
+    const float cosThetaP = cosSubClamped(sinX, cosX, sinB, cosB);
+    if (cosThetaP <= 0.)
+        return 0.;
+
+    const float cosI      = abs(dot(wi, n));
+    const float sinI      = sqrt(max(0., 1. - cosI * cosI));
+    const float cosThetaI = cosSubClamped(sinI, cosI, sinB, cosB);
+
+    return max(0., node.power * cosThetaP * cosThetaI / d2);
+}
+
+// Uniformly distributed point of the triangle
+// Reference: Shape distributions, Osada et al., 2002, Section 4.2
+vec3 sampleTriangle(EmissiveTriangle triangle, vec2 u)
+{
+    const float su = sqrt(u.x);
+    return (1. - su) * triangle.p0 + su * (1. - u.y) * triangle.p1 + su * u.y * triangle.p2;
+}
+
+// Solid angle density of a uniform sample of the triangle, seen at the given distance along wi. Emitters are
+// two-sided, as when they are hit by a path.
+float getPdfTriangle(EmissiveTriangle triangle, vec3 wi, float distance)
+{
+    const vec3  n        = normalize(cross(triangle.p1 - triangle.p0, triangle.p2 - triangle.p0));
+    const float cosTheta = abs(dot(n, wi));
+    return distance * distance / max(1e-8, cosTheta * triangle.area);
+}
+
+#endif // SHADERS_LOP_LIGHT_GLSL
@@ -33,6 +33,27 @@ struct Material
 #include "lop/brdf/fresnel.glsl"
 #include "lop/brdf/specular.glsl"
 
+// Kernel variants built for scenes without these features define them to 0
+#ifndef LOP_TRANSMISSION
+#define LOP_TRANSMISSION 1
+#endif
+
+#ifndef LOP_CLEARCOAT
+#define LOP_CLEARCOAT 1
+#endif
+
+// Zeroes the features disabled by the kernel variant so that the compiler folds their branches away
+Material specializeMaterial(Material material)
+{
+#if !LOP_TRANSMISSION
+    material.specularTransmission = 0.;
+#endif
+#if !LOP_CLEARCOAT
+    material.clearcoat = 0.;
+#endif
+    return material;
+}
+
 // For all functions, every vectors must be in shading normal space, and n must be (0, 0, 1)
 
 vec3 evalMaterial(Material material, vec3 wo, vec3 wi, float t)
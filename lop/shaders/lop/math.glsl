@@ -4,6 +4,9 @@
 const float Pi        = 3.1415;
 const float OneOverPi = 1. / 3.1415;
 
+// Largest float below 1
+const float OneMinusEpsilon = 0.99999994;
+
 float pow2(float v) { return v * v; }
 
 vec4 quaternion(float angle, vec3 axis)
@@ -37,4 +40,23 @@ vec4 toLocal(vec3 n, vec3 ref)
 
 vec4 toLocalZ(vec3 n) { return toLocal(n, vec3(0., 0., 1.)); }
 
+// Octahedral mapping of a unit vector to [-1, 1]^2
+vec2 encodeOctahedral(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z >= 0.)
+        return n.xy;
+
+    return (1. - abs(n.yx)) * vec2(n.x >= 0. ? 1. : -1., n.y >= 0. ? 1. : -1.);
+}
+
+vec3 decodeOctahedral(vec2 p)
+{
+    vec3        n = vec3(p, 1. - abs(p.x) - abs(p.y));
+    const float t = max(-n.z, 0.);
+    n.x += n.x >= 0. ? -t : t;
+    n.y += n.y >= 0. ? -t : t;
+    return normalize(n);
+}
+
 #endif // SHADERS_LOP_MATH_GLSL
\ No newline at end of file
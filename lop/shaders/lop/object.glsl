@@ -1,10 +1,15 @@
 #ifndef SHADERS_LOP_OBJECT_GLSL
 #define SHADERS_LOP_OBJECT_GLSL
 
+// Must match lop::ObjectDescription
 struct Object
 {
     uint64_t vertexBuffer;
     uint64_t indexBuffer;
+    uint     lightOffset; // Index of the first triangle in the light list, NoLight if the object is not a light
+    uint     pad;
 };
 
+const uint NoLight = ~0u;
+
 #endif // SHADERS_LOP_OBJECT_GLSL
\ No newline at end of file
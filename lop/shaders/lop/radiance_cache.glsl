@@ -0,0 +1,47 @@
+#ifndef SHADERS_LOP_RADIANCE_CACHE_GLSL
+#define SHADERS_LOP_RADIANCE_CACHE_GLSL
+
+#include "lop/random.glsl"
+
+// Must match lop::RadianceCacheMode
+const uint RadianceCacheDisabled   = 0;
+const uint RadianceCacheEnabled    = 1;
+const uint RadianceCacheValidation = 2;
+
+// Samples are accumulated in fixed point with integer atomics, each of them being clamped to avoid overflows
+const float RadianceCacheScale       = 256.;
+const float RadianceCacheMaxRadiance = 64.;
+
+// Cells must gather this many samples before being looked up, the running average is limited to the last ones
+const float RadianceCacheMinSampleNb = 8.;
+const float RadianceCacheMaxSampleNb = 1024.;
+
+// Length of the linear probing sequence of a cell, it is dropped when every entry is taken by other cells
+const uint RadianceCacheProbeNb = 8;
+
+// One path out of RadianceCacheTrainingRatio is traced entirely to update the cache with its first vertices
+const uint RadianceCacheTrainingRatio = 16;
+const uint RadianceCacheVertexNb      = 8;
+
+// Validation sums are accumulated in fixed point, the luminance of each sample being clamped
+const float RadianceCacheValidationScale        = 256.;
+const float RadianceCacheValidationMaxLuminance = 16.;
+
+// Hash of the cell holding p, whose size doubles with each power of two of the distance to the camera. The checksum
+// identifies the cell among the ones sharing its first entry and is never 0, which marks an empty entry.
+uint getRadianceCacheCell(vec3 p, vec3 n, vec3 camera, float cellSize, out uint checksum)
+{
+    const float level = clamp(floor(log2(max(1., distance(p, camera)))), 0., 15.);
+    const ivec3 cell  = ivec3(floor(p / (cellSize * exp2(level))));
+
+    // Dominant axis of the normal and its sign
+    const vec3 an   = abs(n);
+    const uint axis = an.x > an.y ? (an.x > an.z ? 0u : 2u) : (an.y > an.z ? 1u : 2u);
+    const uint side = n[axis] < 0. ? 1u : 0u;
+
+    const uvec4 h = pcg4d(uvec4(uvec3(cell), uint(level) | ((axis * 2u + side) << 4u)));
+    checksum      = max(h.y, 1u);
+    return h.x;
+}
+
+#endif // SHADERS_LOP_RADIANCE_CACHE_GLSL
@@ -27,11 +27,14 @@ uvec4 pcg4d(uvec4 v)
 // Converts unsigned integer into float int range <0; 1) by using 23 most significant bits for mantissa
 vec4 uintToFloat(uvec4 x) { return uintBitsToFloat(0x3f800000 | (x >> 9)) - 1.0f; }
 
+// lop/sampler.glsl provides its own prng when included first
+#ifndef LOP_SAMPLER_PRNG
 vec4 prng(inout uvec4 p)
 {
     p.w++;
     return uintToFloat(pcg4d(p));
 }
+#endif // LOP_SAMPLER_PRNG
 
 uint lcg(inout uint prev)
 {
@@ -11,6 +11,8 @@ struct HitInfo
     float t;
     vec3  shadingNormal;
     vec3  geometricNormal;
+    uint  instanceId;
+    uint  primitiveId;
     bool  hit;
 };
 
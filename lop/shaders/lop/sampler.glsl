@@ -0,0 +1,126 @@
+#ifndef SHADERS_LOP_SAMPLER_GLSL
+#define SHADERS_LOP_SAMPLER_GLSL
+
+// Replaces the white noise prng of random.glsl by the sequence given by getSequence(), which must be defined first.
+// Every call to prng(p) draws the next 4 dimensions of the sample p.z of pixel p.xy, p.w being the dimension counter.
+#define LOP_SAMPLER_PRNG
+#include "lop/random.glsl"
+
+// Must match lop::SampleSequence
+#define SequencePcg   0
+#define SequenceSobol 1
+#define SequenceRank1 2
+
+#define SobolDimensions 4
+#define BlueNoiseSize   64
+
+// Must match lop::SamplerTables
+layout(binding = 9, set = 0, scalar) readonly buffer SamplerTables
+{
+    uint sobolMatrices[SobolDimensions * 32];
+    uint rank1Generator[4];
+    uint blueNoise[BlueNoiseSize * BlueNoiseSize];
+} samplerTables;
+
+// Reference: Practical Hash-based Owen Scrambling. Brent Burley (2020).
+// Journal of Computer Graphics Techniques (JCGT), 9(4), 1-20.
+uint hashCombine(uint seed, uint v) { return seed ^ (v + (seed << 6) + (seed >> 2)); }
+
+// MurmurHash3 finalizer
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x85ebca6bu;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35u;
+    x ^= x >> 16;
+    return x;
+}
+
+uint laineKarrasPermutation(uint x, uint seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+// Owen scrambling: each bit is flipped depending only on the more significant ones
+uint nestedUniformScramble(uint x, uint seed)
+{
+    x = bitfieldReverse(x);
+    x = laineKarrasPermutation(x, seed);
+    x = bitfieldReverse(x);
+    return x;
+}
+
+uvec4 sobol4d(uint index)
+{
+    uvec4 x = uvec4(0u);
+    for (uint bit = 0; index != 0u; bit++, index >>= 1u)
+    {
+        if ((index & 1u) == 0u)
+            continue;
+
+        x.x ^= samplerTables.sobolMatrices[0 * 32 + bit];
+        x.y ^= samplerTables.sobolMatrices[1 * 32 + bit];
+        x.z ^= samplerTables.sobolMatrices[2 * 32 + bit];
+        x.w ^= samplerTables.sobolMatrices[3 * 32 + bit];
+    }
+
+    return x;
+}
+
+// Sobol points are shuffled per dimension set so that consecutive sets stay uncorrelated, then Owen scrambled.
+vec4 sampleSobol(uvec4 p)
+{
+    const uint seed  = hashCombine(hash(p.x + (p.y << 16)), hash(p.w));
+    const uint index = nestedUniformScramble(p.z, seed);
+
+    uvec4 x = sobol4d(index);
+    x.x     = nestedUniformScramble(x.x, hashCombine(seed, 0u));
+    x.y     = nestedUniformScramble(x.y, hashCombine(seed, 1u));
+    x.z     = nestedUniformScramble(x.z, hashCombine(seed, 2u));
+    x.w     = nestedUniformScramble(x.w, hashCombine(seed, 3u));
+
+    return uintToFloat(x);
+}
+
+// Extensible rank-1 lattice frac(radicalInverse(i) * g), computed exactly in 0.32 fixed point, with a per pixel
+// Cranley-Patterson rotation read from a blue noise mask so that the error is distributed as blue noise on screen.
+vec4 sampleRank1(uvec4 p)
+{
+    // The shuffle is constant per dimension set: every aligned power of two block of samples stays a lattice
+    const uint  index     = nestedUniformScramble(p.z, hash(p.w));
+    const uint  inverse   = bitfieldReverse(index);
+    const uvec4 generator = uvec4(samplerTables.rank1Generator[0], samplerTables.rank1Generator[1],
+                                  samplerTables.rank1Generator[2], samplerTables.rank1Generator[3]);
+    uvec4       x         = inverse * generator;
+
+    // Each dimension reads the mask with its own toroidal offset
+    for (uint d = 0; d < 4; d++)
+    {
+        const uint  offset = hash(p.w * 4u + d);
+        const uvec2 texel  = (p.xy + uvec2(offset, offset >> 16)) % BlueNoiseSize;
+        x[d] += samplerTables.blueNoise[texel.y * BlueNoiseSize + texel.x];
+    }
+
+    return uintToFloat(x);
+}
+
+vec4 prng(inout uvec4 p)
+{
+    p.w++;
+
+    const uint sequence = getSequence();
+    if (sequence == SequenceSobol)
+        return sampleSobol(p);
+    if (sequence == SequenceRank1)
+        return sampleRank1(p);
+
+    return uintToFloat(pcg4d(p));
+}
+
+#endif // SHADERS_LOP_SAMPLER_GLSL
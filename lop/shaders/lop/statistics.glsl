@@ -0,0 +1,22 @@
+#ifndef SHADERS_LOP_STATISTICS_GLSL
+#define SHADERS_LOP_STATISTICS_GLSL
+
+// Must match lop::HardwarePathTracingPass::RayStatistics
+struct RayStatistics
+{
+    uint primary;
+    uint continuation;
+    uint lightSampling;
+    uint bsdfSampling;
+    uint terminations;
+
+    // Radiance cache, the luminance sums are in fixed point and only gathered by the validation mode
+    uint cacheLookups;
+    uint cacheHits;
+    int  cacheDifference;
+    uint cacheReference;
+};
+
+RayStatistics emptyRayStatistics() { return RayStatistics(0u, 0u, 0u, 0u, 0u, 0u, 0u, 0, 0u); }
+
+#endif // SHADERS_LOP_STATISTICS_GLSL
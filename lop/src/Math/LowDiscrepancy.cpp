@@ -0,0 +1,184 @@
+#include "lop/Math/LowDiscrepancy.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace lop
+{
+    std::vector<uint32_t> getSobolMatrices(uint32_t dimensions)
+    {
+        assert(dimensions <= SobolMaxDimensions && "Only the first dimensions of new-joe-kuo-6.21201 are stored");
+
+        // Degree s, coefficients a and initial direction numbers m of dimensions 2 to 8 from new-joe-kuo-6.21201
+        struct Polynomial
+        {
+            uint32_t s;
+            uint32_t a;
+            uint32_t m[5];
+        };
+        constexpr Polynomial Polynomials[SobolMaxDimensions - 1] = {
+            {1, 0, {1}},                //
+            {2, 1, {1, 3}},             //
+            {3, 1, {1, 3, 1}},          //
+            {3, 2, {1, 1, 1}},          //
+            {4, 1, {1, 1, 3, 3}},       //
+            {4, 4, {1, 3, 5, 13}},      //
+            {5, 2, {1, 1, 5, 5, 17}},   //
+        };
+
+        std::vector<uint32_t> matrices(dimensions * 32u);
+
+        // The first dimension is the van der Corput sequence
+        for (uint32_t i = 0; i < 32u; i++)
+            matrices[i] = 1u << (31u - i);
+
+        for (uint32_t d = 1; d < dimensions; d++)
+        {
+            const Polynomial& polynomial = Polynomials[d - 1];
+            uint32_t*         v          = matrices.data() + d * 32u;
+            for (uint32_t i = 0; i < 32u; i++)
+            {
+                if (i < polynomial.s)
+                {
+                    v[i] = polynomial.m[i] << (31u - i);
+                    continue;
+                }
+
+                v[i] = v[i - polynomial.s] ^ (v[i - polynomial.s] >> polynomial.s);
+                for (uint32_t k = 1; k < polynomial.s; k++)
+                    v[i] ^= ((polynomial.a >> (polynomial.s - 1u - k)) & 1u) * v[i - k];
+            }
+        }
+
+        return matrices;
+    }
+
+    std::vector<uint32_t> getBlueNoise(uint32_t size, uint32_t seed)
+    {
+        const uint32_t count = size * size;
+
+        // Toroidal gaussian kernel, sigma = 1.5 as recommended by the paper
+        constexpr float    Sigma = 1.5f;
+        std::vector<float> kernel(count);
+        for (uint32_t y = 0; y < size; y++)
+        {
+            for (uint32_t x = 0; x < size; x++)
+            {
+                const float dx       = static_cast<float>(std::min(x, size - x));
+                const float dy       = static_cast<float>(std::min(y, size - y));
+                kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.f * Sigma * Sigma));
+            }
+        }
+
+        std::vector<uint8_t> pattern(count, 0);
+        std::vector<float>   energy(count, 0.f);
+        const auto           splat = [&](uint32_t pixel, float sign) {
+            const uint32_t px = pixel % size;
+            const uint32_t py = pixel / size;
+            for (uint32_t y = 0; y < size; y++)
+            {
+                const uint32_t ky = (y + size - py) % size;
+                for (uint32_t x = 0; x < size; x++)
+                    energy[y * size + x] += sign * kernel[ky * size + (x + size - px) % size];
+            }
+        };
+
+        // Tightest cluster among set pixels or largest void among empty ones
+        const auto find = [&](const std::vector<uint8_t>& current, uint8_t value, bool cluster) {
+            uint32_t best = ~0u;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                if (current[i] != value)
+                    continue;
+
+                if (best == ~0u || (cluster ? energy[i] > energy[best] : energy[i] < energy[best]))
+                    best = i;
+            }
+            return best;
+        };
+
+        // Initial binary pattern: random points, relaxed until the tightest cluster is also the largest void
+        std::mt19937                            generator{seed};
+        std::uniform_int_distribution<uint32_t> distribution{0, count - 1};
+
+        const uint32_t initialCount = std::max(1u, count / 10u);
+        for (uint32_t i = 0; i < initialCount;)
+        {
+            const uint32_t pixel = distribution(generator);
+            if (pattern[pixel])
+                continue;
+
+            pattern[pixel] = 1;
+            splat(pixel, 1.f);
+            i++;
+        }
+
+        for (uint32_t iteration = 0; iteration < count; iteration++)
+        {
+            const uint32_t cluster = find(pattern, 1, true);
+            pattern[cluster]       = 0;
+            splat(cluster, -1.f);
+
+            const uint32_t hole = find(pattern, 0, false);
+            pattern[hole]       = 1;
+            splat(hole, 1.f);
+
+            if (hole == cluster)
+                break;
+        }
+
+        std::vector<uint32_t> ranks(count, 0);
+
+        // Phase 1: rank the initial pattern by removing its tightest clusters
+        {
+            std::vector<uint8_t>     current       = pattern;
+            const std::vector<float> initialEnergy = energy;
+            for (uint32_t rank = initialCount; rank > 0; rank--)
+            {
+                const uint32_t cluster = find(current, 1, true);
+                current[cluster]       = 0;
+                splat(cluster, -1.f);
+                ranks[cluster] = rank - 1;
+            }
+            energy = initialEnergy;
+        }
+
+        // Phase 2 and 3: fill the largest voids until every pixel is ranked
+        for (uint32_t rank = initialCount; rank < count; rank++)
+        {
+            const uint32_t hole = find(pattern, 0, false);
+            pattern[hole]       = 1;
+            splat(hole, 1.f);
+            ranks[hole] = rank;
+        }
+
+        return ranks;
+    }
+
+    SamplerTables getSamplerTables()
+    {
+        SamplerTables tables{};
+
+        const std::vector<uint32_t> matrices = getSobolMatrices(SamplerTables::SobolDimensions);
+        std::memcpy(tables.sobolMatrices, matrices.data(), sizeof(tables.sobolMatrices));
+
+        // First components of lattice-32001-1024-1048576.3600
+        // Reference: Cools, R., Kuo, F. Y., & Nuyens, D. (2006). Constructing embedded lattice rules for multivariate
+        // integration. SIAM Journal on Scientific Computing, 28(6), 2162-2188.
+        constexpr uint32_t Rank1Generator[4] = {1u, 182667u, 469891u, 498753u};
+        std::memcpy(tables.rank1Generator, Rank1Generator, sizeof(tables.rank1Generator));
+
+        constexpr uint32_t Size  = SamplerTables::BlueNoiseSize;
+        const auto         ranks = getBlueNoise(Size);
+
+        // Ranks are mapped to the center of their interval
+        constexpr uint32_t Step = static_cast<uint32_t>((uint64_t(1) << 32u) / (Size * Size));
+        for (uint32_t i = 0; i < Size * Size; i++)
+            tables.blueNoise[i] = ranks[i] * Step + Step / 2u;
+
+        return tables;
+    }
+} // namespace lop
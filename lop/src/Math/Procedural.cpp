@@ -0,0 +1,104 @@
+#include "lop/Math/Procedural.hpp"
+
+#include <random>
+
+namespace lop
+{
+    vzt::Vec3 proceduralSky(const vzt::Vec3 direction)
+    {
+        const vzt::Vec3 palette[2] = {vzt::Vec3(0.557f, 0.725f, 0.984f) * 1.1f,
+                                      vzt::Vec3(0.957f, 0.573f, 0.445f) * 1.2f};
+        const float     angle      = std::acos(glm::dot(direction, vzt::Vec3(0.f, 0.f, 1.f)));
+
+        vzt::Vec3 color = glm::pow(glm::mix(palette[0], palette[1], std::abs(angle) / (vzt::Pi)), vzt::Vec3(1.5f));
+        if (angle < 0.3f)
+            color += glm::smoothstep(0.f, 0.3f, 0.3f - angle) * 100.f;
+
+        return color;
+    }
+
+    vzt::Mesh createSphere(float radius, uint32_t rings, uint32_t sectors)
+    {
+        vzt::Mesh mesh{};
+        mesh.vertices.reserve((rings + 1) * (sectors + 1));
+        mesh.normals.reserve((rings + 1) * (sectors + 1));
+        mesh.indices.reserve(rings * sectors * 6);
+
+        for (uint32_t r = 0; r <= rings; r++)
+        {
+            const float theta = vzt::Pi * static_cast<float>(r) / static_cast<float>(rings);
+            for (uint32_t s = 0; s <= sectors; s++)
+            {
+                const float     phi    = 2.f * vzt::Pi * static_cast<float>(s) / static_cast<float>(sectors);
+                const vzt::Vec3 normal = {
+                    std::sin(theta) * std::cos(phi),
+                    std::sin(theta) * std::sin(phi),
+                    std::cos(theta),
+                };
+
+                mesh.vertices.emplace_back(radius * normal);
+                mesh.normals.emplace_back(normal);
+            }
+        }
+
+        for (uint32_t r = 0; r < rings; r++)
+        {
+            for (uint32_t s = 0; s < sectors; s++)
+            {
+                const uint32_t current = r * (sectors + 1) + s;
+                const uint32_t next    = current + sectors + 1;
+
+                mesh.indices.insert(mesh.indices.end(), {current, next, current + 1});
+                mesh.indices.insert(mesh.indices.end(), {current + 1, next, next + 1});
+            }
+        }
+
+        return mesh;
+    }
+
+    vzt::Mesh createQuad(float halfSize)
+    {
+        vzt::Mesh mesh{};
+        mesh.vertices = {
+            {-halfSize, -halfSize, 0.f},
+            {halfSize, -halfSize, 0.f},
+            {halfSize, halfSize, 0.f},
+            {-halfSize, halfSize, 0.f},
+        };
+        mesh.normals = std::vector<vzt::Vec3>(4, vzt::Vec3(0.f, 0.f, 1.f));
+        mesh.indices = {0, 1, 2, 0, 2, 3};
+
+        return mesh;
+    }
+
+    vzt::Mesh createTriangleSoup(uint32_t triangleNb, float extent, float triangleSize, uint32_t seed)
+    {
+        std::mt19937                          generator{seed};
+        std::uniform_real_distribution<float> position{-extent, extent};
+        std::uniform_real_distribution<float> offset{-triangleSize, triangleSize};
+
+        vzt::Mesh mesh{};
+        mesh.vertices.reserve(triangleNb * 3);
+        mesh.normals.reserve(triangleNb * 3);
+        mesh.indices.reserve(triangleNb * 3);
+        for (uint32_t i = 0; i < triangleNb; i++)
+        {
+            const vzt::Vec3 center = {position(generator), position(generator), position(generator)};
+
+            vzt::Vec3 vertices[3];
+            for (vzt::Vec3& vertex : vertices)
+                vertex = center + vzt::Vec3{offset(generator), offset(generator), offset(generator)};
+
+            vzt::Vec3 normal = glm::cross(vertices[1] - vertices[0], vertices[2] - vertices[0]);
+            normal           = glm::length(normal) > 0.f ? glm::normalize(normal) : vzt::Vec3(0.f, 0.f, 1.f);
+            for (const vzt::Vec3& vertex : vertices)
+            {
+                mesh.indices.emplace_back(static_cast<uint32_t>(mesh.vertices.size()));
+                mesh.vertices.emplace_back(vertex);
+                mesh.normals.emplace_back(normal);
+            }
+        }
+
+        return mesh;
+    }
+} // namespace lop
@@ -1,6 +1,9 @@
 #include "lop/Math/Sampling.hpp"
 
 #include <cassert>
+#include <cmath>
+
+#include "lop/System/Parallel.hpp"
 
 namespace lop
 {
@@ -10,36 +13,156 @@ namespace lop
                "CDFs must be able to contain at least data.size + 2 elements to store the exclusive sum and the result "
                "of the sum");
 
-        const float weight = static_cast<float>(data.size);
-        cdf[0]             = 0.f;
-        for (std::size_t i = 1; i < data.size + 1; i++)
-            cdf[i] = cdf[i - 1] + data[i - 1] / weight;
+        // A single dependent pass, the normalization is a multiplication which vectorizes
+        float sum = 0.f;
+        cdf[0]    = 0.f;
+        for (std::size_t i = 0; i < data.size; i++)
+        {
+            sum += data[i];
+            cdf[i + 1] = sum;
+        }
 
-        const float sum    = cdf[data.size];
-        cdf[data.size + 1] = sum;
-        for (int i = 1; i < data.size + 1; ++i)
-            cdf[i] /= sum;
+        const float mean   = sum / static_cast<float>(data.size);
+        cdf[data.size + 1] = mean;
+        if (sum > 0.f)
+        {
+            const float normalization = 1.f / sum;
+            for (std::size_t i = 1; i < data.size + 1; i++)
+                cdf[i] *= normalization;
+        }
+        else
+        {
+            const float step = 1.f / static_cast<float>(data.size);
+            for (std::size_t i = 1; i < data.size + 1; i++)
+                cdf[i] = static_cast<float>(i) * step;
+        }
+
+        // Avoids sampling past the last segment because of rounding
+        cdf[data.size] = 1.f;
 
-        return sum;
+        return mean;
     }
 
-    std::vector<float> getCumulativeDistributionFunctions(const Image<float>& pixels)
+    std::vector<float> getCumulativeDistributionFunctions(const Image<float>& pixels, uint32_t threadCount)
     {
         // Store the <image.width> lines' cdf + the cdf of all lines as a single column
+        const std::size_t  rowSize = pixels.width + 2ul;
         std::vector<float> cdfs{};
-        cdfs.resize((pixels.width + 2) * pixels.height + (pixels.height + 2ul));
+        cdfs.resize(rowSize * pixels.height + (pixels.height + 2ul));
+
+        std::vector<float> means{};
+        means.resize(pixels.height);
+        parallelRows(pixels.height, threadCount, [&](uint32_t j) {
+            means[j] = getCumulativeDistributionFunctions(
+                vzt::CSpan<float>(pixels.data.data() + pixels.width * j, pixels.width), vzt::Span(cdfs, j * rowSize));
+        });
+
+        getCumulativeDistributionFunctions(means, vzt::Span(cdfs, pixels.height * rowSize));
+
+        return cdfs;
+    }
+
+    Distribution1D::Distribution1D(vzt::CSpan<float> function)
+        : m_cdf(function.size + 2), m_guide(function.size + 1)
+    {
+        assert(function.size > 0 && "Distributions must contain at least one segment");
+
+        getCumulativeDistributionFunctions(function, vzt::Span<float>(m_cdf.data(), m_cdf.size()));
 
-        std::vector<float> sums{};
-        sums.resize(pixels.height);
-        for (std::size_t j = 0; j < pixels.height; j++)
+        // m_guide[k] is the last segment starting strictly before the bucket k, so that a sample of the bucket k lies
+        // in [m_guide[k], m_guide[k + 1]]. Buckets are computed with the same rounding as find.
+        const uint32_t size   = getSize();
+        uint32_t       bucket = 1;
+        m_guide[0]            = 0;
+        for (uint32_t i = 1; i < size; i++)
         {
-            getCumulativeDistributionFunctions(vzt::CSpan<float>(pixels.data.data() + pixels.width * j, pixels.width),
-                                               vzt::Span(cdfs, j * (pixels.width + 2ul)));
-            sums[j] = cdfs[(j + 1) * (pixels.width + 2ul)];
+            const uint32_t start = std::min(static_cast<uint32_t>(m_cdf[i] * static_cast<float>(size)), size - 1);
+            for (; bucket <= start; bucket++)
+                m_guide[bucket] = i - 1;
         }
 
-        getCumulativeDistributionFunctions(sums, vzt::Span(cdfs, pixels.height * (pixels.width + 2ul)));
+        for (; bucket <= size; bucket++)
+            m_guide[bucket] = size - 1;
+    }
 
-        return cdfs;
+    float Distribution1D::sample(float u, float& pdf, uint32_t* offset) const
+    {
+        constexpr float OneMinusEpsilon = 0x1.fffffep-1f;
+
+        const uint32_t segment = find(u);
+        if (offset)
+            *offset = segment;
+
+        // Position in the segment
+        float       du    = u - m_cdf[segment];
+        const float width = m_cdf[segment + 1] - m_cdf[segment];
+        if (width > 0.f)
+            du /= width;
+
+        // Rounding may move the sample to a neighbor segment, whose density would not match the one returned here
+        const float size = static_cast<float>(getSize());
+        float       x    = std::min((static_cast<float>(segment) + du) / size, OneMinusEpsilon);
+        while (x * size >= static_cast<float>(segment + 1))
+            x = std::nextafter(x, 0.f);
+        while (x * size < static_cast<float>(segment))
+            x = std::nextafter(x, 1.f);
+
+        pdf = width * size;
+        return x;
+    }
+
+    uint32_t Distribution1D::sampleDiscrete(float u, float& probability) const
+    {
+        const uint32_t segment = find(u);
+        probability            = getProbability(segment);
+        return segment;
+    }
+
+    uint32_t Distribution1D::find(float u) const
+    {
+        const uint32_t size   = getSize();
+        const uint32_t bucket = std::min(static_cast<uint32_t>(u * static_cast<float>(size)), size - 1);
+
+        // First cdf entry above u among the candidates of the bucket
+        const auto begin = m_cdf.begin() + m_guide[bucket] + 1;
+        const auto end   = m_cdf.begin() + m_guide[bucket + 1] + 1;
+        return static_cast<uint32_t>(std::upper_bound(begin, end, u) - m_cdf.begin()) - 1;
+    }
+
+    uint32_t Distribution1D::findBinary(float u) const
+    {
+        const auto begin = m_cdf.begin() + 1;
+        const auto end   = m_cdf.begin() + getSize();
+        return static_cast<uint32_t>(std::upper_bound(begin, end, u) - m_cdf.begin()) - 1;
+    }
+
+    Distribution2D::Distribution2D(vzt::CSpan<float> function, uint32_t width, uint32_t height, uint32_t threadCount)
+        : m_conditionals(height)
+    {
+        assert(function.size >= std::size_t(width) * height && "Function must contain width * height values");
+
+        parallelRows(height, threadCount, [&](uint32_t y) {
+            m_conditionals[y] = Distribution1D(vzt::CSpan<float>(function.data + std::size_t(y) * width, width));
+        });
+
+        std::vector<float> integrals{};
+        integrals.resize(height);
+        for (uint32_t y = 0; y < height; y++)
+            integrals[y] = m_conditionals[y].getIntegral();
+
+        m_marginal = Distribution1D(integrals);
+    }
+
+    vzt::Vec2 Distribution2D::sample(vzt::Vec2 u, float& pdf) const
+    {
+        float       marginalPdf;
+        uint32_t    row;
+        const float v = m_marginal.sample(u.y, marginalPdf, &row);
+
+        float       conditionalPdf;
+        const float x = m_conditionals[row].sample(u.x, conditionalPdf);
+
+        pdf = marginalPdf * conditionalPdf;
+        return {x, v};
     }
 } // namespace lop
@@ -0,0 +1,191 @@
+#include "lop/Renderer/Accumulation.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <fstream>
+
+namespace lop
+{
+    namespace
+    {
+        constexpr std::array<char, 4> Magic   = {'L', 'O', 'P', 'R'};
+        constexpr uint32_t            Version = 2; // Version 1 has no scene hash
+
+        template <class Type>
+        void write(std::ofstream& file, const Type& value)
+        {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(Type));
+        }
+
+        template <class Type>
+        bool read(std::ifstream& file, Type& value)
+        {
+            return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(Type)));
+        }
+
+        // Sorts the ranges and joins the adjacent ones, false when samples are shared
+        bool join(std::vector<SampleRange>& ranges)
+        {
+            std::sort(ranges.begin(), ranges.end(), [](const SampleRange& a, const SampleRange& b) {
+                return a.seed < b.seed || (a.seed == b.seed && a.firstSample < b.firstSample);
+            });
+
+            std::vector<SampleRange> joined{};
+            for (const SampleRange& range : ranges)
+            {
+                if (range.sampleNb == 0)
+                    continue;
+
+                if (!joined.empty() && joined.back().overlaps(range))
+                    return false;
+
+                if (!joined.empty() && joined.back().seed == range.seed && joined.back().getEnd() == range.firstSample)
+                    joined.back().sampleNb += range.sampleNb;
+                else
+                    joined.emplace_back(range);
+            }
+
+            ranges = std::move(joined);
+            return true;
+        }
+    } // namespace
+
+    RawAccumulation::RawAccumulation(uint32_t width, uint32_t height)
+        : m_width(width), m_height(height), m_sums(std::size_t(width) * height * 4, 0)
+    {
+    }
+
+    RawAccumulation::RawAccumulation(uint32_t width, uint32_t height, SampleRange range, std::vector<uint64_t> sums)
+        : RawAccumulation(width, height, std::vector<SampleRange>{range}, std::move(sums))
+    {
+    }
+
+    RawAccumulation::RawAccumulation(uint32_t width, uint32_t height, std::vector<SampleRange> ranges,
+                                     std::vector<uint64_t> sums)
+        : m_width(width), m_height(height), m_ranges(std::move(ranges)), m_sums(std::move(sums))
+    {
+        assert(m_sums.size() == std::size_t(width) * height * 4 && "Sums must hold the 4 channels of every pixel");
+
+        [[maybe_unused]] const bool disjoint = join(m_ranges);
+        assert(disjoint && "Ranges must not share samples");
+    }
+
+    RawAccumulation RawAccumulation::fromWords(const Image<uint32_t>& low, const Image<uint32_t>& high,
+                                               SampleRange range)
+    {
+        assert(low.width == high.width && low.height == high.height && low.channels == 4 && high.channels == 4 &&
+               "Words must come from the sum images of the same pass");
+
+        std::vector<uint64_t> sums(low.data.size());
+        for (std::size_t i = 0; i < sums.size(); i++)
+            sums[i] = uint64_t(high.data[i]) << 32u | low.data[i];
+
+        return RawAccumulation{low.width, low.height, range, std::move(sums)};
+    }
+
+    bool RawAccumulation::merge(const RawAccumulation& other)
+    {
+        if (other.m_width != m_width || other.m_height != m_height)
+            return false;
+
+        // Without samples, an accumulation takes the scene of the first one merged
+        const bool empty = getSampleNb() == 0;
+        if (!empty && other.getSampleNb() != 0 && other.m_sceneHash != m_sceneHash)
+            return false;
+
+        std::vector<SampleRange> ranges = m_ranges;
+        ranges.insert(ranges.end(), other.m_ranges.begin(), other.m_ranges.end());
+        if (!join(ranges))
+            return false;
+
+        for (std::size_t i = 0; i < m_sums.size(); i++)
+            m_sums[i] += other.m_sums[i];
+
+        m_ranges = std::move(ranges);
+        if (empty)
+            m_sceneHash = other.m_sceneHash;
+
+        return true;
+    }
+
+    uint32_t RawAccumulation::getSampleNb() const
+    {
+        uint32_t sampleNb = 0;
+        for (const SampleRange& range : m_ranges)
+            sampleNb += range.sampleNb;
+
+        return sampleNb;
+    }
+
+    Image<float> RawAccumulation::getAverage() const
+    {
+        std::vector<float> pixels(m_sums.size(), 0.f);
+
+        const uint32_t sampleNb = getSampleNb();
+        if (sampleNb != 0)
+        {
+            const double weight = 1. / (SumScale * static_cast<double>(sampleNb));
+            for (std::size_t i = 0; i < m_sums.size(); i++)
+                pixels[i] = static_cast<float>(static_cast<double>(m_sums[i]) * weight);
+        }
+
+        return Image<float>{m_width, m_height, 4u, std::move(pixels)};
+    }
+
+    bool writeRawAccumulation(const vzt::Path& path, const RawAccumulation& accumulation)
+    {
+        std::ofstream file{path, std::ios::binary};
+        if (!file)
+            return false;
+
+        const std::vector<SampleRange>& ranges = accumulation.getRanges();
+        const std::vector<uint64_t>&    sums   = accumulation.getSums();
+
+        file.write(Magic.data(), Magic.size());
+        write(file, Version);
+        write(file, accumulation.getWidth());
+        write(file, accumulation.getHeight());
+        write(file, accumulation.getSceneHash());
+        write(file, static_cast<uint32_t>(ranges.size()));
+        file.write(reinterpret_cast<const char*>(ranges.data()),
+                   static_cast<std::streamsize>(ranges.size() * sizeof(SampleRange)));
+        file.write(reinterpret_cast<const char*>(sums.data()),
+                   static_cast<std::streamsize>(sums.size() * sizeof(uint64_t)));
+
+        return static_cast<bool>(file);
+    }
+
+    std::optional<RawAccumulation> readRawAccumulation(const vzt::Path& path)
+    {
+        std::ifstream file{path, std::ios::binary};
+
+        std::array<char, 4> magic{};
+        uint32_t            version = 0;
+        if (!file.read(magic.data(), magic.size()) || magic != Magic || !read(file, version) || version > Version)
+            return std::nullopt;
+
+        uint32_t width     = 0;
+        uint32_t height    = 0;
+        uint64_t sceneHash = 0;
+        uint32_t rangeNb   = 0;
+        if (!read(file, width) || !read(file, height) || (version > 1 && !read(file, sceneHash)) ||
+            !read(file, rangeNb))
+            return std::nullopt;
+
+        std::vector<SampleRange> ranges(rangeNb);
+        std::vector<uint64_t>    sums(std::size_t(width) * height * 4);
+        file.read(reinterpret_cast<char*>(ranges.data()),
+                  static_cast<std::streamsize>(ranges.size() * sizeof(SampleRange)));
+        file.read(reinterpret_cast<char*>(sums.data()), static_cast<std::streamsize>(sums.size() * sizeof(uint64_t)));
+        if (!file)
+            return std::nullopt;
+
+        if (!join(ranges))
+            return std::nullopt;
+
+        RawAccumulation accumulation{width, height, std::move(ranges), std::move(sums)};
+        accumulation.setSceneHash(sceneHash);
+        return accumulation;
+    }
+} // namespace lop
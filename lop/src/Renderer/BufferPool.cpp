@@ -0,0 +1,144 @@
+#include "lop/Renderer/BufferPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <vzt/Vulkan/Device.hpp>
+
+namespace lop
+{
+    BufferPool::BufferPool(vzt::View<vzt::Device> device, vzt::BufferUsage usage, bool mappable, uint64_t blockSize,
+                           uint64_t alignment)
+        : m_device(device), m_usage(usage), m_mappable(mappable), m_blockSize(blockSize), m_alignment(alignment)
+    {
+    }
+
+    BufferPool::~BufferPool()
+    {
+        for (std::unique_ptr<Block>& block : m_blocks)
+        {
+            if (block && block->data)
+                block->buffer.unMap();
+        }
+    }
+
+    BufferAllocation BufferPool::allocate(uint64_t size)
+    {
+        if (const BufferAllocation allocation = allocateExisting(size, m_blocks.size()); allocation.isValid())
+            return allocation;
+
+        // Reuse the slot of a released block
+        uint32_t blockId = 0;
+        while (blockId < m_blocks.size() && m_blocks[blockId])
+            blockId++;
+        if (blockId == m_blocks.size())
+            m_blocks.emplace_back();
+
+        const uint64_t capacity = std::max(m_blockSize, (size + m_alignment - 1) / m_alignment * m_alignment);
+
+        auto block       = std::make_unique<Block>();
+        block->buffer    = vzt::Buffer{m_device, capacity, m_usage, vzt::MemoryLocation::Device, m_mappable};
+        block->allocator = RangeAllocator(capacity, m_alignment);
+        if (m_mappable)
+            block->data = block->buffer.map();
+
+        m_blocks[blockId] = std::move(block);
+        return {blockId, m_blocks[blockId]->allocator.allocate(size)};
+    }
+
+    void BufferPool::release(BufferAllocation& allocation)
+    {
+        if (!allocation.isValid())
+            return;
+
+        m_blocks[allocation.block]->allocator.release(allocation.range);
+        allocation = {};
+    }
+
+    uint32_t BufferPool::defragment(std::initializer_list<BufferAllocation*> allocations,
+                                    std::vector<BufferAllocation>& retired)
+    {
+        assert(m_mappable && "Only mappable pools can be copied by the host");
+
+        uint32_t movedNb = 0;
+        for (BufferAllocation* allocation : allocations)
+        {
+            if (!allocation->isValid() || allocation->block == 0)
+                continue;
+
+            const BufferAllocation moved = allocateExisting(allocation->range.size, allocation->block);
+            if (!moved.isValid())
+                continue;
+
+            std::memcpy(getData(moved), getData(*allocation), allocation->range.size);
+            retired.emplace_back(*allocation);
+            *allocation = moved;
+            movedNb++;
+        }
+
+        return movedNb;
+    }
+
+    void BufferPool::trim()
+    {
+        for (std::size_t i = 1; i < m_blocks.size(); i++)
+        {
+            if (!m_blocks[i] || !m_blocks[i]->allocator.isEmpty())
+                continue;
+
+            if (m_blocks[i]->data)
+                m_blocks[i]->buffer.unMap();
+            m_blocks[i].reset();
+        }
+
+        while (!m_blocks.empty() && !m_blocks.back())
+            m_blocks.pop_back();
+    }
+
+    BufferAllocation BufferPool::allocateExisting(uint64_t size, std::size_t blockEnd)
+    {
+        for (uint32_t i = 0; i < blockEnd; i++)
+        {
+            if (!m_blocks[i])
+                continue;
+
+            if (const Range range = m_blocks[i]->allocator.allocate(size); range.isValid())
+                return {i, range};
+        }
+
+        return {};
+    }
+
+    RangeStatistics BufferPool::getStatistics() const
+    {
+        RangeStatistics statistics{};
+        for (const std::unique_ptr<Block>& block : m_blocks)
+        {
+            if (block)
+                statistics += block->allocator.getStatistics();
+        }
+
+        return statistics;
+    }
+
+    ScratchBuffer::ScratchBuffer(vzt::View<vzt::Device> device) : m_device(device) {}
+
+    const vzt::Buffer& ScratchBuffer::get(uint64_t size)
+    {
+        if (m_buffer.size() < size)
+        {
+            uint64_t capacity = std::max<uint64_t>(m_buffer.size(), 1u << 16);
+            while (capacity < size)
+                capacity *= 2;
+
+            m_buffer = vzt::Buffer{
+                m_device,
+                capacity,
+                vzt::BufferUsage::StorageBuffer | vzt::BufferUsage::ShaderDeviceAddress,
+            };
+        }
+
+        return m_buffer;
+    }
+} // namespace lop
@@ -0,0 +1,253 @@
+#include "lop/Renderer/Denoiser.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "lop/System/Parallel.hpp"
+#include "lop/System/Profiler.hpp"
+
+namespace lop
+{
+    namespace
+    {
+        // Planar layout so that the inner loops over a row read contiguous memory
+        struct Planes
+        {
+            std::vector<float> r, g, b, luminance;
+
+            Planes(std::size_t size) : r(size), g(size), b(size), luminance(size) {}
+        };
+
+        struct Guides
+        {
+            std::vector<float> nx, ny, nz, depth;
+
+            Guides(std::size_t size) : nx(size), ny(size), nz(size), depth(size) {}
+        };
+
+        // B3 spline coefficients, indexed by the absolute tap offset
+        constexpr float Epsilon   = 1e-4f;
+        constexpr float Kernel[3] = {3.f / 8.f, 1.f / 4.f, 1.f / 16.f};
+
+        // Branchless approximations of exp and log, unlike the standard library calls they are vectorized by compilers
+        inline float fastExp(float x)
+        {
+            // Only defined for x <= 0, for which a larger float has larger unsigned bits: the clamp to 2^-125 goes
+            // through them to stay vectorizable.
+            float    y = x * 1.44269504f;
+            uint32_t yBits;
+            std::memcpy(&yBits, &y, sizeof(float));
+            yBits = std::min(yBits, 0xc2fa0000u); // -125.f
+            std::memcpy(&y, &yBits, sizeof(float));
+
+            // 2^y = 2^i * 2^f with i = round(y) and f in [-0.5, 0.5], relative error below 1e-4. Adding 1.5 * 2^23
+            // rounds y and leaves i in the low mantissa bits.
+            const float shifted = y + 12582912.f;
+            int32_t     rounded;
+            std::memcpy(&rounded, &shifted, sizeof(float));
+            rounded -= 0x4b400000;
+
+            const float   f        = y - (shifted - 12582912.f);
+            const float   mantissa = 1.f + f * (0.6931472f + f * (0.2402265f + f * (0.0555041f + f * 0.0096181f)));
+            const int32_t bits     = (rounded + 127) << 23;
+
+            float scale;
+            std::memcpy(&scale, &bits, sizeof(float));
+            return scale * mantissa;
+        }
+
+        inline float fastLog(float x)
+        {
+            int32_t bits;
+            std::memcpy(&bits, &x, sizeof(float));
+
+            const float exponent = static_cast<float>((bits >> 23) - 127);
+            bits                 = (bits & 0x007fffff) | 0x3f800000;
+
+            float m;
+            std::memcpy(&m, &bits, sizeof(float));
+
+            // log2 of the mantissa in [1, 2)
+            const float log2 = exponent + (m - 1.f) * (1.4425449f + (m - 1.f) * (-0.7181452f + (m - 1.f) * 0.2736372f));
+            return log2 * 0.69314718f;
+        }
+
+        // Float comparisons keep loops scalar under the default -ftrapping-math, these go through the bits instead
+        inline int32_t signBit(float x)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &x, sizeof(float));
+            return static_cast<int32_t>(bits >> 31);
+        }
+
+        // std::max for a positive lower bound: such floats are ordered like their bits as signed integers, and
+        // negative floats have negative bits.
+        inline float maxPositive(float x, float minimum)
+        {
+            int32_t xBits, minimumBits;
+            std::memcpy(&xBits, &x, sizeof(float));
+            std::memcpy(&minimumBits, &minimum, sizeof(float));
+            xBits = std::max(xBits, minimumBits);
+
+            float result;
+            std::memcpy(&result, &xBits, sizeof(float));
+            return result;
+        }
+
+        struct Tolerances
+        {
+            float color;
+            float normal;
+            float depth;
+        };
+
+        // Applies one tap over count pixels from pixel on, whose taps start at tap. Branchless and contiguous so that
+        // the compiler vectorizes it. Restricted accumulators spare the runtime overlap checks against every input.
+        void accumulate(const Planes& input, const Guides& guides, std::size_t pixel, std::size_t tap, uint32_t count,
+                        float kernel, const Tolerances& tolerances, float* __restrict r, float* __restrict g,
+                        float* __restrict b, float* __restrict weights)
+        {
+            const float* lp  = input.luminance.data() + pixel;
+            const float* lq  = input.luminance.data() + tap;
+            const float* zp  = guides.depth.data() + pixel;
+            const float* zq  = guides.depth.data() + tap;
+            const float* nxp = guides.nx.data() + pixel;
+            const float* nyp = guides.ny.data() + pixel;
+            const float* nzp = guides.nz.data() + pixel;
+            const float* nxq = guides.nx.data() + tap;
+            const float* nyq = guides.ny.data() + tap;
+            const float* nzq = guides.nz.data() + tap;
+            const float* rq  = input.r.data() + tap;
+            const float* gq  = input.g.data() + tap;
+            const float* bq  = input.b.data() + tap;
+
+            for (uint32_t x = 0; x < count; x++)
+            {
+                // Products of the edge-stopping functions are evaluated as a single exponential
+                const float cosine   = nxp[x] * nxq[x] + nyp[x] * nyq[x] + nzp[x] * nzq[x];
+                const float geometry = tolerances.normal * fastLog(maxPositive(cosine, Epsilon)) -
+                                       std::abs(zp[x] - zq[x]) / (maxPositive(zp[x], Epsilon) * tolerances.depth);
+                const float exponent = -std::abs(lp[x] - lq[x]) / ((lp[x] + lq[x] + Epsilon) * tolerances.color) +
+                                       geometry * static_cast<float>(1 - signBit(zp[x]));
+
+                // Background, with a negative depth, and geometry are never mixed
+                const float mask   = kernel * static_cast<float>(1 - (signBit(zp[x]) ^ signBit(zq[x])));
+                const float weight = mask * fastExp(exponent);
+
+                r[x] += weight * rq[x];
+                g[x] += weight * gq[x];
+                b[x] += weight * bq[x];
+                weights[x] += weight;
+            }
+        }
+
+        void filter(const Planes& input, Planes& output, const Guides& guides, uint32_t width, uint32_t height,
+                    uint32_t iteration, const DenoiserSettings& settings, uint32_t threadCount)
+        {
+            const int32_t    step = 1 << iteration;
+            const Tolerances tolerances{
+                settings.colorPhi * std::pow(.5f, static_cast<float>(iteration)) + Epsilon,
+                settings.normalPhi,
+                settings.depthPhi * static_cast<float>(step) + Epsilon,
+            };
+
+            parallelRows(height, threadCount, [&](uint32_t y) {
+                std::vector<float> sums(4u * width, 0.f);
+                float*             r       = sums.data();
+                float*             g       = r + width;
+                float*             b       = g + width;
+                float*             weights = b + width;
+
+                // Taps are applied one at a time over the whole row
+                const std::size_t row = std::size_t(y) * width;
+                for (int32_t j = -2; j <= 2; j++)
+                {
+                    const int32_t qy = int32_t(y) + j * step;
+                    if (qy < 0 || qy >= int32_t(height))
+                        continue;
+
+                    for (int32_t i = -2; i <= 2; i++)
+                    {
+                        const int32_t  offset = i * step;
+                        const uint32_t begin  = uint32_t(std::max(0, -offset));
+                        const uint32_t end    = uint32_t(std::clamp(int32_t(width) - offset, 0, int32_t(width)));
+                        if (begin >= end)
+                            continue;
+
+                        // Taps of the first pixel, past the clamp, are never before the row start
+                        const std::size_t tapRow = std::size_t(qy) * width;
+                        const std::size_t tap    = tapRow + std::size_t(int32_t(begin) + offset);
+                        const float       kernel = Kernel[std::abs(i)] * Kernel[std::abs(j)];
+                        accumulate(input, guides, row + begin, tap, end - begin, kernel, tolerances, r + begin,
+                                   g + begin, b + begin, weights + begin);
+                    }
+                }
+
+                // The center tap always has a non-zero weight
+                for (uint32_t x = 0; x < width; x++)
+                {
+                    const std::size_t p       = row + x;
+                    const float       inverse = 1.f / std::max(weights[x], Epsilon);
+                    output.r[p]               = r[x] * inverse;
+                    output.g[p]               = g[x] * inverse;
+                    output.b[p]               = b[x] * inverse;
+                    output.luminance[p]       = .2126f * output.r[p] + .7152f * output.g[p] + .0722f * output.b[p];
+                }
+            });
+        }
+    } // namespace
+
+    Image<float> denoise(const Image<float>& color, const Image<float>& albedo, const Image<float>& normal,
+                         const DenoiserSettings& settings, uint32_t threadCount)
+    {
+        ScopedTimer timer{"denoise"};
+
+        threadCount = getThreadCount(threadCount);
+
+        const uint32_t    width  = color.width;
+        const uint32_t    height = color.height;
+        const std::size_t size   = std::size_t(width) * height;
+
+        // Illumination is filtered without the texture detail carried by the albedo
+        Planes current{size};
+        Guides guides{size};
+        for (std::size_t p = 0; p < size; p++)
+        {
+            const float* c = color.data.data() + p * color.channels;
+            const float* a = albedo.data.data() + p * albedo.channels;
+            const float* n = normal.data.data() + p * normal.channels;
+
+            current.r[p]         = c[0] / std::max(a[0], Epsilon);
+            current.g[p]         = c[1] / std::max(a[1], Epsilon);
+            current.b[p]         = c[2] / std::max(a[2], Epsilon);
+            current.luminance[p] = .2126f * current.r[p] + .7152f * current.g[p] + .0722f * current.b[p];
+
+            guides.nx[p]    = n[0];
+            guides.ny[p]    = n[1];
+            guides.nz[p]    = n[2];
+            guides.depth[p] = n[3];
+        }
+
+        Planes next{size};
+        for (uint32_t iteration = 0; iteration < settings.iterations; iteration++)
+        {
+            filter(current, next, guides, width, height, iteration, settings, threadCount);
+            std::swap(current, next);
+        }
+
+        Image<float> result{width, height, 4u, std::vector<float>(size * 4u)};
+        for (std::size_t p = 0; p < size; p++)
+        {
+            const float* a = albedo.data.data() + p * albedo.channels;
+
+            result.data[p * 4 + 0] = current.r[p] * std::max(a[0], Epsilon);
+            result.data[p * 4 + 1] = current.g[p] * std::max(a[1], Epsilon);
+            result.data[p * 4 + 2] = current.b[p] * std::max(a[2], Epsilon);
+            result.data[p * 4 + 3] = color.data[p * color.channels + 3];
+        }
+
+        return result;
+    }
+} // namespace lop
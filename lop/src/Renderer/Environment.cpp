@@ -7,6 +7,7 @@
 
 #include "lop/Math/Color.hpp"
 #include "lop/Math/Sampling.hpp"
+#include "lop/System/Profiler.hpp"
 
 namespace lop
 {
@@ -68,6 +69,8 @@ namespace lop
           view(device, image, vzt::ImageAspect::Color), sampler(device),
           samplingSize(std::min(pixels.width, pixels.height))
     {
+        ScopedTimer timer{"Environment::Environment"};
+
         assert(pixels.width % samplingSize == 0 && pixels.height % samplingSize == 0);
 
         std::vector<float> samplingData{};
@@ -1,29 +1,40 @@
 #include "lop/Renderer/Geometry.hpp"
 
-#include <glm/gtc/type_ptr.hpp>
 #include <vzt/Data/Mesh.hpp>
 #include <vzt/Vulkan/Command.hpp>
 #include <vzt/Vulkan/Device.hpp>
 
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+#include "lop/Math/Color.hpp"
+#include "lop/Renderer/RenderScene.hpp"
+#include "lop/System/Memory.hpp"
+#include "lop/System/Profiler.hpp"
 #include "lop/System/System.hpp"
 #include "lop/System/Transform.hpp"
 
 namespace lop
 {
-    MeshHolder::MeshHolder(vzt::View<vzt::Device> device, const vzt::Mesh& mesh)
+    MeshHolder::MeshHolder(vzt::View<vzt::Device> device, const vzt::Mesh& mesh, std::pmr::memory_resource* scratch,
+                           ScratchBuffer* buildScratch)
     {
-        std::vector<VertexInput> vertexInputs;
+        std::pmr::vector<VertexInput> vertexInputs{scratch};
         vertexInputs.reserve(mesh.vertices.size());
         for (std::size_t i = 0; i < mesh.vertices.size(); i++)
             vertexInputs.emplace_back(VertexInput{mesh.vertices[i], mesh.normals[i]});
 
+        positions = mesh.vertices;
+        indices   = mesh.indices;
+
         constexpr vzt::BufferUsage GeometryBufferUsages =               //
             vzt::BufferUsage::AccelerationStructureBuildInputReadOnly | //
             vzt::BufferUsage::ShaderDeviceAddress |                     //
             vzt::BufferUsage::StorageBuffer;
 
         vertexBuffer = vzt::Buffer::fromData<VertexInput>( //
-            device, vertexInputs, vzt::BufferUsage::VertexBuffer | GeometryBufferUsages);
+            device, {vertexInputs.data(), vertexInputs.size()}, vzt::BufferUsage::VertexBuffer | GeometryBufferUsages);
         indexBuffer  = vzt::Buffer::fromData<uint32_t>( //
             device, mesh.indices, vzt::BufferUsage::IndexBuffer | GeometryBufferUsages);
 
@@ -38,11 +49,12 @@ namespace lop
         accelerationStructure = vzt::AccelerationStructure( //
             device, bottomAsBuilder, vzt::AccelerationStructureType::BottomLevel);
         {
-            auto scratchBuffer = vzt::Buffer{
-                device,
-                accelerationStructure.getScratchBufferSize(),
-                vzt::BufferUsage::StorageBuffer | vzt::BufferUsage::ShaderDeviceAddress,
-            };
+            std::optional<ScratchBuffer> ownScratch{};
+            if (!buildScratch)
+                buildScratch = &ownScratch.emplace(device);
+
+            // Builds are waited for, the scratch buffer is free once they return
+            const vzt::Buffer& scratchBuffer = buildScratch->get(accelerationStructure.getScratchBufferSize());
 
             // "vkCmdBuildAccelerationStructuresKHR Supported Queue Types: Compute"
             const auto queue = device->getQueue(vzt::QueueType::Compute);
@@ -58,7 +70,14 @@ namespace lop
         }
     }
 
-    MeshHandler::MeshHandler(vzt::View<vzt::Device> device, System& system) : m_device(device), m_system(&system)
+    MeshHandler::MeshHandler(vzt::View<vzt::Device> device, System& system, uint32_t frameInFlightNb)
+        : m_device(device), m_system(&system), m_scene(std::make_unique<RenderScene>(system.registry)),
+          m_frameInFlightNb(frameInFlightNb),
+          m_pool(device,
+                 vzt::BufferUsage::StorageBuffer | vzt::BufferUsage::ShaderDeviceAddress |
+                     vzt::BufferUsage::AccelerationStructureBuildInputReadOnly,
+                 true),
+          m_scratchBuffer(device)
     {
         VkPhysicalDeviceAccelerationStructurePropertiesKHR asProperties = {};
         asProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_PROPERTIES_KHR;
@@ -78,50 +97,126 @@ namespace lop
         m_scratchBufferAlignment = asProperties.minAccelerationStructureScratchOffsetAlignment;
 
         update();
-        m_system->registry.on_construct<MeshHolder>().connect<&MeshHandler::update>(*this);
     }
 
+    MeshHandler::~MeshHandler() = default;
+
     void MeshHandler::update()
     {
-        const auto holders = m_system->registry.view<MeshHolder, Transform, Material>();
+        ScopedTimer timer{"MeshHandler::update"};
 
-        std::vector<VkAccelerationStructureInstanceKHR> instancesData{};
-        instancesData.reserve(holders.size_hint());
+        const uint64_t heapAllocationStart = getHeapAllocationNb();
 
-        std::vector<ObjectDescription> descriptions{};
-        descriptions.reserve(holders.size_hint());
+        // Scratch vectors of the previous update are dead, their memory is reused
+        m_arena.reset();
 
-        std::vector<Material> materials{};
-        materials.reserve(holders.size_hint());
+        releaseRetired();
 
-        for (entt::entity entity : holders)
+        // Edits may leave a few ranges in blocks that are otherwise empty. Moved to the lower blocks, the previous
+        // ranges are retired as the replaced ones.
+        if (m_pool.getBlockNb() > 1)
         {
-            const auto& [holder, transform, material] = m_system->registry.get<MeshHolder, Transform, Material>(entity);
+            std::vector<BufferAllocation> moved;
+            m_pool.defragment({&m_objectDescriptionBuffer, &m_materials, &m_instances, &m_lights, &m_lightTreeNodes,
+                               &m_lightBitTrails},
+                              moved);
+            for (const BufferAllocation& allocation : moved)
+                m_retired.emplace_back(allocation, m_frame);
+        }
+
+        // Only the parts of the scene modified since the previous update are rebuilt
+        m_system->hierarchy.update();
+        const SceneChanges changes        = m_scene->extract(m_system->hierarchy);
+        const bool         outdated       = !m_instances.isValid();
+        const bool         motionOutdated = m_motionOutdated;
+
+        if (changes.instances || outdated || motionOutdated)
+            updateInstances();
+
+        if (changes.materials || outdated)
+            updateMaterials();
+
+        // Light offsets of the descriptions depend on the geometry, the emission and which instances move
+        if (changes.instances || changes.materials || outdated || motionOutdated)
+            updateDescriptions();
+
+        m_arenaStatistics  = m_arena.getStatistics();
+        m_heapAllocationNb = getHeapAllocationNb() - heapAllocationStart;
+    }
 
-            // VkTransformMatrixKHR is a 3x4 row-major affine transformation matrix while glm is column major.
-            const glm::mat4      transformMatrix = glm::transpose(transform.get());
-            VkTransformMatrixKHR vkMatrix{};
-            std::memcpy(reinterpret_cast<float*>(&vkMatrix), glm::value_ptr(transformMatrix), sizeof(float) * 12);
+    void MeshHandler::nextFrame()
+    {
+        m_frame++;
+        releaseRetired();
+    }
+
+    void MeshHandler::setMotionBlur(uint32_t segmentNb)
+    {
+        segmentNb = std::clamp(segmentNb, 1u, MaxMotionSegmentNb);
+        if (segmentNb == m_motionBlur)
+            return;
+
+        m_motionBlur     = segmentNb;
+        m_motionOutdated = true;
+    }
+
+    bool MeshHandler::isMoving(uint32_t instance) const
+    {
+        const vzt::CSpan<InstanceTransform> transforms      = m_scene->getTransforms();
+        const vzt::CSpan<InstanceTransform> closeTransforms = m_scene->getCloseTransforms();
+
+        return m_motionBlur > 1 &&
+               std::memcmp(&transforms[instance], &closeTransforms[instance], sizeof(InstanceTransform)) != 0;
+    }
+
+    void MeshHandler::updateInstances()
+    {
+        static_assert(sizeof(InstanceTransform) == sizeof(VkTransformMatrixKHR));
+
+        const vzt::CSpan<InstanceTransform> transforms      = m_scene->getTransforms();
+        const vzt::CSpan<InstanceTransform> closeTransforms = m_scene->getCloseTransforms();
+        const vzt::CSpan<InstanceRecord>    records         = m_scene->getRecords();
+
+        std::pmr::vector<VkAccelerationStructureInstanceKHR> instancesData{&m_arena};
+        instancesData.reserve(std::max<std::size_t>(transforms.size, 1));
+
+        const auto addInstance = [&](const InstanceTransform& transform, uint32_t instance, uint32_t mask) {
+            VkTransformMatrixKHR vkMatrix;
+            std::memcpy(&vkMatrix, &transform, sizeof(VkTransformMatrixKHR));
 
             instancesData.emplace_back( //
                 VkAccelerationStructureInstanceKHR{
                     vkMatrix,
-                    uint32_t(instancesData.size()),
-                    0xff,
+                    instance,
+                    mask,
                     0,
                     VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR,
-                    vzt::align(holder.getAccelerationStructure().getDeviceAddress(), m_scratchBufferAlignment),
+                    vzt::align(records[instance].accelerationStructure, m_scratchBufferAlignment),
                 });
+        };
 
-            descriptions.emplace_back(ObjectDescription{
-                holder.vertexBuffer.getDeviceAddress(),
-                holder.indexBuffer.getDeviceAddress(),
-            });
+        // Static instances are visible to every ray, moving ones have a copy per segment of the shutter interval
+        bool moving = false;
+        for (uint32_t i = 0; i < transforms.size; i++)
+        {
+            if (!isMoving(i))
+            {
+                addInstance(transforms[i], i, 0xff);
+                continue;
+            }
 
-            materials.emplace_back(material);
+            moving = true;
+            for (uint32_t segment = 0; segment < m_motionBlur; segment++)
+            {
+                const float time = (static_cast<float>(segment) + .5f) / static_cast<float>(m_motionBlur);
+                addInstance(InstanceTransform::interpolate(transforms[i], closeTransforms[i], time), i, 1u << segment);
+            }
         }
 
-        if (descriptions.empty())
+        m_motionSegmentNb = moving ? m_motionBlur : 1;
+        m_motionOutdated  = false;
+
+        if (instancesData.empty())
         {
             // Dummy instance to still allow tracing
             instancesData.emplace_back( //
@@ -137,26 +232,20 @@ namespace lop
                     VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR,
                     0,
                 });
-            descriptions.emplace_back();
-            materials.emplace_back();
         }
 
-        m_objectDescriptionBuffer = vzt::Buffer::fromData<ObjectDescription>( //
-            m_device, descriptions, vzt::BufferUsage::StorageBuffer);
+        // The previous structure is only built once the instances were uploaded
+        if (m_instances.isValid())
+            m_retiredStructures.emplace_back(std::move(m_accelerationStructure), m_frame);
+        upload<VkAccelerationStructureInstanceKHR>(m_instances, {instancesData.data(), instancesData.size()});
 
-        m_instances = vzt::Buffer::fromData<VkAccelerationStructureInstanceKHR>( //
-            m_device, instancesData,
-            vzt::BufferUsage::AccelerationStructureBuildInputReadOnly | vzt::BufferUsage::ShaderDeviceAddress);
         vzt::GeometryAsBuilder topAsBuilder{
-            vzt::AsInstance{m_instances.getDeviceAddress(), uint32_t(descriptions.size())}};
+            vzt::AsInstance{m_pool.getDeviceAddress(m_instances), uint32_t(instancesData.size())}};
         m_accelerationStructure = vzt::AccelerationStructure( //
             m_device, topAsBuilder, vzt::AccelerationStructureType::TopLevel);
         {
-            const auto scratchBuffer = vzt::Buffer{
-                m_device,
-                m_accelerationStructure.getScratchBufferSize(),
-                vzt::BufferUsage::StorageBuffer | vzt::BufferUsage::ShaderDeviceAddress,
-            };
+            // Builds are waited for, the scratch buffer is free once they return
+            const vzt::Buffer& scratchBuffer = m_scratchBuffer.get(m_accelerationStructure.getScratchBufferSize());
 
             // "vkCmdBuildAccelerationStructuresKHR Supported Queue Types: Compute"
             const auto queue = m_device->getQueue(vzt::QueueType::Compute);
@@ -170,7 +259,165 @@ namespace lop
                 commands.buildAs(builder);
             });
         }
+    }
+
+    void MeshHandler::updateMaterials()
+    {
+        const vzt::CSpan<Material> materials = m_scene->getMaterials();
+
+        m_materialFeatures = {};
+        for (std::size_t i = 0; i < materials.size; i++)
+        {
+            m_materialFeatures.transmission |= materials[i].specularTransmission > 0.f;
+            m_materialFeatures.clearcoat |= materials[i].clearcoat > 0.f;
+        }
+
+        if (materials.size == 0)
+        {
+            const Material material{};
+            upload<Material>(m_materials, {&material, 1});
+            return;
+        }
+
+        upload<Material>(m_materials, materials);
+    }
+
+    void MeshHandler::updateDescriptions()
+    {
+        const vzt::CSpan<entt::entity>      entities   = m_scene->getEntities();
+        const vzt::CSpan<InstanceTransform> transforms = m_scene->getTransforms();
+        const vzt::CSpan<InstanceRecord>    records    = m_scene->getRecords();
+        const vzt::CSpan<Material>          materials  = m_scene->getMaterials();
+
+        std::pmr::vector<ObjectDescription> descriptions{&m_arena};
+        descriptions.reserve(std::max<std::size_t>(records.size, 1));
+
+        // Triangles of emissive objects, assuming a uniform emission over their surface
+        std::pmr::vector<EmissiveTriangle> lights{&m_arena};
+
+        for (uint32_t i = 0; i < records.size; i++)
+        {
+            // Triangles of a moving emitter are traced at a position per segment, a single light list would aim at
+            // a position the rays never hit. Their emission is only gathered by BSDF sampling, with a weight of 1.
+            const Material& material = materials[i];
+            const bool      sampled  = getLuminance(material.emission) > 0.f && !isMoving(i);
+            descriptions.emplace_back(ObjectDescription{
+                records[i].vertexBuffer,
+                records[i].indexBuffer,
+                sampled ? uint32_t(lights.size()) : ObjectDescription::NoLight,
+            });
+
+            if (!sampled)
+                continue;
+
+            // Light indices follow primitive indices, degenerate triangles are kept with a null power. The host copy
+            // of the geometry is only fetched for emitters.
+            const InstanceTransform& transform = transforms[i];
+            const MeshHolder&        holder    = m_system->registry.get<MeshHolder>(entities[i]);
+            for (std::size_t j = 0; j + 2 < holder.indices.size(); j += 3)
+            {
+                const vzt::Vec3 p0 = transform.apply(holder.positions[holder.indices[j + 0]]);
+                const vzt::Vec3 p1 = transform.apply(holder.positions[holder.indices[j + 1]]);
+                const vzt::Vec3 p2 = transform.apply(holder.positions[holder.indices[j + 2]]);
+
+                const float area = .5f * glm::length(glm::cross(p1 - p0, p2 - p0));
+                lights.emplace_back(EmissiveTriangle{p0, area, p1, 0.f, p2, 0.f, material.emission});
+            }
+        }
+
+        // Dummy object of the dummy instance
+        if (descriptions.empty())
+            descriptions.emplace_back(ObjectDescription{0, 0, ObjectDescription::NoLight});
+
+        upload<ObjectDescription>(m_objectDescriptionBuffer, {descriptions.data(), descriptions.size()});
+        updateLights({lights.data(), lights.size()});
+    }
+
+    void MeshHandler::updateLights(vzt::CSpan<EmissiveTriangle> lights)
+    {
+        const auto samePosition = [](const EmissiveTriangle& a, const EmissiveTriangle& b) {
+            return a.p0 == b.p0 && a.p1 == b.p1 && a.p2 == b.p2;
+        };
+        const auto sameEmission = [](const EmissiveTriangle& a, const EmissiveTriangle& b) {
+            return a.emission == b.emission;
+        };
+
+        const EmissiveTriangle* begin = lights.data;
+        const EmissiveTriangle* end   = lights.data + lights.size;
+
+        const bool moved = lights.size != m_lightList.size() || //
+                           !std::equal(begin, end, m_lightList.begin(), samePosition);
+        const bool changed = moved || !std::equal(begin, end, m_lightList.begin(), sameEmission);
+
+        // Buffers of the previous update are still valid
+        if (!changed && m_lightTreeNodes.isValid())
+            return;
+
+        ScopedTimer timer{moved ? "MeshHandler::updateLights (build)" : "MeshHandler::updateLights (refit)"};
+
+        // Keeps the capacity of the list, edits of a scene of constant size do not reallocate it
+        m_lightList.assign(begin, end);
+        m_lightCount = uint32_t(m_lightList.size());
+        if (moved)
+            m_lightTree.build(m_lightList, &m_arena);
+        else
+            m_lightTree.refit(m_lightList);
+
+        if (m_lightCount == 0)
+        {
+            // Placeholders to keep the descriptors valid, never read since the light count is 0
+            const EmissiveTriangle light{};
+            const LightTreeNode    node{};
+            const uint64_t         bitTrail = 0;
+            upload<EmissiveTriangle>(m_lights, {&light, 1});
+            upload<LightTreeNode>(m_lightTreeNodes, {&node, 1});
+            upload<uint64_t>(m_lightBitTrails, {&bitTrail, 1});
+            return;
+        }
+
+        upload<EmissiveTriangle>(m_lights, m_lightList);
+        upload<LightTreeNode>(m_lightTreeNodes, m_lightTree.getNodes());
+        upload<uint64_t>(m_lightBitTrails, m_lightTree.getBitTrails());
+    }
+
+    void MeshHandler::releaseRetired()
+    {
+        const auto isExpired = [this](const auto& retired) { return m_frame - retired.second >= m_frameInFlightNb; };
+
+        bool released = false;
+        for (auto& retired : m_retired)
+        {
+            if (!isExpired(retired))
+                continue;
+
+            m_pool.release(retired.first);
+            released = true;
+        }
+
+        m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), isExpired), m_retired.end());
+        m_retiredStructures.erase(std::remove_if(m_retiredStructures.begin(), m_retiredStructures.end(), isExpired),
+                                  m_retiredStructures.end());
+
+        // Blocks are only destroyed once none of their ranges can still be read
+        if (released)
+            m_pool.trim();
+    }
+
+    GeometryMemoryStatistics MeshHandler::getMemoryStatistics() const
+    {
+        const auto holders = m_system->registry.view<MeshHolder>();
+
+        // Vertex buffer, index buffer and bottom level structure of each mesh, then the top level structure
+        const uint32_t meshAllocationNb    = 3 * static_cast<uint32_t>(holders.size()) + 1;
+        const uint32_t scratchAllocationNb = m_scratchBuffer.getSize() != 0 ? 1 : 0;
+
+        GeometryMemoryStatistics statistics{};
+        statistics.estimatedAllocationNb = meshAllocationNb + m_pool.getBlockNb() + scratchAllocationNb;
+        statistics.scratchSize           = m_scratchBuffer.getSize();
+        statistics.pool                  = m_pool.getStatistics();
+        statistics.arena                 = m_arenaStatistics;
+        statistics.heapAllocationNb      = m_heapAllocationNb;
 
-        m_materials = vzt::Buffer::fromData<Material>(m_device, materials, vzt::BufferUsage::StorageBuffer);
+        return statistics;
     }
 } // namespace lop
@@ -0,0 +1,117 @@
+#include "lop/Renderer/GpuProfiler.hpp"
+
+#include <fmt/format.h>
+#include <vzt/Core/Logger.hpp>
+#include <vzt/Vulkan/Device.hpp>
+
+#include "lop/System/Profiler.hpp"
+
+namespace lop
+{
+    GpuProfiler::Scope::Scope(GpuProfiler& profiler, uint32_t imageId, vzt::CommandBuffer& commands,
+                              std::string_view name)
+        : m_profiler(&profiler), m_commands(&commands), m_query(profiler.start(imageId, commands, name))
+    {
+    }
+
+    GpuProfiler::Scope::~Scope() { m_profiler->end(*m_commands, m_query); }
+
+    GpuProfiler::GpuProfiler(vzt::View<vzt::Device> device, uint32_t imageNb, uint32_t maxScopes)
+        : m_device(device), m_imageNb(imageNb), m_maxScopes(maxScopes), m_scopes(imageNb)
+    {
+        const vzt::PhysicalDevice hardware = m_device->getHardware();
+
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(hardware.getHandle(), &properties);
+        m_timestampPeriod = properties.limits.timestampPeriod;
+
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(hardware.getHandle(), &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(hardware.getHandle(), &familyCount, families.data());
+
+        // Frames are recorded on the compute queue
+        const auto queue = m_device->getQueue(vzt::QueueType::Compute);
+        m_enabled        = properties.limits.timestampComputeAndGraphics == VK_TRUE ||
+                    families[queue->getId()].timestampValidBits > 0;
+        if (!m_enabled)
+        {
+            vzt::logger::warn("Timestamp queries are not supported, GPU timings are disabled.");
+            return;
+        }
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = 2u * m_maxScopes * m_imageNb;
+        const VkResult result = vkCreateQueryPool(m_device->getHandle(), &queryPoolInfo, nullptr, &m_queryPool);
+        if (result != VK_SUCCESS)
+        {
+            vzt::logger::warn("Failed to create the timestamp query pool ({}), GPU timings are disabled.",
+                              static_cast<int>(result));
+            m_queryPool = VK_NULL_HANDLE;
+            m_enabled   = false;
+            return;
+        }
+
+        m_results.resize(2u * m_maxScopes);
+    }
+
+    GpuProfiler::~GpuProfiler()
+    {
+        if (m_queryPool != VK_NULL_HANDLE)
+            vkDestroyQueryPool(m_device->getHandle(), m_queryPool, nullptr);
+    }
+
+    void GpuProfiler::begin(uint32_t imageId, vzt::CommandBuffer& commands)
+    {
+        if (!m_enabled)
+            return;
+
+        const uint32_t            firstQuery = 2u * m_maxScopes * imageId;
+        std::vector<std::string>& scopes     = m_scopes[imageId];
+        if (!scopes.empty())
+        {
+            const auto     queryCount = static_cast<uint32_t>(2u * scopes.size());
+            const VkResult result     = vkGetQueryPoolResults(                        //
+                m_device->getHandle(), m_queryPool, firstQuery, queryCount,       //
+                queryCount * sizeof(uint64_t), m_results.data(), sizeof(uint64_t), //
+                VK_QUERY_RESULT_64_BIT);
+
+            // The previous frame of this slot is not done yet: drop its timings rather than stalling.
+            if (result == VK_SUCCESS)
+            {
+                for (std::size_t i = 0; i < scopes.size(); i++)
+                {
+                    const uint64_t ticks = m_results[2 * i + 1] - m_results[2 * i];
+                    const float    ms    = static_cast<float>(static_cast<double>(ticks) * m_timestampPeriod * 1e-6);
+                    Profiler::get().record(scopes[i], ms);
+                }
+            }
+        }
+
+        scopes.clear();
+        vkCmdResetQueryPool(commands.getHandle(), m_queryPool, firstQuery, 2u * m_maxScopes);
+    }
+
+    uint32_t GpuProfiler::start(uint32_t imageId, vzt::CommandBuffer& commands, std::string_view name)
+    {
+        std::vector<std::string>& scopes = m_scopes[imageId];
+        if (!m_enabled || scopes.size() >= m_maxScopes)
+            return ~0u;
+
+        const auto query = static_cast<uint32_t>(2u * (m_maxScopes * imageId + scopes.size()));
+        scopes.emplace_back(fmt::format("GPU {}", name));
+
+        vkCmdWriteTimestamp(commands.getHandle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, query);
+        return query;
+    }
+
+    void GpuProfiler::end(vzt::CommandBuffer& commands, uint32_t query)
+    {
+        if (query == ~0u)
+            return;
+
+        vkCmdWriteTimestamp(commands.getHandle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, query + 1);
+    }
+} // namespace lop
@@ -0,0 +1,136 @@
+#include "lop/Renderer/ImageWriter.hpp"
+
+#include <algorithm>
+#include <filesystem>
+
+#include <vzt/Core/Logger.hpp>
+
+namespace lop
+{
+    namespace
+    {
+        bool replace(const vzt::Path& path, const std::function<bool(const vzt::Path&)>& write)
+        {
+            std::error_code error;
+            if (path.has_parent_path())
+                std::filesystem::create_directories(path.parent_path(), error);
+
+            const vzt::Path temporary = vzt::Path{path}.concat(".tmp");
+            if (write(temporary))
+            {
+                std::filesystem::rename(temporary, path, error);
+                if (!error)
+                    return true;
+            }
+
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    } // namespace
+
+    AsyncImageWriter::AsyncImageWriter(std::size_t maxPendingNb)
+        : m_maxPendingNb(std::max(maxPendingNb, std::size_t(1))), m_thread(&AsyncImageWriter::run, this)
+    {
+    }
+
+    AsyncImageWriter::~AsyncImageWriter()
+    {
+        {
+            std::lock_guard lock{m_mutex};
+            m_stopping = true;
+        }
+
+        m_pushed.notify_one();
+        m_thread.join();
+    }
+
+    void AsyncImageWriter::writePng(vzt::Path path, Image<uint8_t> image)
+    {
+        push(std::move(path),
+             [image = std::move(image)](const vzt::Path& target) { return lop::writePng(target, image); });
+    }
+
+    void AsyncImageWriter::writeExr(vzt::Path path, uint32_t width, uint32_t height, std::vector<ExrChannel> channels)
+    {
+        push(std::move(path), [width, height, channels = std::move(channels)](const vzt::Path& target) mutable {
+            return lop::writeExr(target, width, height, std::move(channels));
+        });
+    }
+
+    void AsyncImageWriter::writeRawAccumulation(vzt::Path path, RawAccumulation accumulation)
+    {
+        push(std::move(path), [accumulation = std::move(accumulation)](const vzt::Path& target) {
+            return lop::writeRawAccumulation(target, accumulation);
+        });
+    }
+
+    void AsyncImageWriter::remove(vzt::Path path) { push(std::move(path), {}); }
+
+    void AsyncImageWriter::wait()
+    {
+        std::unique_lock lock{m_mutex};
+        m_popped.wait(lock, [this] { return m_tasks.empty() && !m_writing; });
+    }
+
+    void AsyncImageWriter::push(vzt::Path path, std::function<bool(const vzt::Path&)> write)
+    {
+        {
+            std::unique_lock lock{m_mutex};
+            m_popped.wait(lock, [this] { return m_tasks.size() < m_maxPendingNb; });
+            m_tasks.emplace_back(Task{std::move(path), std::move(write)});
+        }
+
+        m_pushed.notify_one();
+    }
+
+    void AsyncImageWriter::run()
+    {
+        // Removals depend on the write submitted right before them
+        bool written = true;
+        while (true)
+        {
+            Task task;
+            {
+                std::unique_lock lock{m_mutex};
+                m_pushed.wait(lock, [this] { return !m_tasks.empty() || m_stopping; });
+
+                // Pending images are still written when stopping
+                if (m_tasks.empty())
+                    return;
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+                m_writing = true;
+            }
+
+            m_popped.notify_all();
+
+            if (!task.write)
+            {
+                std::error_code error;
+                if (written)
+                    std::filesystem::remove(task.path, error);
+                else
+                    vzt::logger::warn("{} is kept since the previous image was not written", task.path.string());
+            }
+            else if (replace(task.path, task.write))
+            {
+                written = true;
+                m_writtenNb++;
+            }
+            else
+            {
+                vzt::logger::error("Failed to write {}", task.path.string());
+                written = false;
+                m_failureNb++;
+            }
+
+            {
+                std::lock_guard lock{m_mutex};
+                m_writing = false;
+            }
+
+            m_popped.notify_all();
+        }
+    }
+} // namespace lop
@@ -0,0 +1,398 @@
+#include "lop/Renderer/LightTree.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace lop
+{
+    namespace
+    {
+        constexpr float Pi = 3.14159265358979323846f;
+
+        inline float safeSqrt(float x) { return std::sqrt(std::max(0.f, x)); }
+        inline float safeAcos(float x) { return std::acos(std::clamp(x, -1.f, 1.f)); }
+
+        // cos(max(0, a - b)) and sin(max(0, a - b)) from the sines and cosines of a and b
+        inline float cosSubClamped(float sinA, float cosA, float sinB, float cosB)
+        {
+            return cosA > cosB ? 1.f : cosA * cosB + sinA * sinB;
+        }
+
+        inline float sinSubClamped(float sinA, float cosA, float sinB, float cosB)
+        {
+            return cosA > cosB ? 0.f : sinA * cosB - cosA * sinB;
+        }
+
+        struct LightBounds
+        {
+            vzt::Vec3 min      = vzt::Vec3(std::numeric_limits<float>::max());
+            vzt::Vec3 max      = vzt::Vec3(std::numeric_limits<float>::lowest());
+            float     power    = 0.f;
+            vzt::Vec3 axis     = {};
+            float     cosTheta = 1.f;
+            bool      empty    = true;
+
+            vzt::Vec3 getCentroid() const { return (min + max) * .5f; }
+        };
+
+        LightBounds getBounds(const EmissiveTriangle& triangle)
+        {
+            LightBounds bounds{};
+            bounds.min   = glm::min(triangle.p0, glm::min(triangle.p1, triangle.p2));
+            bounds.max   = glm::max(triangle.p0, glm::max(triangle.p1, triangle.p2));
+            bounds.power = triangle.getPower();
+            bounds.empty = false;
+
+            const vzt::Vec3 normal = glm::cross(triangle.p1 - triangle.p0, triangle.p2 - triangle.p0);
+            const float     length = glm::length(normal);
+            if (length > 0.f)
+                bounds.axis = normal / length;
+            else
+                bounds.cosTheta = -1.f;
+
+            return bounds;
+        }
+
+        LightBounds merge(const LightBounds& a, const LightBounds& b)
+        {
+            if (a.empty)
+                return b;
+            if (b.empty)
+                return a;
+
+            LightBounds result{};
+            result.min   = glm::min(a.min, b.min);
+            result.max   = glm::max(a.max, b.max);
+            result.power = a.power + b.power;
+            result.empty = false;
+
+            // Smallest cone containing both cones
+            const float thetaA = safeAcos(a.cosTheta);
+            const float thetaB = safeAcos(b.cosTheta);
+            const float thetaD = safeAcos(glm::dot(a.axis, b.axis));
+            if (std::min(thetaD + thetaB, Pi) <= thetaA)
+            {
+                result.axis     = a.axis;
+                result.cosTheta = a.cosTheta;
+                return result;
+            }
+
+            if (std::min(thetaD + thetaA, Pi) <= thetaB)
+            {
+                result.axis     = b.axis;
+                result.cosTheta = b.cosTheta;
+                return result;
+            }
+
+            const float     thetaO   = (thetaA + thetaD + thetaB) * .5f;
+            const vzt::Vec3 wr       = glm::cross(a.axis, b.axis);
+            const float     wrLength = glm::length(wr);
+            if (thetaO >= Pi || wrLength == 0.f)
+            {
+                result.axis     = a.axis;
+                result.cosTheta = -1.f;
+                return result;
+            }
+
+            // Rotation of a's axis toward b's one, around their orthogonal direction
+            const float     thetaR = thetaO - thetaA;
+            const vzt::Vec3 k      = wr / wrLength;
+            result.axis     = glm::normalize(a.axis * std::cos(thetaR) + glm::cross(k, a.axis) * std::sin(thetaR));
+            result.cosTheta = std::cos(thetaO);
+            return result;
+        }
+
+        // Surface area orientation heuristic, emitters being diffuse their emission spans a hemisphere around each
+        // normal of the cone
+        float getCost(const LightBounds& bounds, float regularization)
+        {
+            if (bounds.empty)
+                return 0.f;
+
+            constexpr float ThetaE = Pi * .5f;
+
+            const float thetaO = safeAcos(bounds.cosTheta);
+            const float thetaW = std::min(thetaO + ThetaE, Pi);
+            const float sinO   = safeSqrt(1.f - bounds.cosTheta * bounds.cosTheta);
+            const float mOmega = 2.f * Pi * (1.f - bounds.cosTheta) +
+                                 Pi * .5f *
+                                     (2.f * thetaW * sinO - std::cos(thetaO - 2.f * thetaW) - 2.f * thetaO * sinO +
+                                      bounds.cosTheta);
+
+            const vzt::Vec3 d    = bounds.max - bounds.min;
+            const float     area = 2.f * (d.x * d.y + d.x * d.z + d.y * d.z);
+            return regularization * bounds.power * mOmega * area;
+        }
+
+        LightTreeNode toNode(const LightBounds& bounds)
+        {
+            LightTreeNode node{};
+            node.min      = bounds.min;
+            node.max      = bounds.max;
+            node.power    = bounds.power;
+            node.axis     = bounds.axis;
+            node.cosTheta = bounds.cosTheta;
+            return node;
+        }
+    } // namespace
+
+    float getImportance(const LightTreeNode& node, vzt::Vec3 p, vzt::Vec3 n)
+    {
+        const vzt::Vec3 center   = (node.min + node.max) * .5f;
+        const float     radius   = glm::length(node.max - node.min) * .5f;
+        const vzt::Vec3 toPoint  = p - center;
+        const float     distance = glm::length(toPoint);
+
+        // Clamped to avoid the singularity close to the node
+        const float     d2 = std::max(distance * distance, radius);
+        const vzt::Vec3 wi = distance > 0.f ? toPoint / distance : n;
+
+        // Angle between the closest normal of the cone and the direction toward the point, emitters are two-sided
+        const float cosW = std::abs(glm::dot(node.axis, wi));
+        const float sinW = safeSqrt(1.f - cosW * cosW);
+
+        // Angle subtended by the node's bounding sphere
+        const float cosB = distance > radius ? safeSqrt(1.f - radius * radius / (distance * distance)) : -1.f;
+        const float sinB = safeSqrt(1.f - cosB * cosB);
+
+        const float sinO = safeSqrt(1.f - node.cosTheta * node.cosTheta);
+        const float cosX = cosSubClamped(sinW, cosW, sinO, node.cosTheta);
+        const float sinX = sinSubClamped(sinW, cosW, sinO, node.cosTheta);
+
+        const float cosThetaP = cosSubClamped(sinX, cosX, sinB, cosB);
+        if (cosThetaP <= 0.f)
+            return 0.f;
+
+        // Receivers may transmit light, both sides of the shading point are considered
+        const float cosI      = std::abs(glm::dot(wi, n));
+        const float sinI      = safeSqrt(1.f - cosI * cosI);
+        const float cosThetaI = cosSubClamped(sinI, cosI, sinB, cosB);
+
+        return std::max(0.f, node.power * cosThetaP * cosThetaI / d2);
+    }
+
+    struct LightTree::BuildLight
+    {
+        uint32_t    index;
+        LightBounds bounds;
+    };
+
+    void LightTree::build(vzt::CSpan<EmissiveTriangle> lights, std::pmr::memory_resource* scratch)
+    {
+        m_nodes.clear();
+        m_bitTrails.assign(lights.size, 0);
+        if (lights.size == 0)
+            return;
+
+        std::pmr::vector<BuildLight> buildLights{scratch};
+        buildLights.reserve(lights.size);
+        for (uint32_t i = 0; i < lights.size; i++)
+            buildLights.emplace_back(BuildLight{i, getBounds(lights[i])});
+
+        m_nodes.reserve(2 * lights.size - 1);
+        build(buildLights, 0, buildLights.size(), 0, 0);
+    }
+
+    uint32_t LightTree::build(std::pmr::vector<BuildLight>& lights, std::size_t start, std::size_t end,
+                              uint64_t bitTrail, uint32_t depth)
+    {
+        const uint32_t nodeId = static_cast<uint32_t>(m_nodes.size());
+        if (end - start == 1)
+        {
+            LightTreeNode node = toNode(lights[start].bounds);
+            node.childOrLight  = lights[start].index;
+            node.leaf          = 1;
+            m_nodes.emplace_back(node);
+
+            m_bitTrails[lights[start].index] = bitTrail;
+            return nodeId;
+        }
+
+        LightBounds bounds{};
+        vzt::Vec3   centroidMin = vzt::Vec3(std::numeric_limits<float>::max());
+        vzt::Vec3   centroidMax = vzt::Vec3(std::numeric_limits<float>::lowest());
+        for (std::size_t i = start; i < end; i++)
+        {
+            bounds = merge(bounds, lights[i].bounds);
+
+            const vzt::Vec3 centroid = lights[i].bounds.getCentroid();
+            centroidMin              = glm::min(centroidMin, centroid);
+            centroidMax              = glm::max(centroidMax, centroid);
+        }
+
+        // Trails hold 64 levels: past half of them, median splits bound the remaining depth for up to 2^32 lights
+        constexpr uint32_t BucketNb          = 12;
+        constexpr uint32_t MaxHeuristicDepth = 32;
+
+        const vzt::Vec3 diagonal    = bounds.max - bounds.min;
+        const float     maxDiagonal = std::max(diagonal.x, std::max(diagonal.y, diagonal.z));
+
+        float    minCost     = std::numeric_limits<float>::max();
+        uint32_t splitDim    = 0;
+        uint32_t splitBucket = BucketNb;
+        for (uint32_t dim = 0; depth < MaxHeuristicDepth && dim < 3; dim++)
+        {
+            const float extent = centroidMax[dim] - centroidMin[dim];
+            if (extent <= 0.f)
+                continue;
+
+            std::array<LightBounds, BucketNb> buckets{};
+            for (std::size_t i = start; i < end; i++)
+            {
+                const float    offset = (lights[i].bounds.getCentroid()[dim] - centroidMin[dim]) / extent;
+                const uint32_t bucket = std::min(static_cast<uint32_t>(offset * BucketNb), BucketNb - 1);
+                buckets[bucket]       = merge(buckets[bucket], lights[i].bounds);
+            }
+
+            // Elongated nodes are penalized along their smallest dimensions
+            const float regularization = diagonal[dim] > 0.f ? maxDiagonal / diagonal[dim] : 1.f;
+
+            std::array<LightBounds, BucketNb> below{};
+            below[0] = buckets[0];
+            for (uint32_t i = 1; i < BucketNb; i++)
+                below[i] = merge(below[i - 1], buckets[i]);
+
+            LightBounds above{};
+            for (uint32_t i = BucketNb - 1; i > 0; i--)
+            {
+                above = merge(above, buckets[i]);
+                if (below[i - 1].empty || above.empty)
+                    continue;
+
+                const float cost = getCost(below[i - 1], regularization) + getCost(above, regularization);
+                if (cost < minCost)
+                {
+                    minCost     = cost;
+                    splitDim    = dim;
+                    splitBucket = i;
+                }
+            }
+        }
+
+        std::size_t middle = start;
+        if (splitBucket != BucketNb)
+        {
+            const float extent = centroidMax[splitDim] - centroidMin[splitDim];
+            const auto  split  = std::partition(
+                lights.begin() + start, lights.begin() + end, [&](const BuildLight& light) {
+                    const float    offset = (light.bounds.getCentroid()[splitDim] - centroidMin[splitDim]) / extent;
+                    const uint32_t bucket = std::min(static_cast<uint32_t>(offset * BucketNb), BucketNb - 1);
+                    return bucket < splitBucket;
+                });
+            middle = static_cast<std::size_t>(split - lights.begin());
+        }
+
+        if (middle == start || middle == end)
+        {
+            const vzt::Vec3 centroidExtent = centroidMax - centroidMin;
+            uint32_t        dim            = centroidExtent.x > centroidExtent.y ? 0 : 1;
+            dim                            = centroidExtent.z > centroidExtent[dim] ? 2 : dim;
+
+            middle = (start + end) / 2;
+            std::nth_element(lights.begin() + start, lights.begin() + middle, lights.begin() + end,
+                             [dim](const BuildLight& a, const BuildLight& b) {
+                                 return a.bounds.getCentroid()[dim] < b.bounds.getCentroid()[dim];
+                             });
+        }
+
+        m_nodes.emplace_back(toNode(bounds));
+        build(lights, start, middle, bitTrail, depth + 1);
+        const uint32_t second = build(lights, middle, end, bitTrail | (uint64_t(1) << depth), depth + 1);
+
+        m_nodes[nodeId].childOrLight = second;
+        return nodeId;
+    }
+
+    void LightTree::refit(vzt::CSpan<EmissiveTriangle> lights)
+    {
+        assert(lights.size == m_bitTrails.size() && "Refitted lights must match the ones of the last build");
+
+        // Children always follow their parent
+        for (std::size_t i = m_nodes.size(); i > 0; i--)
+        {
+            LightTreeNode& node = m_nodes[i - 1];
+            if (node.leaf)
+                node.power = lights[node.childOrLight].getPower();
+            else
+                node.power = m_nodes[i].power + m_nodes[node.childOrLight].power;
+        }
+    }
+
+    uint32_t LightTree::sample(vzt::Vec3 p, vzt::Vec3 n, float u, float& probability) const
+    {
+        constexpr float OneMinusEpsilon = 0x1.fffffep-1f;
+
+        probability = 0.f;
+        if (m_nodes.empty() || getImportance(m_nodes[0], p, n) == 0.f)
+            return NoLight;
+
+        float    pmf    = 1.f;
+        uint32_t nodeId = 0;
+        while (!m_nodes[nodeId].leaf)
+        {
+            const uint32_t first  = nodeId + 1;
+            const uint32_t second = m_nodes[nodeId].childOrLight;
+
+            const float firstImportance  = getImportance(m_nodes[first], p, n);
+            const float secondImportance = getImportance(m_nodes[second], p, n);
+            if (firstImportance == 0.f && secondImportance == 0.f)
+                return NoLight;
+
+            const float firstProbability = firstImportance / (firstImportance + secondImportance);
+            if (u < firstProbability)
+            {
+                nodeId = first;
+                u      = std::min(u / firstProbability, OneMinusEpsilon);
+                pmf *= firstProbability;
+            }
+            else
+            {
+                nodeId = second;
+                u      = std::min((u - firstProbability) / (1.f - firstProbability), OneMinusEpsilon);
+                pmf *= 1.f - firstProbability;
+            }
+        }
+
+        probability = pmf;
+        return m_nodes[nodeId].childOrLight;
+    }
+
+    float LightTree::getProbability(vzt::Vec3 p, vzt::Vec3 n, uint32_t lightId) const
+    {
+        if (m_nodes.empty() || getImportance(m_nodes[0], p, n) == 0.f)
+            return 0.f;
+
+        uint64_t bitTrail = m_bitTrails[lightId];
+        float    pmf      = 1.f;
+        uint32_t nodeId   = 0;
+        while (!m_nodes[nodeId].leaf)
+        {
+            const uint32_t first  = nodeId + 1;
+            const uint32_t second = m_nodes[nodeId].childOrLight;
+
+            const float firstImportance  = getImportance(m_nodes[first], p, n);
+            const float secondImportance = getImportance(m_nodes[second], p, n);
+            if (firstImportance == 0.f && secondImportance == 0.f)
+                return 0.f;
+
+            const float firstProbability = firstImportance / (firstImportance + secondImportance);
+            if (bitTrail & 1)
+            {
+                nodeId = second;
+                pmf *= 1.f - firstProbability;
+            }
+            else
+            {
+                nodeId = first;
+                pmf *= firstProbability;
+            }
+
+            bitTrail >>= 1;
+        }
+
+        return pmf;
+    }
+} // namespace lop
@@ -0,0 +1,197 @@
+#include "lop/Renderer/Pass/Denoiser.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+#include <vzt/Vulkan/Device.hpp>
+
+#include "lop/Renderer/GpuProfiler.hpp"
+#include "lop/Renderer/Pass/HardwarePathTracing.hpp"
+#include "lop/System/Profiler.hpp"
+
+namespace lop
+{
+    DenoiserPass::DenoiserPass(vzt::View<vzt::Device> device, uint32_t imageNb, vzt::Extent2D extent,
+                               vzt::View<HardwarePathTracingPass> pathtracing)
+        : m_device(device), m_imageNb(imageNb), m_pathtracing(pathtracing), m_layout(device), m_program(device),
+          m_pipeline(device), m_descriptorPool(device, m_layout)
+    {
+        m_layout.addBinding(0, vzt::DescriptorType::StorageImage);  // Input
+        m_layout.addBinding(1, vzt::DescriptorType::StorageImage);  // Output
+        m_layout.addBinding(2, vzt::DescriptorType::StorageImage);  // Albedo
+        m_layout.addBinding(3, vzt::DescriptorType::StorageImage);  // Normal and depth
+        m_layout.addBinding(4, vzt::DescriptorType::StorageImage);  // Final output
+        m_layout.addBinding(5, vzt::DescriptorType::UniformBuffer); // Properties
+        m_layout.compile();
+
+        m_program.setShader(m_shaderCache.get("shaders/denoise.comp", vzt::ShaderStage::Compute));
+        m_pipeline.setProgram(m_program);
+        m_pipeline.setDescriptorLayout(m_layout);
+        m_pipeline.compile();
+
+        m_descriptorPool.allocate(imageNb * MaxIterations, m_layout);
+        m_outdatedDescriptors.resize(imageNb, true);
+
+        vzt::PhysicalDevice hardware = device->getHardware();
+        m_uboAlignment               = hardware.getUniformAlignment<DenoiserPass::Properties>();
+
+        m_ubo = vzt::Buffer{
+            device, m_uboAlignment * imageNb * MaxIterations, vzt::BufferUsage::UniformBuffer,
+            vzt::MemoryLocation::Device, true,
+        };
+        m_uboData = m_ubo.map();
+
+        resize(extent);
+    }
+
+    DenoiserPass::~DenoiserPass() { m_ubo.unMap(); }
+
+    void DenoiserPass::resize(vzt::Extent2D extent)
+    {
+        m_extent = extent;
+
+        const auto queue = m_device->getQueue(vzt::QueueType::Graphics | vzt::QueueType::Compute);
+        for (std::size_t i = 0; i < m_pingPongImages.size(); i++)
+        {
+            m_pingPongImages[i] =
+                vzt::DeviceImage(m_device, extent, vzt::ImageUsage::Storage, vzt::Format::R32G32B32A32SFloat);
+
+            queue->oneShot([&](vzt::CommandBuffer& commands) {
+                vzt::ImageBarrier barrier{};
+                barrier.image     = m_pingPongImages[i];
+                barrier.oldLayout = vzt::ImageLayout::Undefined;
+                barrier.newLayout = vzt::ImageLayout::General;
+                commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::BottomOfPipe, barrier);
+            });
+
+            m_pingPongImageViews[i] = vzt::ImageView{m_device, m_pingPongImages[i], vzt::ImageAspect::Color};
+        }
+
+        m_outputImage = vzt::DeviceImage(m_device, extent, vzt::ImageUsage::Storage | vzt::ImageUsage::TransferSrc,
+                                         vzt::Format::R32G32B32A32SFloat);
+        queue->oneShot([this](vzt::CommandBuffer& commands) {
+            vzt::ImageBarrier barrier{};
+            barrier.image     = m_outputImage;
+            barrier.oldLayout = vzt::ImageLayout::Undefined;
+            barrier.newLayout = vzt::ImageLayout::General;
+            commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::BottomOfPipe, barrier);
+        });
+        m_outputImageView = vzt::ImageView{m_device, m_outputImage, vzt::ImageAspect::Color};
+
+        m_accumulationImageView =
+            vzt::ImageView{m_device, m_pathtracing->getAccumulationImage(), vzt::ImageAspect::Color};
+        m_albedoImageView = vzt::ImageView{m_device, m_pathtracing->getAlbedoImage(), vzt::ImageAspect::Color};
+        m_normalImageView = vzt::ImageView{m_device, m_pathtracing->getNormalImage(), vzt::ImageAspect::Color};
+
+        std::fill(m_outdatedDescriptors.begin(), m_outdatedDescriptors.end(), true);
+    }
+
+    void DenoiserPass::updateDescriptors(uint32_t imageId)
+    {
+        for (uint32_t iteration = 0; iteration < MaxIterations; iteration++)
+        {
+            const uint32_t  slot = imageId * MaxIterations + iteration;
+            vzt::BufferSpan uboSpan{&m_ubo, sizeof(DenoiserPass::Properties), slot * m_uboAlignment};
+
+            // The first iteration reads the accumulation, the others the output of the previous one
+            const vzt::ImageView& input = iteration == 0 ? m_accumulationImageView //
+                                                         : m_pingPongImageViews[(iteration + 1) % 2];
+
+            vzt::IndexedDescriptor ubos{};
+            ubos[0] = vzt::DescriptorImage{vzt::DescriptorType::StorageImage, input, {}, vzt::ImageLayout::General};
+            ubos[1] = vzt::DescriptorImage{
+                vzt::DescriptorType::StorageImage,
+                m_pingPongImageViews[iteration % 2],
+                {},
+                vzt::ImageLayout::General,
+            };
+            ubos[2] = vzt::DescriptorImage{
+                vzt::DescriptorType::StorageImage,
+                m_albedoImageView,
+                {},
+                vzt::ImageLayout::General,
+            };
+            ubos[3] = vzt::DescriptorImage{
+                vzt::DescriptorType::StorageImage,
+                m_normalImageView,
+                {},
+                vzt::ImageLayout::General,
+            };
+            ubos[4] = vzt::DescriptorImage{
+                vzt::DescriptorType::StorageImage,
+                m_outputImageView,
+                {},
+                vzt::ImageLayout::General,
+            };
+            ubos[5] = vzt::DescriptorBuffer{vzt::DescriptorType::UniformBuffer, uboSpan};
+            m_descriptorPool.update(slot, ubos);
+        }
+
+        m_outdatedDescriptors[imageId] = false;
+    }
+
+    void DenoiserPass::record(uint32_t imageId, vzt::CommandBuffer& commands, const DenoiserSettings& settings,
+                              GpuProfiler* profiler)
+    {
+        const uint32_t iterations = std::min(settings.iterations, MaxIterations);
+        if (iterations == 0)
+            return;
+
+        // The previous submission of this image id is complete: its descriptors and UBO slots are free
+        if (m_outdatedDescriptors[imageId])
+            updateDescriptors(imageId);
+
+        for (uint32_t iteration = 0; iteration < iterations; iteration++)
+        {
+            const Properties properties{iteration, iterations, settings.colorPhi, settings.normalPhi,
+                                        settings.depthPhi};
+            std::memcpy(m_uboData + (imageId * MaxIterations + iteration) * m_uboAlignment, &properties,
+                        sizeof(DenoiserPass::Properties));
+        }
+
+        const std::array<vzt::View<vzt::DeviceImage>, 3> accumulatedImages{
+            m_pathtracing->getAccumulationImage(),
+            m_pathtracing->getAlbedoImage(),
+            m_pathtracing->getNormalImage(),
+        };
+
+        vzt::ImageBarrier imageBarrier{};
+        imageBarrier.oldLayout = vzt::ImageLayout::General;
+        imageBarrier.newLayout = vzt::ImageLayout::General;
+        imageBarrier.src       = vzt::Access::ShaderWrite;
+        imageBarrier.dst       = vzt::Access::ShaderRead;
+        for (const vzt::View<vzt::DeviceImage> accumulated : accumulatedImages)
+        {
+            imageBarrier.image = accumulated;
+            commands.barrier(vzt::PipelineStage::RaytracingShader, vzt::PipelineStage::ComputeShader, imageBarrier);
+        }
+
+        {
+            std::optional<GpuProfiler::Scope> scope{};
+            if (profiler)
+                scope.emplace(*profiler, imageId, commands, "Denoise");
+
+            for (uint32_t iteration = 0; iteration < iterations; iteration++)
+            {
+                // Covers both the previous frame reading the intermediate images and the previous iteration
+                imageBarrier.image = m_pingPongImages[(iteration + 1) % 2];
+                imageBarrier.src   = vzt::Access::ShaderWrite;
+                imageBarrier.dst   = vzt::Access::ShaderRead | vzt::Access::ShaderWrite;
+                commands.barrier(vzt::PipelineStage::ComputeShader, vzt::PipelineStage::ComputeShader, imageBarrier);
+
+                commands.bind(m_pipeline, m_descriptorPool[imageId * MaxIterations + iteration]);
+                commands.dispatch((m_extent.width + 7) / 8, (m_extent.height + 7) / 8, 1);
+            }
+        }
+
+        // The next trace overwrites the images read here
+        imageBarrier.src = vzt::Access::ShaderRead;
+        imageBarrier.dst = vzt::Access::ShaderRead | vzt::Access::ShaderWrite;
+        for (const vzt::View<vzt::DeviceImage> accumulated : accumulatedImages)
+        {
+            imageBarrier.image = accumulated;
+            commands.barrier(vzt::PipelineStage::ComputeShader, vzt::PipelineStage::RaytracingShader, imageBarrier);
+        }
+    }
+} // namespace lop
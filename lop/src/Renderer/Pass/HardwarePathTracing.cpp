@@ -1,90 +1,182 @@
 #include "lop/Renderer/Pass/HardwarePathTracing.hpp"
 
+#include <algorithm>
+#include <array>
+#include <optional>
+
+#include <fmt/format.h>
+#include <vzt/Core/Logger.hpp>
 #include <vzt/Vulkan/Command.hpp>
 #include <vzt/Vulkan/Device.hpp>
 
+#include "lop/Renderer/GpuProfiler.hpp"
+#include "lop/System/Profiler.hpp"
+
 namespace lop
 {
+    HardwarePathTracingPass::RayStatistics& HardwarePathTracingPass::RayStatistics::operator+=(
+        const RayStatistics& other)
+    {
+        primary += other.primary;
+        continuation += other.continuation;
+        lightSampling += other.lightSampling;
+        bsdfSampling += other.bsdfSampling;
+        terminations += other.terminations;
+        cacheLookups += other.cacheLookups;
+        cacheHits += other.cacheHits;
+        cacheDifference += other.cacheDifference;
+        cacheReference += other.cacheReference;
+        return *this;
+    }
+
+    std::vector<std::string> HardwarePathTracingPass::KernelVariant::getDefines() const
+    {
+        return {
+            fmt::format("LOP_JITTERING {}", uint32_t(jittering)),
+            fmt::format("LOP_TRANSPARENT_BACKGROUND {}", uint32_t(transparentBackground)),
+            fmt::format("LOP_TRANSMISSION {}", uint32_t(transmission)),
+            fmt::format("LOP_CLEARCOAT {}", uint32_t(clearcoat)),
+            fmt::format("LOP_AOVS {}", uint32_t(aovs)),
+            fmt::format("LOP_MESH_LIGHTS {}", uint32_t(meshLights)),
+            fmt::format("LOP_TEMPORAL {}", uint32_t(temporal)),
+            fmt::format("LOP_MOTION_BLUR {}", uint32_t(motionBlur)),
+            fmt::format("LOP_RAW_ACCUMULATION {}", uint32_t(rawAccumulation)),
+            fmt::format("LOP_RADIANCE_CACHE {}", static_cast<uint32_t>(radianceCache)),
+            fmt::format("LOP_SEQUENCE {}", static_cast<uint32_t>(sequence)),
+        };
+    }
+
+    HardwarePathTracingPass::Kernel::Kernel(vzt::View<vzt::Device> device) : device(device) {}
+
+    HardwarePathTracingPass::Kernel::~Kernel()
+    {
+        if (pipeline != VK_NULL_HANDLE)
+            vkDestroyPipeline(device->getHandle(), pipeline, nullptr);
+    }
+
     HardwarePathTracingPass::HardwarePathTracingPass(vzt::View<vzt::Device> device, uint32_t imageNb,
                                                      vzt::Extent2D extent, vzt::View<MeshHandler> handler,
-                                                     Environment environment)
-        : m_device(device), m_imageNb(imageNb), m_extent(extent), m_shaderGroup(device), m_layout(device),
-          m_pipeline(device), m_descriptorPool(device, m_layout), m_handler(handler),
-          m_environment(std::move(environment))
+                                                     Environment environment, VkPipelineCache pipelineCache)
+        : m_device(device), m_imageNb(imageNb), m_extent(extent), m_layout(device), m_pipelineCache(pipelineCache),
+          m_descriptorPool(device, m_layout), m_handler(handler), m_environment(std::move(environment))
     {
-        m_shaderGroup.addShader(m_compiler.compile("shaders/base.rgen", vzt::ShaderStage::RayGen));
-        m_shaderGroup.addShader(m_compiler.compile("shaders/dummy.rmiss", vzt::ShaderStage::Miss));
-        m_shaderGroup.addShader(m_compiler.compile("shaders/triangle.rchit", vzt::ShaderStage::ClosestHit),
-                                vzt::ShaderGroupType::TrianglesHitGroup);
-
         m_layout.addBinding(0, vzt::DescriptorType::AccelerationStructure); // AS
         m_layout.addBinding(1, vzt::DescriptorType::StorageImage);          // Accumulation image
-        m_layout.addBinding(2, vzt::DescriptorType::StorageImage);          // Render image
         m_layout.addBinding(3, vzt::DescriptorType::UniformBuffer);         // Camera
         m_layout.addBinding(4, vzt::DescriptorType::StorageBuffer);         // ObjectDescription
         m_layout.addBinding(5, vzt::DescriptorType::StorageBuffer);         // Materials
         m_layout.addBinding(6, vzt::DescriptorType::CombinedSampler);       // Skybox
         m_layout.addBinding(7, vzt::DescriptorType::CombinedSampler);       // Skybox sampling
+        m_layout.addBinding(8, vzt::DescriptorType::StorageBuffer);         // Ray statistics
+        m_layout.addBinding(9, vzt::DescriptorType::StorageBuffer);         // Sampler tables
+        m_layout.addBinding(10, vzt::DescriptorType::StorageImage);         // Albedo
+        m_layout.addBinding(11, vzt::DescriptorType::StorageImage);         // Normal and depth
+        m_layout.addBinding(12, vzt::DescriptorType::StorageImage);         // Instance id
+        m_layout.addBinding(13, vzt::DescriptorType::StorageBuffer);        // Emissive triangles
+        m_layout.addBinding(14, vzt::DescriptorType::StorageBuffer);        // Light tree
+        m_layout.addBinding(15, vzt::DescriptorType::StorageBuffer);        // Light bit trails
+        m_layout.addBinding(16, vzt::DescriptorType::StorageBuffer);        // Radiance cache keys
+        m_layout.addBinding(17, vzt::DescriptorType::StorageBuffer);        // Radiance cache accumulation
+        m_layout.addBinding(18, vzt::DescriptorType::StorageBuffer);        // Radiance cache resolved
+        m_layout.addBinding(19, vzt::DescriptorType::StorageImage);         // Temporal color, even frames
+        m_layout.addBinding(20, vzt::DescriptorType::StorageImage);         // Temporal color, odd frames
+        m_layout.addBinding(21, vzt::DescriptorType::StorageImage);         // Temporal geometry, even frames
+        m_layout.addBinding(22, vzt::DescriptorType::StorageImage);         // Temporal geometry, odd frames
+        m_layout.addBinding(23, vzt::DescriptorType::StorageImage);         // Radiance sum, low words
+        m_layout.addBinding(24, vzt::DescriptorType::StorageImage);         // Radiance sum, high words
         m_layout.compile();
 
-        m_pipeline.setDescriptorLayout(m_layout);
-        m_pipeline.setShaderGroup(m_shaderGroup);
-        m_pipeline.compile();
+        {
+            const VkDescriptorSetLayout descriptorLayout = m_layout.getHandle();
+
+            VkPipelineLayoutCreateInfo layoutInfo{};
+            layoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            layoutInfo.setLayoutCount = 1;
+            layoutInfo.pSetLayouts    = &descriptorLayout;
+            if (vkCreatePipelineLayout(device->getHandle(), &layoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+                vzt::logger::error("Failed to create the path tracing pipeline layout");
+        }
+
+        {
+            VkPhysicalDeviceRayTracingPipelinePropertiesKHR raytracing{};
+            raytracing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR;
+
+            VkPhysicalDeviceSubgroupProperties subgroup{};
+            subgroup.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+            subgroup.pNext = &raytracing;
+
+            VkPhysicalDeviceProperties2 properties{};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties.pNext = &subgroup;
+            vkGetPhysicalDeviceProperties2(device->getHardware().getHandle(), &properties);
+
+            const uint32_t alignment = raytracing.shaderGroupHandleAlignment;
+            m_handleSize             = raytracing.shaderGroupHandleSize;
+            m_handleSizeAligned      = (m_handleSize + alignment - 1) / alignment * alignment;
+
+            // Ray statistics are reduced across subgroups when the device supports it, with plain atomics otherwise
+            constexpr VkSubgroupFeatureFlags Operations =
+                VK_SUBGROUP_FEATURE_BASIC_BIT | VK_SUBGROUP_FEATURE_ARITHMETIC_BIT;
+            m_subgroupArithmetic = (subgroup.supportedStages & VK_SHADER_STAGE_RAYGEN_BIT_KHR) != 0 &&
+                                   (subgroup.supportedOperations & Operations) == Operations;
+        }
+
+        // Compile the kernel of the default properties upfront, other variants are compiled on first use
+        getKernel(getKernelVariant(Properties{}));
 
         m_descriptorPool.allocate(imageNb, m_layout);
+        m_outdatedDescriptors.resize(imageNb, true);
 
         vzt::PhysicalDevice hardware = device->getHardware();
         m_uboAlignment               = hardware.getUniformAlignment<HardwarePathTracingPass::Properties>();
 
+        // Host visible buffers stay mapped for the lifetime of the pass, each image id owning its own slot
         m_ubo = vzt::Buffer{
             device, m_uboAlignment * imageNb, vzt::BufferUsage::UniformBuffer, vzt::MemoryLocation::Device, true,
         };
+        m_uboData = m_ubo.map();
 
-        m_raygenShaderBindingTable = vzt::Buffer{
-            device,
-            m_pipeline.getShaderHandleSize() + sizeof(vzt::Vec3),
-            vzt::BufferUsage::ShaderBindingTable | vzt::BufferUsage::ShaderDeviceAddress,
-            vzt::MemoryLocation::Device,
-            true,
-        };
-
-        m_missShaderBindingTable = vzt::Buffer{
-            device,
-            m_pipeline.getShaderHandleSize() + sizeof(vzt::Vec3),
-            vzt::BufferUsage::ShaderBindingTable | vzt::BufferUsage::ShaderDeviceAddress,
-            vzt::MemoryLocation::Device,
-            true,
-        };
+        {
+            const SamplerTables tables = getSamplerTables();
+            m_samplerTables            = vzt::Buffer{
+                device, sizeof(SamplerTables), vzt::BufferUsage::StorageBuffer, vzt::MemoryLocation::Device, true,
+            };
 
-        m_hitShaderBindingTable = vzt::Buffer{
-            device,
-            m_pipeline.getShaderHandleSize() + sizeof(vzt::Vec3),
-            vzt::BufferUsage::ShaderBindingTable | vzt::BufferUsage::ShaderDeviceAddress,
-            vzt::MemoryLocation::Device,
-            true,
-        };
+            uint8_t* data = m_samplerTables.map();
+            std::memcpy(data, &tables, sizeof(SamplerTables));
+            m_samplerTables.unMap();
+        }
 
-        const vzt::CSpan<uint8_t> shaderHandleStorage = m_pipeline.getShaderHandleStorage();
-        m_handleSizeAligned                           = m_pipeline.getShaderHandleSizeAligned();
-        m_handleSize                                  = m_pipeline.getShaderHandleSize();
+        // Allocated with its full capacity once enabled, see trace
+        m_radianceCache = std::make_unique<RadianceCache>(device, 1);
 
-        uint8_t* rayGenData = m_raygenShaderBindingTable.map();
-        std::memcpy(rayGenData, shaderHandleStorage.data, m_handleSize);
-        m_raygenShaderBindingTable.unMap();
+        m_statisticsPending.resize(imageNb, false);
+        m_statistics.reserve(imageNb);
+        m_statisticsData.reserve(imageNb);
+        for (uint32_t i = 0; i < imageNb; i++)
+        {
+            m_statistics.emplace_back(device, sizeof(RayStatistics), vzt::BufferUsage::StorageBuffer,
+                                      vzt::MemoryLocation::Device, true);
+            m_statisticsData.emplace_back(m_statistics.back().map());
+            std::memset(m_statisticsData.back(), 0, sizeof(RayStatistics));
+        }
 
-        uint8_t* missData = m_missShaderBindingTable.map();
-        std::memcpy(missData, shaderHandleStorage.data + m_handleSizeAligned, m_handleSize);
-        m_missShaderBindingTable.unMap();
+        resize(extent);
+    }
 
-        uint8_t* hitData = m_hitShaderBindingTable.map();
-        std::memcpy(hitData, shaderHandleStorage.data + 2ul * m_handleSizeAligned, m_handleSize);
-        m_hitShaderBindingTable.unMap();
+    HardwarePathTracingPass::~HardwarePathTracingPass()
+    {
+        m_ubo.unMap();
+        for (vzt::Buffer& statistics : m_statistics)
+            statistics.unMap();
 
-        resize(extent);
+        m_kernels.clear();
+        vkDestroyPipelineLayout(m_device->getHandle(), m_pipelineLayout, nullptr);
     }
 
     void HardwarePathTracingPass::setEnvironment(Environment environment)
     {
+        retire(std::move(m_environment));
         m_environment = std::move(environment);
         update();
     }
@@ -93,13 +185,60 @@ namespace lop
     {
         m_extent = extent;
 
+        // Frames in flight still trace into the previous targets
+        retire(std::move(m_accumulationImageView));
+        retire(std::move(m_albedoImageView));
+        retire(std::move(m_normalImageView));
+        retire(std::move(m_instanceImageView));
+        retire(std::move(m_accumulationImage));
+        retire(std::move(m_albedoImage));
+        retire(std::move(m_normalImage));
+        retire(std::move(m_instanceImage));
+        retire(std::move(m_sumLowImageView));
+        retire(std::move(m_sumHighImageView));
+        retire(std::move(m_sumLowImage));
+        retire(std::move(m_sumHighImage));
+        retire(std::move(m_renderImage));
+        for (std::size_t i = 0; i < m_temporalColorImages.size(); i++)
+        {
+            retire(std::move(m_temporalColorImageViews[i]));
+            retire(std::move(m_temporalGeometryImageViews[i]));
+            retire(std::move(m_temporalColorImages[i]));
+            retire(std::move(m_temporalGeometryImages[i]));
+        }
+
         const auto queue = m_device->getQueue(vzt::QueueType::Graphics | vzt::QueueType::Compute);
 
         m_accumulationImage = vzt::DeviceImage(
             m_device, extent, vzt::ImageUsage::Storage | vzt::ImageUsage::TransferSrc, vzt::Format::R32G32B32A32SFloat);
+
+        // Disabled AOVs are still bound, but never written
+        const vzt::Extent2D aovExtent = m_aovs ? extent : vzt::Extent2D{1, 1};
+        m_albedoImage   = vzt::DeviceImage(m_device, aovExtent, vzt::ImageUsage::Storage | vzt::ImageUsage::TransferSrc,
+                                           vzt::Format::R32G32B32A32SFloat);
+        m_normalImage   = vzt::DeviceImage(m_device, aovExtent, vzt::ImageUsage::Storage | vzt::ImageUsage::TransferSrc,
+                                           vzt::Format::R32G32B32A32SFloat);
+        m_instanceImage = vzt::DeviceImage(m_device, aovExtent, vzt::ImageUsage::Storage | vzt::ImageUsage::TransferSrc,
+                                           vzt::Format::R32UInt);
+
+        const vzt::Extent2D rawExtent = m_raw ? extent : vzt::Extent2D{1, 1};
+        m_sumLowImage  = vzt::DeviceImage(m_device, rawExtent, vzt::ImageUsage::Storage | vzt::ImageUsage::TransferSrc,
+                                          vzt::Format::R32G32B32A32UInt);
+        m_sumHighImage = vzt::DeviceImage(m_device, rawExtent, vzt::ImageUsage::Storage | vzt::ImageUsage::TransferSrc,
+                                          vzt::Format::R32G32B32A32UInt);
+
         m_renderImage = vzt::DeviceImage(m_device, extent, vzt::ImageUsage::Storage | vzt::ImageUsage::TransferSrc,
                                          vzt::Format::B8G8R8A8UNorm);
 
+        const vzt::Extent2D temporalExtent = m_temporal ? extent : vzt::Extent2D{1, 1};
+        for (std::size_t i = 0; i < m_temporalColorImages.size(); i++)
+        {
+            m_temporalColorImages[i] = vzt::DeviceImage(m_device, temporalExtent, vzt::ImageUsage::Storage,
+                                                        vzt::Format::R32G32B32A32SFloat);
+            m_temporalGeometryImages[i] = vzt::DeviceImage(m_device, temporalExtent, vzt::ImageUsage::Storage,
+                                                           vzt::Format::R32G32B32A32SFloat);
+        }
+
         queue->oneShot([this](vzt::CommandBuffer& commands) {
             vzt::ImageBarrier barrier{};
             barrier.image     = m_accumulationImage;
@@ -107,98 +246,498 @@ namespace lop
             barrier.newLayout = vzt::ImageLayout::General;
             commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::BottomOfPipe, barrier);
 
+            barrier.image = m_albedoImage;
+            commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::BottomOfPipe, barrier);
+
+            barrier.image = m_normalImage;
+            commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::BottomOfPipe, barrier);
+
+            barrier.image = m_instanceImage;
+            commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::BottomOfPipe, barrier);
+
+            barrier.image = m_sumLowImage;
+            commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::BottomOfPipe, barrier);
+
+            barrier.image = m_sumHighImage;
+            commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::BottomOfPipe, barrier);
+
+            for (std::size_t i = 0; i < m_temporalColorImages.size(); i++)
+            {
+                barrier.image = m_temporalColorImages[i];
+                commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::BottomOfPipe, barrier);
+
+                barrier.image = m_temporalGeometryImages[i];
+                commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::BottomOfPipe, barrier);
+            }
+
+            // Written by TonemapPass, which leaves it ready to be copied between frames
             barrier.image     = m_renderImage;
             barrier.oldLayout = vzt::ImageLayout::Undefined;
-            barrier.newLayout = vzt::ImageLayout::General;
+            barrier.newLayout = vzt::ImageLayout::TransferSrcOptimal;
             commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::BottomOfPipe, barrier);
         });
 
         m_accumulationImageView = vzt::ImageView{m_device, m_accumulationImage, vzt::ImageAspect::Color};
-        m_renderImageView       = vzt::ImageView{m_device, m_renderImage, vzt::ImageAspect::Color};
+        m_albedoImageView       = vzt::ImageView{m_device, m_albedoImage, vzt::ImageAspect::Color};
+        m_normalImageView       = vzt::ImageView{m_device, m_normalImage, vzt::ImageAspect::Color};
+        m_instanceImageView     = vzt::ImageView{m_device, m_instanceImage, vzt::ImageAspect::Color};
+        m_sumLowImageView       = vzt::ImageView{m_device, m_sumLowImage, vzt::ImageAspect::Color};
+        m_sumHighImageView      = vzt::ImageView{m_device, m_sumHighImage, vzt::ImageAspect::Color};
+        for (std::size_t i = 0; i < m_temporalColorImages.size(); i++)
+        {
+            m_temporalColorImageViews[i] = vzt::ImageView{m_device, m_temporalColorImages[i], vzt::ImageAspect::Color};
+            m_temporalGeometryImageViews[i] =
+                vzt::ImageView{m_device, m_temporalGeometryImages[i], vzt::ImageAspect::Color};
+        }
 
-        update();
+        // The new temporal images hold no history
+        m_historyValid = false;
+
+        // The radiance cache does not depend on the targets and is kept
+        std::fill(m_outdatedDescriptors.begin(), m_outdatedDescriptors.end(), true);
     }
 
-    void HardwarePathTracingPass::update()
+    void HardwarePathTracingPass::setAovs(bool enabled)
     {
-        for (uint32_t i = 0; i < m_imageNb; i++)
+        if (m_aovs == enabled)
+            return;
+
+        m_aovs = enabled;
+        resize(m_extent);
+    }
+
+    void HardwarePathTracingPass::setTemporalAccumulation(bool enabled)
+    {
+        if (m_temporal == enabled)
+            return;
+
+        m_temporal = enabled;
+        resize(m_extent);
+    }
+
+    void HardwarePathTracingPass::setRawAccumulation(bool enabled)
+    {
+        if (m_raw == enabled)
+            return;
+
+        m_raw = enabled;
+        resize(m_extent);
+    }
+
+    HardwarePathTracingPass::KernelVariant HardwarePathTracingPass::getKernelVariant(const Properties& properties) const
+    {
+        const MaterialFeatures features = m_handler->getMaterialFeatures();
+
+        KernelVariant variant{};
+        variant.jittering             = properties.jittering != 0;
+        variant.transparentBackground = properties.transparentBackground != 0;
+        variant.transmission          = features.transmission;
+        variant.clearcoat             = features.clearcoat;
+        variant.aovs                  = m_aovs;
+        variant.meshLights            = m_handler->getLightCount() != 0;
+        variant.temporal              = m_temporal;
+        variant.motionBlur            = m_handler->getMotionSegmentNb() > 1;
+        variant.rawAccumulation       = m_raw;
+        variant.radianceCache         = properties.radianceCache;
+        variant.sequence              = properties.sequence;
+
+        return variant;
+    }
+
+    const HardwarePathTracingPass::Kernel& HardwarePathTracingPass::getKernel(
+        const std::optional<KernelVariant>& variant)
+    {
+        // Variant keys only use the lowest bits
+        constexpr uint32_t GenericKernel = ~0u;
+
+        const uint32_t key = variant ? variant->getKey() : GenericKernel;
+        if (const auto it = m_kernels.find(key); it != m_kernels.end())
+            return *it->second;
+
+        ScopedTimer timer{"HardwarePathTracingPass::getKernel"};
+
+        // Device capabilities are defined for every kernel, they do not change the key of the variant
+        std::vector<std::string> defines = variant ? variant->getDefines() : std::vector<std::string>{};
+        defines.emplace_back(fmt::format("LOP_SUBGROUP_ARITHMETIC {}", uint32_t(m_subgroupArithmetic)));
+
+        const std::array<vzt::Shader, 3> shaders = {
+            m_shaderCache.get("shaders/base.rgen", vzt::ShaderStage::RayGen, defines),
+            m_shaderCache.get("shaders/dummy.rmiss", vzt::ShaderStage::Miss),
+            m_shaderCache.get("shaders/triangle.rchit", vzt::ShaderStage::ClosestHit),
+        };
+        constexpr std::array<VkShaderStageFlagBits, 3> Stages = {
+            VK_SHADER_STAGE_RAYGEN_BIT_KHR,
+            VK_SHADER_STAGE_MISS_BIT_KHR,
+            VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR,
+        };
+
+        const VkDevice device = m_device->getHandle();
+
+        // One group per shader: ray generation, miss, then the triangles hit group
+        std::array<VkShaderModule, 3>                       modules{};
+        std::array<VkPipelineShaderStageCreateInfo, 3>      stages{};
+        std::array<VkRayTracingShaderGroupCreateInfoKHR, 3> groups{};
+        for (uint32_t i = 0; i < shaders.size(); i++)
         {
-            vzt::BufferSpan uboSpan{&m_ubo, sizeof(HardwarePathTracingPass::Properties), i * m_uboAlignment};
+            VkShaderModuleCreateInfo moduleInfo{};
+            moduleInfo.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            moduleInfo.codeSize = shaders[i].compiledSource.size() * sizeof(uint32_t);
+            moduleInfo.pCode    = shaders[i].compiledSource.data();
+            if (vkCreateShaderModule(device, &moduleInfo, nullptr, &modules[i]) != VK_SUCCESS)
+                vzt::logger::error("Failed to create the shader module of stage {}", i);
+
+            stages[i].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stages[i].stage  = Stages[i];
+            stages[i].module = modules[i];
+            stages[i].pName  = "main";
+
+            const bool hit               = Stages[i] == VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+            groups[i].sType              = VK_STRUCTURE_TYPE_RAY_TRACING_SHADER_GROUP_CREATE_INFO_KHR;
+            groups[i].type               = hit ? VK_RAY_TRACING_SHADER_GROUP_TYPE_TRIANGLES_HIT_GROUP_KHR
+                                               : VK_RAY_TRACING_SHADER_GROUP_TYPE_GENERAL_KHR;
+            groups[i].generalShader      = hit ? VK_SHADER_UNUSED_KHR : i;
+            groups[i].closestHitShader   = hit ? i : VK_SHADER_UNUSED_KHR;
+            groups[i].anyHitShader       = VK_SHADER_UNUSED_KHR;
+            groups[i].intersectionShader = VK_SHADER_UNUSED_KHR;
+        }
+
+        // Rays are only traced from the ray generation shader
+        VkRayTracingPipelineCreateInfoKHR pipelineInfo{};
+        pipelineInfo.sType                        = VK_STRUCTURE_TYPE_RAY_TRACING_PIPELINE_CREATE_INFO_KHR;
+        pipelineInfo.stageCount                   = static_cast<uint32_t>(stages.size());
+        pipelineInfo.pStages                      = stages.data();
+        pipelineInfo.groupCount                   = static_cast<uint32_t>(groups.size());
+        pipelineInfo.pGroups                      = groups.data();
+        pipelineInfo.maxPipelineRayRecursionDepth = 1;
+        pipelineInfo.layout                       = m_pipelineLayout;
+
+        auto           kernel = std::make_unique<Kernel>(m_device);
+        const VkResult result = vkCreateRayTracingPipelinesKHR(device, VK_NULL_HANDLE, m_pipelineCache, 1,
+                                                               &pipelineInfo, nullptr, &kernel->pipeline);
+        for (VkShaderModule module : modules)
+            vkDestroyShaderModule(device, module, nullptr);
+
+        if (result != VK_SUCCESS)
+            vzt::logger::error("Failed to create the path tracing pipeline ({})", static_cast<int>(result));
+
+        // Handles are tightly packed, each table holds a single record
+        std::vector<uint8_t> handles(groups.size() * m_handleSize);
+        vkGetRayTracingShaderGroupHandlesKHR(device, kernel->pipeline, 0, static_cast<uint32_t>(groups.size()),
+                                             handles.size(), handles.data());
+
+        kernel->raygenShaderBindingTable = vzt::Buffer{
+            m_device,
+            m_handleSize + sizeof(vzt::Vec3),
+            vzt::BufferUsage::ShaderBindingTable | vzt::BufferUsage::ShaderDeviceAddress,
+            vzt::MemoryLocation::Device,
+            true,
+        };
+
+        kernel->missShaderBindingTable = vzt::Buffer{
+            m_device,
+            m_handleSize + sizeof(vzt::Vec3),
+            vzt::BufferUsage::ShaderBindingTable | vzt::BufferUsage::ShaderDeviceAddress,
+            vzt::MemoryLocation::Device,
+            true,
+        };
+
+        kernel->hitShaderBindingTable = vzt::Buffer{
+            m_device,
+            m_handleSize + sizeof(vzt::Vec3),
+            vzt::BufferUsage::ShaderBindingTable | vzt::BufferUsage::ShaderDeviceAddress,
+            vzt::MemoryLocation::Device,
+            true,
+        };
 
-            const vzt::Buffer& descriptions = m_handler->getDescriptions();
-            vzt::BufferCSpan   objectDescriptionUboSpan{descriptions, descriptions.size()};
-            const vzt::Buffer& materials = m_handler->getMaterials();
-            vzt::BufferCSpan   materialsUboSpan{materials, materials.size()};
+        uint8_t* rayGenData = kernel->raygenShaderBindingTable.map();
+        std::memcpy(rayGenData, handles.data(), m_handleSize);
+        kernel->raygenShaderBindingTable.unMap();
 
-            vzt::IndexedDescriptor ubos{};
-            ubos[0] = vzt::DescriptorAccelerationStructure{vzt::DescriptorType::AccelerationStructure,
-                                                           m_handler->getAccelerationStructure()};
-            ubos[1] = vzt::DescriptorImage{
+        uint8_t* missData = kernel->missShaderBindingTable.map();
+        std::memcpy(missData, handles.data() + m_handleSize, m_handleSize);
+        kernel->missShaderBindingTable.unMap();
+
+        uint8_t* hitData = kernel->hitShaderBindingTable.map();
+        std::memcpy(hitData, handles.data() + 2ul * m_handleSize, m_handleSize);
+        kernel->hitShaderBindingTable.unMap();
+
+        return *m_kernels.emplace(key, std::move(kernel)).first->second;
+    }
+
+    void HardwarePathTracingPass::update()
+    {
+        // Descriptor sets may be in use by frames in flight, they are rewritten when their image id is recorded again
+        std::fill(m_outdatedDescriptors.begin(), m_outdatedDescriptors.end(), true);
+
+        // Cached radiance and temporal history belong to the previous scene
+        m_radianceCache->reset();
+        m_historyValid = false;
+    }
+
+    void HardwarePathTracingPass::updateDescriptors(uint32_t i)
+    {
+        vzt::BufferSpan uboSpan{&m_ubo, sizeof(HardwarePathTracingPass::Properties), i * m_uboAlignment};
+
+        // Geometry buffers are ranges of the pool of the handler
+        vzt::BufferCSpan objectDescriptionUboSpan = m_handler->getDescriptions();
+        vzt::BufferCSpan materialsUboSpan         = m_handler->getMaterials();
+        vzt::BufferCSpan lightsUboSpan            = m_handler->getLights();
+        vzt::BufferCSpan lightTreeUboSpan         = m_handler->getLightTree();
+        vzt::BufferCSpan lightBitTrailsUboSpan    = m_handler->getLightBitTrails();
+        const vzt::Buffer& cacheKeys = m_radianceCache->getKeys();
+        vzt::BufferCSpan   cacheKeysUboSpan{cacheKeys, cacheKeys.size()};
+        const vzt::Buffer& cacheAccumulation = m_radianceCache->getAccumulation();
+        vzt::BufferCSpan   cacheAccumulationUboSpan{cacheAccumulation, cacheAccumulation.size()};
+        const vzt::Buffer& cacheResolved = m_radianceCache->getResolved();
+        vzt::BufferCSpan   cacheResolvedUboSpan{cacheResolved, cacheResolved.size()};
+
+        vzt::IndexedDescriptor ubos{};
+        ubos[0] = vzt::DescriptorAccelerationStructure{vzt::DescriptorType::AccelerationStructure,
+                                                       m_handler->getAccelerationStructure()};
+        ubos[1] = vzt::DescriptorImage{
+            vzt::DescriptorType::StorageImage,
+            m_accumulationImageView,
+            {},
+            vzt::ImageLayout::General,
+        };
+        ubos[3] = vzt::DescriptorBuffer{vzt::DescriptorType::UniformBuffer, uboSpan};
+        ubos[4] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, objectDescriptionUboSpan};
+        ubos[5] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, materialsUboSpan};
+        ubos[6] = vzt::DescriptorImage{
+            vzt::DescriptorType::CombinedSampler,
+            m_environment.view,
+            m_environment.sampler,
+        };
+        ubos[7] = vzt::DescriptorImage{
+            vzt::DescriptorType::CombinedSampler,
+            m_environment.samplingView,
+            m_environment.sampler,
+        };
+        ubos[8] = vzt::DescriptorBuffer{
+            vzt::DescriptorType::StorageBuffer,
+            vzt::BufferSpan{&m_statistics[i], sizeof(RayStatistics)},
+        };
+        ubos[9] = vzt::DescriptorBuffer{
+            vzt::DescriptorType::StorageBuffer,
+            vzt::BufferSpan{&m_samplerTables, sizeof(SamplerTables)},
+        };
+        ubos[10] = vzt::DescriptorImage{
+            vzt::DescriptorType::StorageImage,
+            m_albedoImageView,
+            {},
+            vzt::ImageLayout::General,
+        };
+        ubos[11] = vzt::DescriptorImage{
+            vzt::DescriptorType::StorageImage,
+            m_normalImageView,
+            {},
+            vzt::ImageLayout::General,
+        };
+        ubos[12] = vzt::DescriptorImage{
+            vzt::DescriptorType::StorageImage,
+            m_instanceImageView,
+            {},
+            vzt::ImageLayout::General,
+        };
+        ubos[13] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, lightsUboSpan};
+        ubos[14] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, lightTreeUboSpan};
+        ubos[15] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, lightBitTrailsUboSpan};
+        ubos[16] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, cacheKeysUboSpan};
+        ubos[17] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, cacheAccumulationUboSpan};
+        ubos[18] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, cacheResolvedUboSpan};
+        for (uint32_t j = 0; j < 2; j++)
+        {
+            ubos[19 + j] = vzt::DescriptorImage{
                 vzt::DescriptorType::StorageImage,
-                m_accumulationImageView,
+                m_temporalColorImageViews[j],
                 {},
                 vzt::ImageLayout::General,
             };
-            ubos[2] = vzt::DescriptorImage{
+            ubos[21 + j] = vzt::DescriptorImage{
                 vzt::DescriptorType::StorageImage,
-                m_renderImageView,
+                m_temporalGeometryImageViews[j],
                 {},
                 vzt::ImageLayout::General,
             };
-            ubos[3] = vzt::DescriptorBuffer{vzt::DescriptorType::UniformBuffer, uboSpan};
-            ubos[4] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, objectDescriptionUboSpan};
-            ubos[5] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, materialsUboSpan};
-            ubos[6] = vzt::DescriptorImage{
-                vzt::DescriptorType::CombinedSampler,
-                m_environment.view,
-                m_environment.sampler,
-            };
-            ubos[7] = vzt::DescriptorImage{
-                vzt::DescriptorType::CombinedSampler,
-                m_environment.samplingView,
-                m_environment.sampler,
-            };
-            m_descriptorPool.update(i, ubos);
         }
+        ubos[23] = vzt::DescriptorImage{
+            vzt::DescriptorType::StorageImage,
+            m_sumLowImageView,
+            {},
+            vzt::ImageLayout::General,
+        };
+        ubos[24] = vzt::DescriptorImage{
+            vzt::DescriptorType::StorageImage,
+            m_sumHighImageView,
+            {},
+            vzt::ImageLayout::General,
+        };
+        m_descriptorPool.update(i, ubos);
+
+        m_outdatedDescriptors[i] = false;
+    }
+
+    void HardwarePathTracingPass::resetRayStatistics()
+    {
+        m_rayStatistics            = {};
+        m_accumulatedRayStatistics = {};
+    }
+
+    void HardwarePathTracingPass::collectRayStatistics()
+    {
+        for (uint32_t i = 0; i < m_imageNb; i++)
+            readRayStatistics(i);
+    }
+
+    void HardwarePathTracingPass::readRayStatistics(uint32_t imageId)
+    {
+        if (!m_statisticsPending[imageId])
+            return;
+
+        std::memcpy(&m_rayStatistics, m_statisticsData[imageId], sizeof(RayStatistics));
+        std::memset(m_statisticsData[imageId], 0, sizeof(RayStatistics));
+
+        m_accumulatedRayStatistics += m_rayStatistics;
+        m_statisticsPending[imageId] = false;
     }
 
     void HardwarePathTracingPass::record(uint32_t imageId, vzt::CommandBuffer& commands,
-                                         const vzt::View<vzt::DeviceImage> outputImage, Properties properties)
+                                         const vzt::View<vzt::DeviceImage> outputImage, Properties properties,
+                                         GpuProfiler* profiler)
     {
-        uint8_t* data = m_ubo.map();
-        std::memcpy(data + imageId * m_uboAlignment, &properties, sizeof(HardwarePathTracingPass::Properties));
-        m_ubo.unMap();
+        trace(imageId, commands, properties, profiler);
+        copy(imageId, commands, outputImage, profiler);
+    }
 
-        vzt::BufferBarrier barrier{m_ubo, vzt::Access::TransferWrite, vzt::Access::UniformRead};
-        commands.barrier(vzt::PipelineStage::Transfer, vzt::PipelineStage::RaytracingShader, barrier);
+    void HardwarePathTracingPass::trace(uint32_t imageId, vzt::CommandBuffer& commands, Properties properties,
+                                        GpuProfiler* profiler)
+    {
+        // The previous submission of this image id is complete: its counters, descriptors and UBO slot are free.
+        readRayStatistics(imageId);
+
+        for (auto& [resource, remainingFrames] : m_retired)
+            remainingFrames--;
+        m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(),
+                                       [](const auto& retired) { return retired.second == 0; }),
+                        m_retired.end());
+
+        // Every pixel would only reload and store its accumulated value
+        if (properties.isConverged())
+            return;
+
+        // Validation results are read back as ray statistics
+        const bool radianceCache = properties.radianceCache != RadianceCacheMode::Disabled;
+        m_statisticsPending[imageId] =
+            properties.statistics != 0 || properties.radianceCache == RadianceCacheMode::Validation;
+
+        const uint32_t cacheCapacity = radianceCache ? RadianceCache::DefaultCapacity : 1;
+        if (m_radianceCache->getCapacity() != cacheCapacity)
+        {
+            retire(std::move(m_radianceCache));
+            m_radianceCache = std::make_unique<RadianceCache>(m_device, cacheCapacity);
+            std::fill(m_outdatedDescriptors.begin(), m_outdatedDescriptors.end(), true);
+        }
 
+        if (m_outdatedDescriptors[imageId])
+            updateDescriptors(imageId);
+
+        // Host writes are made visible to the device by the queue submission
+        properties.aovs                  = m_aovs;
+        properties.lightCount            = m_handler->getLightCount();
+        properties.motionSegmentNb       = m_handler->getMotionSegmentNb();
+        properties.rawAccumulation       = m_raw;
+        properties.radianceCacheCapacity = m_radianceCache->getCapacity();
+        properties.frameId               = m_frameId++;
+
+        // A reset of the sample count only restarts the accumulation when it is not temporal
+        properties.temporal        = m_temporal;
+        properties.temporalHistory = static_cast<uint32_t>(TemporalHistory::None);
+        if (m_temporal && m_historyValid)
+        {
+            const bool moved = properties.view != m_previousView || properties.projection != m_previousProjection;
+
+            const TemporalHistory history = moved ? TemporalHistory::Reproject : TemporalHistory::Static;
+            properties.temporalHistory    = static_cast<uint32_t>(history);
+        }
+
+        properties.previousView       = m_previousView;
+        properties.previousProjection = m_previousProjection;
+        m_previousView                = properties.view;
+        m_previousProjection          = properties.projection;
+        m_historyValid                = m_temporal;
+        std::memcpy(m_uboData + imageId * m_uboAlignment, &properties, sizeof(HardwarePathTracingPass::Properties));
+
+        // Consecutive frames accumulate in the same images: order them on the device instead of on the host
         vzt::ImageBarrier imageBarrier{};
-        imageBarrier.image     = m_renderImage;
-        imageBarrier.oldLayout = vzt::ImageLayout::Undefined;
+        imageBarrier.oldLayout = vzt::ImageLayout::General;
         imageBarrier.newLayout = vzt::ImageLayout::General;
-        commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::Transfer, imageBarrier);
+        imageBarrier.src       = vzt::Access::ShaderWrite;
+        imageBarrier.dst       = vzt::Access::ShaderRead | vzt::Access::ShaderWrite;
+        const std::array<vzt::View<vzt::DeviceImage>, 10> accumulatedImages{
+            m_accumulationImage,         m_albedoImage,               m_normalImage,
+            m_instanceImage,             m_temporalColorImages[0],    m_temporalColorImages[1],
+            m_temporalGeometryImages[0], m_temporalGeometryImages[1], m_sumLowImage,
+            m_sumHighImage,
+        };
+        for (const vzt::View<vzt::DeviceImage> accumulated : accumulatedImages)
+        {
+            imageBarrier.image = accumulated;
+            commands.barrier(vzt::PipelineStage::RaytracingShader, vzt::PipelineStage::RaytracingShader, imageBarrier);
+        }
 
-        commands.bind(m_pipeline, m_descriptorPool[imageId]);
-        commands.traceRays({m_raygenShaderBindingTable.getDeviceAddress(), m_handleSizeAligned, m_handleSizeAligned},
-                           {m_missShaderBindingTable.getDeviceAddress(), m_handleSizeAligned, m_handleSizeAligned},
-                           {m_hitShaderBindingTable.getDeviceAddress(), m_handleSizeAligned, m_handleSizeAligned}, {},
-                           m_extent.width, m_extent.height, 1);
+        std::optional<KernelVariant> variant{};
+        if (m_kernelVariants)
+            variant = getKernelVariant(properties);
 
-        imageBarrier.image     = m_renderImage;
-        imageBarrier.oldLayout = vzt::ImageLayout::General;
-        imageBarrier.newLayout = vzt::ImageLayout::TransferSrcOptimal;
-        commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::Transfer, imageBarrier);
+        const Kernel& kernel = getKernel(variant);
+        if (radianceCache)
+            m_radianceCache->prepare(commands);
 
+        {
+            std::optional<GpuProfiler::Scope> scope{};
+            if (profiler)
+                scope.emplace(*profiler, imageId, commands, "Trace rays");
+
+            const VkDescriptorSet descriptorSet = m_descriptorPool[imageId];
+            vkCmdBindPipeline(commands.getHandle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, kernel.pipeline);
+            vkCmdBindDescriptorSets(commands.getHandle(), VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, m_pipelineLayout, 0,
+                                    1, &descriptorSet, 0, nullptr);
+            commands.traceRays(
+                {kernel.raygenShaderBindingTable.getDeviceAddress(), m_handleSizeAligned, m_handleSizeAligned},
+                {kernel.missShaderBindingTable.getDeviceAddress(), m_handleSizeAligned, m_handleSizeAligned},
+                {kernel.hitShaderBindingTable.getDeviceAddress(), m_handleSizeAligned, m_handleSizeAligned}, {},
+                m_extent.width, m_extent.height, 1);
+        }
+
+        if (radianceCache)
+            m_radianceCache->resolve(imageId, commands, profiler);
+    }
+
+    void HardwarePathTracingPass::copy(uint32_t imageId, vzt::CommandBuffer& commands,
+                                       const vzt::View<vzt::DeviceImage> outputImage, GpuProfiler* profiler)
+    {
+        // The render image is already transitioned by TonemapPass
+        vzt::ImageBarrier imageBarrier{};
         imageBarrier.image     = outputImage;
         imageBarrier.oldLayout = vzt::ImageLayout::Undefined;
         imageBarrier.newLayout = vzt::ImageLayout::TransferDstOptimal;
+        imageBarrier.src       = vzt::Access::None;
+        imageBarrier.dst       = vzt::Access::TransferWrite;
         commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::Transfer, imageBarrier);
 
-        commands.copy(m_renderImage, outputImage, m_extent.width, m_extent.height);
+        {
+            std::optional<GpuProfiler::Scope> scope{};
+            if (profiler)
+                scope.emplace(*profiler, imageId, commands, "Copy to output");
+
+            commands.copy(m_renderImage, outputImage, m_extent.width, m_extent.height);
+        }
 
         imageBarrier.image     = outputImage;
         imageBarrier.oldLayout = vzt::ImageLayout::TransferDstOptimal;
         imageBarrier.newLayout = vzt::ImageLayout::PresentSrcKHR;
-        commands.barrier(vzt::PipelineStage::TopOfPipe, vzt::PipelineStage::Transfer, imageBarrier);
+        imageBarrier.src       = vzt::Access::TransferWrite;
+        imageBarrier.dst       = vzt::Access::None;
+        commands.barrier(vzt::PipelineStage::Transfer, vzt::PipelineStage::BottomOfPipe, imageBarrier);
     }
 } // namespace lop
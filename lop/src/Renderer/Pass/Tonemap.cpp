@@ -0,0 +1,141 @@
+#include "lop/Renderer/Pass/Tonemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <optional>
+
+#include <vzt/Vulkan/Device.hpp>
+
+#include "lop/Renderer/GpuProfiler.hpp"
+#include "lop/Renderer/Pass/Denoiser.hpp"
+#include "lop/Renderer/Pass/HardwarePathTracing.hpp"
+
+namespace lop
+{
+    TonemapPass::TonemapPass(vzt::View<vzt::Device> device, uint32_t imageNb,
+                             vzt::View<HardwarePathTracingPass> pathtracing, vzt::View<DenoiserPass> denoiser)
+        : m_device(device), m_imageNb(imageNb), m_pathtracing(pathtracing), m_denoiser(denoiser), m_layout(device),
+          m_program(device), m_pipeline(device), m_descriptorPool(device, m_layout)
+    {
+        m_layout.addBinding(0, vzt::DescriptorType::StorageImage);  // Input
+        m_layout.addBinding(1, vzt::DescriptorType::StorageImage);  // Render image
+        m_layout.addBinding(2, vzt::DescriptorType::UniformBuffer); // Properties
+        m_layout.compile();
+
+        m_program.setShader(m_shaderCache.get("shaders/tonemap.comp", vzt::ShaderStage::Compute));
+        m_pipeline.setProgram(m_program);
+        m_pipeline.setDescriptorLayout(m_layout);
+        m_pipeline.compile();
+
+        m_descriptorPool.allocate(imageNb * SourceNb, m_layout);
+        m_outdatedDescriptors.resize(imageNb, true);
+
+        vzt::PhysicalDevice hardware = device->getHardware();
+        m_uboAlignment               = hardware.getUniformAlignment<TonemapPass::Properties>();
+
+        m_ubo = vzt::Buffer{
+            device, m_uboAlignment * imageNb, vzt::BufferUsage::UniformBuffer, vzt::MemoryLocation::Device, true,
+        };
+        m_uboData = m_ubo.map();
+
+        resize();
+    }
+
+    TonemapPass::~TonemapPass() { m_ubo.unMap(); }
+
+    void TonemapPass::resize()
+    {
+        m_extent = m_pathtracing->getExtent();
+
+        m_accumulationImageView =
+            vzt::ImageView{m_device, m_pathtracing->getAccumulationImage(), vzt::ImageAspect::Color};
+        m_denoisedImageView = vzt::ImageView{m_device, m_denoiser->getOutputImage(), vzt::ImageAspect::Color};
+        m_renderImageView   = vzt::ImageView{m_device, m_pathtracing->getRenderImage(), vzt::ImageAspect::Color};
+
+        std::fill(m_outdatedDescriptors.begin(), m_outdatedDescriptors.end(), true);
+    }
+
+    void TonemapPass::updateDescriptors(uint32_t imageId)
+    {
+        vzt::BufferSpan uboSpan{&m_ubo, sizeof(TonemapPass::Properties), imageId * m_uboAlignment};
+        for (uint32_t source = 0; source < SourceNb; source++)
+        {
+            const vzt::ImageView& input = static_cast<Source>(source) == Source::Accumulation ? m_accumulationImageView
+                                                                                               : m_denoisedImageView;
+
+            vzt::IndexedDescriptor ubos{};
+            ubos[0] = vzt::DescriptorImage{vzt::DescriptorType::StorageImage, input, {}, vzt::ImageLayout::General};
+            ubos[1] = vzt::DescriptorImage{
+                vzt::DescriptorType::StorageImage,
+                m_renderImageView,
+                {},
+                vzt::ImageLayout::General,
+            };
+            ubos[2] = vzt::DescriptorBuffer{vzt::DescriptorType::UniformBuffer, uboSpan};
+            m_descriptorPool.update(imageId * SourceNb + source, ubos);
+        }
+
+        m_outdatedDescriptors[imageId] = false;
+    }
+
+    void TonemapPass::record(uint32_t imageId, vzt::CommandBuffer& commands, Source source,
+                             const TonemapSettings& settings, GpuProfiler* profiler)
+    {
+        // The previous submission of this image id is complete: its descriptors and UBO slot are free
+        if (m_outdatedDescriptors[imageId])
+            updateDescriptors(imageId);
+
+        const Properties properties{
+            std::exp2(settings.exposure),
+            static_cast<uint32_t>(settings.tonemapOperator),
+            static_cast<uint32_t>(settings.outputTransform),
+        };
+        std::memcpy(m_uboData + imageId * m_uboAlignment, &properties, sizeof(TonemapPass::Properties));
+
+        const bool                        accumulation = source == Source::Accumulation;
+        const vzt::View<vzt::DeviceImage> inputImage =
+            accumulation ? m_pathtracing->getAccumulationImage() : m_denoiser->getOutputImage();
+        const vzt::PipelineStage inputStage =
+            accumulation ? vzt::PipelineStage::RaytracingShader : vzt::PipelineStage::ComputeShader;
+
+        vzt::ImageBarrier imageBarrier{};
+        imageBarrier.image     = inputImage;
+        imageBarrier.oldLayout = vzt::ImageLayout::General;
+        imageBarrier.newLayout = vzt::ImageLayout::General;
+        imageBarrier.src       = vzt::Access::ShaderWrite;
+        imageBarrier.dst       = vzt::Access::ShaderRead;
+        commands.barrier(inputStage, vzt::PipelineStage::ComputeShader, imageBarrier);
+
+        // The previous frame may still be copying the render image, whose content is replaced entirely
+        imageBarrier.image     = m_pathtracing->getRenderImage();
+        imageBarrier.oldLayout = vzt::ImageLayout::Undefined;
+        imageBarrier.newLayout = vzt::ImageLayout::General;
+        imageBarrier.src       = vzt::Access::TransferRead;
+        imageBarrier.dst       = vzt::Access::ShaderWrite;
+        commands.barrier(vzt::PipelineStage::Transfer, vzt::PipelineStage::ComputeShader, imageBarrier);
+
+        {
+            std::optional<GpuProfiler::Scope> scope{};
+            if (profiler)
+                scope.emplace(*profiler, imageId, commands, "Tonemap");
+
+            commands.bind(m_pipeline, m_descriptorPool[imageId * SourceNb + static_cast<uint32_t>(source)]);
+            commands.dispatch((m_extent.width + 7) / 8, (m_extent.height + 7) / 8, 1);
+        }
+
+        imageBarrier.oldLayout = vzt::ImageLayout::General;
+        imageBarrier.newLayout = vzt::ImageLayout::TransferSrcOptimal;
+        imageBarrier.src       = vzt::Access::ShaderWrite;
+        imageBarrier.dst       = vzt::Access::TransferRead;
+        commands.barrier(vzt::PipelineStage::ComputeShader, vzt::PipelineStage::Transfer, imageBarrier);
+
+        // The next trace, or denoiser pass, overwrites the input
+        imageBarrier.image     = inputImage;
+        imageBarrier.oldLayout = vzt::ImageLayout::General;
+        imageBarrier.newLayout = vzt::ImageLayout::General;
+        imageBarrier.src       = vzt::Access::ShaderRead;
+        imageBarrier.dst       = vzt::Access::ShaderRead | vzt::Access::ShaderWrite;
+        commands.barrier(vzt::PipelineStage::ComputeShader, inputStage, imageBarrier);
+    }
+} // namespace lop
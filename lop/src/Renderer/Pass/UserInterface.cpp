@@ -1,5 +1,7 @@
 #include "lop/Renderer/Pass/UserInterface.hpp"
 
+#include <optional>
+
 #include <backends/imgui_impl_sdl2.h>
 #include <backends/imgui_impl_vulkan.h>
 #include <imgui.h>
@@ -9,10 +11,13 @@
 #include <vzt/Vulkan/Swapchain.hpp>
 #include <vzt/Window.hpp>
 
+#include "lop/Renderer/GpuProfiler.hpp"
+
 namespace lop
 {
     UserInterfacePass::UserInterfacePass(vzt::Window& window, vzt::View<vzt::Instance> instance,
-                                         vzt::View<vzt::Device> device, vzt::View<vzt::Swapchain> swapchain)
+                                         vzt::View<vzt::Device> device, vzt::View<vzt::Swapchain> swapchain,
+                                         VkPipelineCache pipelineCache)
         : m_device(device), m_imageNb(swapchain->getImageNb()), m_swapchain(swapchain)
     {
         IMGUI_CHECKVERSION();
@@ -39,7 +44,7 @@ namespace lop
         vzt::View<vzt::Queue> graphicsQueue = m_device->getQueue(vzt::QueueType::Graphics);
         init_info.QueueFamily               = graphicsQueue->getId();
         init_info.Queue                     = graphicsQueue->getHandle();
-        init_info.PipelineCache             = VK_NULL_HANDLE;
+        init_info.PipelineCache             = pipelineCache;
 
         std::unordered_set<vzt::DescriptorType> poolTypes{
             vzt::DescriptorType::Sampler,
@@ -124,6 +129,7 @@ namespace lop
     void UserInterfacePass::resize(vzt::Extent2D extent)
     {
         m_frameBuffers.clear();
+        m_depthStencils.clear();
         for (uint32_t i = 0; i < m_imageNb; i++)
         {
             m_depthStencils.emplace_back(m_device, extent, vzt::ImageUsage::DepthStencilAttachment,
@@ -138,10 +144,14 @@ namespace lop
     }
 
     void UserInterfacePass::record(uint32_t imageId, vzt::CommandBuffer& commands,
-                                   const vzt::View<vzt::DeviceImage> outputImage)
+                                   const vzt::View<vzt::DeviceImage> outputImage, GpuProfiler* profiler)
     {
         ImGui::Render();
 
+        std::optional<GpuProfiler::Scope> scope{};
+        if (profiler)
+            scope.emplace(*profiler, imageId, commands, "User interface");
+
         commands.beginPass(m_renderPass, m_frameBuffers[imageId]);
         ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commands.getHandle());
         commands.endPass();
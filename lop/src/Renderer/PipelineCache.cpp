@@ -0,0 +1,89 @@
+#include "lop/Renderer/PipelineCache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <vzt/Core/Logger.hpp>
+#include <vzt/Vulkan/Device.hpp>
+
+namespace lop
+{
+    PipelineCache::PipelineCache(vzt::View<vzt::Device> device, vzt::Path path)
+        : m_device(device), m_path(std::move(path))
+    {
+        std::vector<uint8_t> data{};
+        {
+            std::ifstream file{m_path, std::ios::binary | std::ios::ate};
+            if (file)
+            {
+                data.resize(static_cast<std::size_t>(file.tellg()));
+                file.seekg(0);
+                file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            }
+        }
+
+        // Reference: Vulkan specification, 10.6.4. Pipeline Cache Header
+        if (data.size() >= sizeof(VkPipelineCacheHeaderVersionOne))
+        {
+            VkPipelineCacheHeaderVersionOne header{};
+            std::memcpy(&header, data.data(), sizeof(VkPipelineCacheHeaderVersionOne));
+
+            VkPhysicalDeviceProperties properties{};
+            vkGetPhysicalDeviceProperties(m_device->getHardware().getHandle(), &properties);
+
+            const bool valid = header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                               header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+                               std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+            if (!valid)
+            {
+                vzt::logger::info("Discarding pipeline cache {} created by another device or driver", m_path.string());
+                data.clear();
+            }
+        }
+        else
+        {
+            data.clear();
+        }
+
+        VkPipelineCacheCreateInfo createInfo{};
+        createInfo.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.initialDataSize = data.size();
+        createInfo.pInitialData    = data.empty() ? nullptr : data.data();
+        if (vkCreatePipelineCache(m_device->getHandle(), &createInfo, nullptr, &m_handle) != VK_SUCCESS)
+            vzt::logger::error("Failed to create pipeline cache");
+    }
+
+    PipelineCache::~PipelineCache()
+    {
+        if (m_handle == VK_NULL_HANDLE)
+            return;
+
+        save();
+        vkDestroyPipelineCache(m_device->getHandle(), m_handle, nullptr);
+    }
+
+    void PipelineCache::save() const
+    {
+        std::size_t size = 0;
+        if (vkGetPipelineCacheData(m_device->getHandle(), m_handle, &size, nullptr) != VK_SUCCESS || size == 0)
+            return;
+
+        std::vector<uint8_t> data(size);
+        if (vkGetPipelineCacheData(m_device->getHandle(), m_handle, &size, data.data()) != VK_SUCCESS)
+            return;
+
+        std::error_code error;
+        std::filesystem::create_directories(m_path.parent_path(), error);
+
+        std::ofstream file{m_path, std::ios::binary};
+        if (!file)
+        {
+            vzt::logger::warn("Failed to save pipeline cache at {}", m_path.string());
+            return;
+        }
+
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(size));
+    }
+} // namespace lop
@@ -0,0 +1,107 @@
+#include "lop/Renderer/RadianceCache.hpp"
+
+#include <cassert>
+#include <optional>
+
+#include <fmt/format.h>
+#include <vzt/Vulkan/Device.hpp>
+
+#include "lop/Renderer/GpuProfiler.hpp"
+
+namespace lop
+{
+    RadianceCache::RadianceCache(vzt::View<vzt::Device> device, uint32_t capacity)
+        : m_device(device), m_capacity(capacity), m_layout(device), m_clearProgram(device), m_clearPipeline(device),
+          m_resolveProgram(device), m_resolvePipeline(device), m_descriptorPool(device, m_layout)
+    {
+        assert(capacity != 0 && (capacity & (capacity - 1)) == 0 && "Capacity must be a power of two");
+
+        m_layout.addBinding(0, vzt::DescriptorType::StorageBuffer); // Keys
+        m_layout.addBinding(1, vzt::DescriptorType::StorageBuffer); // Accumulation
+        m_layout.addBinding(2, vzt::DescriptorType::StorageBuffer); // Resolved
+        m_layout.addBinding(3, vzt::DescriptorType::StorageBuffer); // Ages
+        m_layout.compile();
+
+        const std::vector<std::string> defines = {
+            fmt::format("LOP_RADIANCE_CACHE_CAPACITY {}", capacity),
+            fmt::format("LOP_RADIANCE_CACHE_MAX_AGE {}", MaxAge),
+        };
+
+        std::vector<std::string> clearDefines = defines;
+        clearDefines.emplace_back("LOP_RADIANCE_CACHE_CLEAR 1");
+        m_clearProgram.setShader(
+            m_shaderCache.get("shaders/radiance_cache.comp", vzt::ShaderStage::Compute, clearDefines));
+        m_clearPipeline.setProgram(m_clearProgram);
+        m_clearPipeline.setDescriptorLayout(m_layout);
+        m_clearPipeline.compile();
+
+        m_resolveProgram.setShader(
+            m_shaderCache.get("shaders/radiance_cache.comp", vzt::ShaderStage::Compute, defines));
+        m_resolvePipeline.setProgram(m_resolveProgram);
+        m_resolvePipeline.setDescriptorLayout(m_layout);
+        m_resolvePipeline.compile();
+
+        m_keys         = vzt::Buffer{device, sizeof(uint32_t) * capacity, vzt::BufferUsage::StorageBuffer};
+        m_accumulation = vzt::Buffer{device, sizeof(uint32_t) * 4 * capacity, vzt::BufferUsage::StorageBuffer};
+        m_resolved     = vzt::Buffer{device, sizeof(vzt::Vec4) * capacity, vzt::BufferUsage::StorageBuffer};
+        m_ages         = vzt::Buffer{device, sizeof(uint32_t) * capacity, vzt::BufferUsage::StorageBuffer};
+
+        // Buffers never change, a single set serves every frame: they are ordered on the device by barriers
+        m_descriptorPool.allocate(1, m_layout);
+
+        vzt::IndexedDescriptor ubos{};
+        ubos[0] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, vzt::BufferSpan{&m_keys, m_keys.size()}};
+        ubos[1] = vzt::DescriptorBuffer{
+            vzt::DescriptorType::StorageBuffer,
+            vzt::BufferSpan{&m_accumulation, m_accumulation.size()},
+        };
+        ubos[2] = vzt::DescriptorBuffer{
+            vzt::DescriptorType::StorageBuffer,
+            vzt::BufferSpan{&m_resolved, m_resolved.size()},
+        };
+        ubos[3] = vzt::DescriptorBuffer{vzt::DescriptorType::StorageBuffer, vzt::BufferSpan{&m_ages, m_ages.size()}};
+        m_descriptorPool.update(0, ubos);
+    }
+
+    void RadianceCache::prepare(vzt::CommandBuffer& commands)
+    {
+        // The previous resolve must be complete before the trace reads the cells
+        if (!m_outdated)
+        {
+            barrier(commands, vzt::PipelineStage::ComputeShader, vzt::PipelineStage::RaytracingShader);
+            return;
+        }
+
+        barrier(commands, vzt::PipelineStage::RaytracingShader, vzt::PipelineStage::ComputeShader);
+        commands.bind(m_clearPipeline, m_descriptorPool[0]);
+        commands.dispatch((m_capacity + 63) / 64, 1, 1);
+        barrier(commands, vzt::PipelineStage::ComputeShader, vzt::PipelineStage::RaytracingShader);
+
+        m_outdated = false;
+    }
+
+    void RadianceCache::resolve(uint32_t imageId, vzt::CommandBuffer& commands, GpuProfiler* profiler)
+    {
+        barrier(commands, vzt::PipelineStage::RaytracingShader, vzt::PipelineStage::ComputeShader);
+
+        std::optional<GpuProfiler::Scope> scope{};
+        if (profiler)
+            scope.emplace(*profiler, imageId, commands, "Radiance cache");
+
+        commands.bind(m_resolvePipeline, m_descriptorPool[0]);
+        commands.dispatch((m_capacity + 63) / 64, 1, 1);
+    }
+
+    void RadianceCache::barrier(vzt::CommandBuffer& commands, vzt::PipelineStage src, vzt::PipelineStage dst) const
+    {
+        vzt::BufferBarrier bufferBarrier{};
+        bufferBarrier.src = vzt::Access::ShaderRead | vzt::Access::ShaderWrite;
+        bufferBarrier.dst = vzt::Access::ShaderRead | vzt::Access::ShaderWrite;
+
+        for (const vzt::Buffer* buffer : {&m_keys, &m_accumulation, &m_resolved, &m_ages})
+        {
+            bufferBarrier.buffer = vzt::BufferCSpan{*buffer, buffer->size()};
+            commands.barrier(src, dst, bufferBarrier);
+        }
+    }
+} // namespace lop
@@ -0,0 +1,137 @@
+#include "lop/Renderer/RenderScene.hpp"
+
+namespace lop
+{
+    RenderScene::RenderScene(entt::registry& registry) : m_registry(&registry)
+    {
+        // Entities created before the scene
+        for (entt::entity entity : registry.view<MeshHolder, Transform, Material>())
+            onConstruct(registry, entity);
+
+        registry.on_construct<MeshHolder>().connect<&RenderScene::onConstruct>(*this);
+        registry.on_construct<Transform>().connect<&RenderScene::onConstruct>(*this);
+        registry.on_construct<Material>().connect<&RenderScene::onConstruct>(*this);
+
+        registry.on_destroy<MeshHolder>().connect<&RenderScene::onDestroy>(*this);
+        registry.on_destroy<Transform>().connect<&RenderScene::onDestroy>(*this);
+        registry.on_destroy<Material>().connect<&RenderScene::onDestroy>(*this);
+
+        registry.on_update<MeshHolder>().connect<&RenderScene::onGeometryUpdate>(*this);
+        registry.on_update<Material>().connect<&RenderScene::onMaterialUpdate>(*this);
+    }
+
+    RenderScene::~RenderScene()
+    {
+        m_registry->on_construct<MeshHolder>().disconnect(*this);
+        m_registry->on_construct<Transform>().disconnect(*this);
+        m_registry->on_construct<Material>().disconnect(*this);
+
+        m_registry->on_destroy<MeshHolder>().disconnect(*this);
+        m_registry->on_destroy<Transform>().disconnect(*this);
+        m_registry->on_destroy<Material>().disconnect(*this);
+
+        m_registry->on_update<MeshHolder>().disconnect(*this);
+        m_registry->on_update<Material>().disconnect(*this);
+    }
+
+    SceneChanges RenderScene::extract(const TransformHierarchy& hierarchy)
+    {
+        for (const entt::entity entity : m_inserted)
+        {
+            const uint32_t instance = getInstance(entity);
+            const uint32_t node     = hierarchy.getNode(entity);
+            if (instance != NoInstance && node != TransformHierarchy::NoNode)
+            {
+                m_transforms[instance]      = hierarchy.getWorld(node);
+                m_closeTransforms[instance] = hierarchy.getCloseWorld(node);
+            }
+        }
+        m_inserted.clear();
+
+        const vzt::CSpan<uint32_t> updated = hierarchy.getUpdatedNodes();
+        for (std::size_t i = 0; i < updated.size; i++)
+        {
+            const uint32_t instance = getInstance(hierarchy.getEntity(updated[i]));
+            if (instance == NoInstance)
+                continue;
+
+            m_transforms[instance]      = hierarchy.getWorld(updated[i]);
+            m_closeTransforms[instance] = hierarchy.getCloseWorld(updated[i]);
+            m_changes.instances         = true;
+        }
+
+        const SceneChanges changes = m_changes;
+        m_changes                  = {};
+        return changes;
+    }
+
+    void RenderScene::onConstruct(entt::registry& registry, entt::entity entity)
+    {
+        if (getInstance(entity) != NoInstance || !registry.all_of<MeshHolder, Transform, Material>(entity))
+            return;
+
+        const std::size_t id = static_cast<std::size_t>(entt::to_entity(entity));
+        if (id >= m_instances.size())
+            m_instances.resize(id + 1, NoInstance);
+        m_instances[id] = getInstanceNb();
+
+        const auto& [holder, transform, material] = registry.get<MeshHolder, Transform, Material>(entity);
+        m_entities.emplace_back(entity);
+        m_transforms.emplace_back(InstanceTransform::from(transform));
+        m_closeTransforms.emplace_back(m_transforms.back());
+        m_records.emplace_back(getRecord(holder));
+        m_materials.emplace_back(material);
+        m_inserted.emplace_back(entity);
+
+        m_changes.instances = true;
+        m_changes.materials = true;
+    }
+
+    void RenderScene::onDestroy(entt::registry& /* registry */, entt::entity entity)
+    {
+        const uint32_t instance = getInstance(entity);
+        if (instance == NoInstance)
+            return;
+
+        // The last instance takes the place of the removed one
+        const uint32_t last = getInstanceNb() - 1;
+        if (instance != last)
+        {
+            m_entities[instance]        = m_entities[last];
+            m_transforms[instance]      = m_transforms[last];
+            m_closeTransforms[instance] = m_closeTransforms[last];
+            m_records[instance]         = m_records[last];
+            m_materials[instance]       = m_materials[last];
+
+            m_instances[static_cast<std::size_t>(entt::to_entity(m_entities[instance]))] = instance;
+        }
+
+        m_entities.pop_back();
+        m_transforms.pop_back();
+        m_closeTransforms.pop_back();
+        m_records.pop_back();
+        m_materials.pop_back();
+        m_instances[static_cast<std::size_t>(entt::to_entity(entity))] = NoInstance;
+
+        m_changes.instances = true;
+        m_changes.materials = true;
+    }
+
+    void RenderScene::onMaterialUpdate(entt::registry& registry, entt::entity entity)
+    {
+        if (const uint32_t instance = getInstance(entity); instance != NoInstance)
+        {
+            m_materials[instance] = registry.get<Material>(entity);
+            m_changes.materials   = true;
+        }
+    }
+
+    void RenderScene::onGeometryUpdate(entt::registry& registry, entt::entity entity)
+    {
+        if (const uint32_t instance = getInstance(entity); instance != NoInstance)
+        {
+            m_records[instance] = getRecord(registry.get<MeshHolder>(entity));
+            m_changes.instances = true;
+        }
+    }
+} // namespace lop
@@ -0,0 +1,297 @@
+#include "lop/Renderer/ShaderCache.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <unordered_set>
+
+#include <fmt/format.h>
+#include <vzt/Core/Logger.hpp>
+
+#include "lop/System/Profiler.hpp"
+
+namespace lop
+{
+    namespace
+    {
+        constexpr uint64_t FnvOffset = 0xcbf29ce484222325ull;
+        constexpr uint64_t FnvPrime  = 0x100000001b3ull;
+
+        std::optional<std::string> readText(const vzt::Path& path)
+        {
+            std::ifstream file{path, std::ios::binary};
+            if (!file)
+                return {};
+
+            return std::string{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+        }
+
+        std::optional<std::vector<uint32_t>> readSpirv(const vzt::Path& path)
+        {
+            std::ifstream file{path, std::ios::binary | std::ios::ate};
+            if (!file)
+                return {};
+
+            const auto size = static_cast<std::size_t>(file.tellg());
+            if (size == 0 || size % sizeof(uint32_t) != 0)
+                return {};
+
+            std::vector<uint32_t> spirv(size / sizeof(uint32_t));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(spirv.data()), static_cast<std::streamsize>(size));
+            if (!file)
+                return {};
+
+            return spirv;
+        }
+
+        // Calls visitor for the source and every file it includes, following the compiler's lookup: relative to the
+        // root shader folder first, then to the including file.
+        template <class Visitor>
+        void visitSources(const vzt::Path& root, const vzt::Path& path, std::unordered_set<std::string>& visited,
+                          Visitor&& visitor)
+        {
+            if (!visited.emplace(path.lexically_normal().string()).second)
+                return;
+
+            const std::optional<std::string> source = readText(path);
+            if (!source)
+                return;
+
+            visitor(path, *source);
+
+            constexpr std::string_view Include = "#include \"";
+
+            std::size_t position = source->find(Include);
+            while (position != std::string::npos)
+            {
+                const std::size_t start = position + Include.size();
+                const std::size_t end   = source->find('"', start);
+                if (end == std::string::npos)
+                    break;
+
+                const vzt::Path include = source->substr(start, end - start);
+                vzt::Path       target  = root / include;
+                if (!std::filesystem::exists(target))
+                    target = path.parent_path() / include;
+
+                visitSources(root, target, visited, visitor);
+                position = source->find(Include, end);
+            }
+        }
+
+        // Replaces each include directive by the included file, following the lookup of visitSources. Every file is
+        // inlined once, as they all have include guards, so that the result compiles from any folder.
+        std::string inlineIncludes(const vzt::Path& root, const vzt::Path& path, const std::string& source,
+                                   std::unordered_set<std::string>& visited)
+        {
+            constexpr std::string_view Include = "#include \"";
+
+            std::string result{};
+            std::size_t copied   = 0;
+            std::size_t position = source.find(Include);
+            while (position != std::string::npos)
+            {
+                const std::size_t start = position + Include.size();
+                const std::size_t end   = source.find('"', start);
+                if (end == std::string::npos)
+                    break;
+
+                std::size_t lineEnd = source.find('\n', end);
+                lineEnd             = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+
+                const vzt::Path include = source.substr(start, end - start);
+                vzt::Path       target  = root / include;
+                if (!std::filesystem::exists(target))
+                    target = path.parent_path() / include;
+
+                result.append(source, copied, position - copied);
+                copied = lineEnd;
+
+                // Already inlined, the directive is replaced by an empty line
+                if (!visited.emplace(target.lexically_normal().string()).second)
+                {
+                    result += '\n';
+                    position = source.find(Include, lineEnd);
+                    continue;
+                }
+
+                // Left to the compiler to report
+                const std::optional<std::string> content = readText(target);
+                if (!content)
+                {
+                    result.append(source, position, lineEnd - position);
+                    position = source.find(Include, lineEnd);
+                    continue;
+                }
+
+                // Keep line numbers of compilation errors matching the including file after the included one
+                const auto line = std::count(source.begin(), source.begin() + static_cast<std::ptrdiff_t>(lineEnd),
+                                             '\n');
+                result += fmt::format("#line 1\n{}\n#line {}\n", inlineIncludes(root, target, *content, visited),
+                                      line + 1);
+
+                position = source.find(Include, lineEnd);
+            }
+
+            result.append(source, copied, std::string::npos);
+            return result;
+        }
+
+        // Build-time SPIR-V is only trusted if no source it depends on was edited afterward
+        std::optional<std::vector<uint32_t>> readPrecompiled(const vzt::Path& source, const vzt::Path& precompiled)
+        {
+            if (!std::filesystem::exists(precompiled))
+                return {};
+
+            const auto compilationTime = std::filesystem::last_write_time(precompiled);
+
+            bool                            upToDate = true;
+            std::unordered_set<std::string> visited{};
+            visitSources(source.parent_path(), source, visited, [&](const vzt::Path& path, const std::string&) {
+                upToDate &= std::filesystem::last_write_time(path) <= compilationTime;
+            });
+
+            if (!upToDate)
+                return {};
+
+            return readSpirv(precompiled);
+        }
+    } // namespace
+
+    uint64_t hashShaderSource(const vzt::Path& path)
+    {
+        uint64_t                        hash = FnvOffset;
+        std::unordered_set<std::string> visited{};
+        visitSources(path.parent_path(), path, visited, [&hash](const vzt::Path&, const std::string& source) {
+            for (const char c : source)
+            {
+                hash ^= static_cast<uint8_t>(c);
+                hash *= FnvPrime;
+            }
+        });
+
+        return hash;
+    }
+
+    ShaderCache::ShaderCache(vzt::Path cacheDirectory) : m_cacheDirectory(std::move(cacheDirectory)) {}
+
+    vzt::Shader ShaderCache::get(const vzt::Path& path, vzt::ShaderStage stage, const std::vector<std::string>& defines)
+    {
+        if (defines.empty())
+            return get(path, stage);
+
+        uint64_t permutationHash = FnvOffset;
+        for (const std::string& define : defines)
+        {
+            for (const char c : define)
+            {
+                permutationHash ^= static_cast<uint8_t>(c);
+                permutationHash *= FnvPrime;
+            }
+        }
+
+        const std::string permutationName = fmt::format("{}.{:08x}{}", path.stem().string(),
+                                                        static_cast<uint32_t>(permutationHash),
+                                                        path.extension().string());
+
+        // Default permutations are compiled at build time next to the source, see add_shader_permutation
+        if (auto spirv = readPrecompiled(path, path.parent_path() / fmt::format("{}.spv", permutationName)))
+            return vzt::Shader{stage, std::move(*spirv)};
+
+        const std::optional<std::string> original = readText(path);
+        if (!original)
+        {
+            vzt::logger::error("Failed to read shader {}", path.string());
+            return get(path, stage);
+        }
+
+        // The permutation is written in the cache directory, includes are resolved from the folder of the source
+        std::unordered_set<std::string> visited{path.lexically_normal().string()};
+        const std::string               source = inlineIncludes(path.parent_path(), path, *original, visited);
+
+        std::string header{};
+        for (const std::string& define : defines)
+            header += fmt::format("#define {}\n", define);
+
+        std::size_t insertion = 0;
+        if (source.compare(0, 8, "#version") == 0)
+        {
+            insertion = source.find('\n');
+            insertion = insertion == std::string::npos ? source.size() : insertion + 1;
+        }
+
+        // Keep line numbers of compilation errors matching the original source
+        const auto  line = std::count(source.begin(), source.begin() + static_cast<std::ptrdiff_t>(insertion), '\n');
+        std::string permutation = source.substr(0, insertion) + header + fmt::format("#line {}\n", line + 1) +
+                                  source.substr(insertion);
+
+        const vzt::Path permutationPath = m_cacheDirectory / permutationName;
+
+        // Only rewrite the permutation when it changed. Other processes may read it meanwhile: it is written to a
+        // unique temporary file first, then renamed.
+        if (readText(permutationPath) != permutation)
+        {
+            std::error_code error;
+            std::filesystem::create_directories(m_cacheDirectory, error);
+
+            const vzt::Path temporary =
+                vzt::Path(permutationPath).concat(fmt::format(".{:08x}.tmp", std::random_device{}()));
+
+            bool written = false;
+            {
+                std::ofstream file{temporary, std::ios::binary};
+                file << permutation;
+                written = static_cast<bool>(file);
+            }
+
+            if (written)
+                std::filesystem::rename(temporary, permutationPath, error);
+
+            // Features are then read at runtime by the generic kernel
+            if (!written || error)
+            {
+                std::filesystem::remove(temporary, error);
+                vzt::logger::error("Failed to write shader permutation {}", permutationPath.string());
+                return get(path, stage);
+            }
+        }
+
+        return get(permutationPath, stage);
+    }
+
+    vzt::Shader ShaderCache::get(const vzt::Path& path, vzt::ShaderStage stage)
+    {
+        ScopedTimer timer{"ShaderCache::get"};
+
+        if (auto spirv = readPrecompiled(path, vzt::Path(path).concat(".spv")))
+            return vzt::Shader{stage, std::move(*spirv)};
+
+        const uint64_t  hash   = hashShaderSource(path);
+        const vzt::Path cached = m_cacheDirectory / fmt::format("{}.{:016x}.spv", path.filename().string(), hash);
+        if (auto spirv = readSpirv(cached))
+            return vzt::Shader{stage, std::move(*spirv)};
+
+        if (!m_compiler)
+            m_compiler.emplace();
+
+        vzt::Shader shader = m_compiler->compile(path, stage);
+
+        std::error_code error;
+        std::filesystem::create_directories(m_cacheDirectory, error);
+
+        std::ofstream file{cached, std::ios::binary};
+        if (file)
+        {
+            file.write(reinterpret_cast<const char*>(shader.compiledSource.data()),
+                       static_cast<std::streamsize>(shader.compiledSource.size() * sizeof(uint32_t)));
+        }
+        else
+        {
+            vzt::logger::warn("Failed to write shader cache entry {}", cached.string());
+        }
+
+        return shader;
+    }
+} // namespace lop
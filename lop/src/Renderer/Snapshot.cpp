@@ -1,8 +1,14 @@
 #include "lop/Renderer/Snapshot.hpp"
 
+#include <algorithm>
+#include <fstream>
+
 #include <vzt/Core/Logger.hpp>
 #include <vzt/Vulkan/Device.hpp>
 
+#include "lop/Renderer/Pass/HardwarePathTracing.hpp"
+#include "lop/System/Profiler.hpp"
+
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image_write.h>
 
@@ -10,6 +16,16 @@ namespace lop
 {
     void snapshot(vzt::View<vzt::Device> device, vzt::View<vzt::DeviceImage> outputImage, const vzt::Path& outputPath)
     {
+        ScopedTimer timer{"snapshot"};
+
+        if (!writePng(outputPath, readbackDisplay(device, outputImage)))
+            vzt::logger::error("Failed to save snapshot at {}", outputPath.string());
+    }
+
+    Image<uint8_t> readbackDisplay(vzt::View<vzt::Device> device, vzt::View<vzt::DeviceImage> outputImage)
+    {
+        ScopedTimer timer{"readbackDisplay"};
+
         const vzt::Extent3D extent = outputImage->getSize();
 
         vzt::ImageBuilder imageBuilder{};
@@ -60,8 +76,249 @@ namespace lop
         }
         targetImage.unmap();
 
-        const std::string str = outputPath.string();
-        if (!stbi_write_png(str.c_str(), extent.width, extent.height, 4, cpuData.data(), 0))
-            vzt::logger::error("Failed to save snapshot at {}", str);
+        return Image<uint8_t>{extent.width, extent.height, 4u, std::move(cpuData)};
+    }
+
+    bool writePng(const vzt::Path& path, const Image<uint8_t>& image)
+    {
+        ScopedTimer timer{"writePng"};
+
+        const std::string str = path.string();
+        return stbi_write_png(str.c_str(), static_cast<int>(image.width), static_cast<int>(image.height),
+                              static_cast<int>(image.channels), image.data.data(), 0) != 0;
+    }
+
+    namespace
+    {
+        // Copy an image in general layout to host memory, rows tightly packed
+        std::vector<uint8_t> readbackBytes(vzt::View<vzt::Device> device, vzt::View<vzt::DeviceImage> image,
+                                           vzt::Format format, std::size_t pixelSize)
+        {
+            const vzt::Extent3D extent = image->getSize();
+
+            vzt::ImageBuilder imageBuilder{};
+            imageBuilder.size     = extent;
+            imageBuilder.usage    = vzt::ImageUsage::TransferDst;
+            imageBuilder.format   = format;
+            imageBuilder.tiling   = vzt::ImageTiling::Linear;
+            imageBuilder.mappable = true;
+            auto targetImage      = vzt::DeviceImage(device, imageBuilder);
+
+            const auto queue = device->getQueue(vzt::QueueType::Graphics | vzt::QueueType::Compute);
+            queue->oneShot([&](vzt::CommandBuffer& commands) {
+                vzt::ImageBarrier transition{};
+                transition.image     = image;
+                transition.oldLayout = vzt::ImageLayout::General;
+                transition.newLayout = vzt::ImageLayout::TransferSrcOptimal;
+                commands.barrier(vzt::PipelineStage::RaytracingShader, vzt::PipelineStage::Transfer, transition);
+
+                transition.image     = targetImage;
+                transition.oldLayout = vzt::ImageLayout::Undefined;
+                transition.newLayout = vzt::ImageLayout::TransferDstOptimal;
+                commands.barrier(vzt::PipelineStage::Transfer, vzt::PipelineStage::Transfer, transition);
+
+                commands.copy(image, targetImage, extent.width, extent.height);
+
+                transition.image     = image;
+                transition.oldLayout = vzt::ImageLayout::TransferSrcOptimal;
+                transition.newLayout = vzt::ImageLayout::General;
+                commands.barrier(vzt::PipelineStage::Transfer, vzt::PipelineStage::RaytracingShader, transition);
+
+                transition.image     = targetImage;
+                transition.oldLayout = vzt::ImageLayout::TransferDstOptimal;
+                transition.newLayout = vzt::ImageLayout::General;
+                commands.barrier(vzt::PipelineStage::Transfer, vzt::PipelineStage::Transfer, transition);
+            });
+
+            const vzt::SubresourceLayout subresourceLayout = targetImage.getSubresourceLayout(vzt::ImageAspect::Color);
+            const uint8_t*               mappedData        = targetImage.map<uint8_t>();
+            mappedData += subresourceLayout.offset;
+
+            std::vector<uint8_t> pixels = std::vector<uint8_t>(extent.width * extent.height * pixelSize);
+            for (uint32_t y = 0; y < extent.height; y++)
+            {
+                const std::size_t dstStride = y * extent.width * pixelSize;
+                const std::size_t srcStride = y * subresourceLayout.rowPitch;
+                std::memcpy(pixels.data() + dstStride, mappedData + srcStride, extent.width * pixelSize);
+            }
+            targetImage.unmap();
+
+            return pixels;
+        }
+
+        template <class Type>
+        void write(std::ofstream& file, const Type& value)
+        {
+            file.write(reinterpret_cast<const char*>(&value), sizeof(Type));
+        }
+
+        void writeAttribute(std::ofstream& file, std::string_view name, std::string_view type, const void* data,
+                            int32_t size)
+        {
+            file.write(name.data(), static_cast<std::streamsize>(name.size()));
+            file.put('\0');
+            file.write(type.data(), static_cast<std::streamsize>(type.size()));
+            file.put('\0');
+            write(file, size);
+            file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        }
+    } // namespace
+
+    Image<float> readback(vzt::View<vzt::Device> device, vzt::View<vzt::DeviceImage> image)
+    {
+        ScopedTimer timer{"readback"};
+
+        constexpr std::size_t PixelSize = 4 * sizeof(float);
+
+        const vzt::Extent3D        extent = image->getSize();
+        const std::vector<uint8_t> bytes  = readbackBytes(device, image, vzt::Format::R32G32B32A32SFloat, PixelSize);
+
+        std::vector<float> pixels = std::vector<float>(extent.width * extent.height * 4);
+        std::memcpy(pixels.data(), bytes.data(), bytes.size());
+
+        return Image<float>{extent.width, extent.height, 4u, std::move(pixels)};
+    }
+
+    Image<uint32_t> readbackUint(vzt::View<vzt::Device> device, vzt::View<vzt::DeviceImage> image)
+    {
+        ScopedTimer timer{"readback"};
+
+        const vzt::Extent3D        extent = image->getSize();
+        const std::vector<uint8_t> bytes  = readbackBytes(device, image, vzt::Format::R32UInt, sizeof(uint32_t));
+
+        std::vector<uint32_t> pixels = std::vector<uint32_t>(extent.width * extent.height);
+        std::memcpy(pixels.data(), bytes.data(), bytes.size());
+
+        return Image<uint32_t>{extent.width, extent.height, 1u, std::move(pixels)};
+    }
+
+    Image<uint32_t> readbackUint4(vzt::View<vzt::Device> device, vzt::View<vzt::DeviceImage> image)
+    {
+        ScopedTimer timer{"readback"};
+
+        constexpr std::size_t PixelSize = 4 * sizeof(uint32_t);
+
+        const vzt::Extent3D        extent = image->getSize();
+        const std::vector<uint8_t> bytes  = readbackBytes(device, image, vzt::Format::R32G32B32A32UInt, PixelSize);
+
+        std::vector<uint32_t> pixels = std::vector<uint32_t>(extent.width * extent.height * 4);
+        std::memcpy(pixels.data(), bytes.data(), bytes.size());
+
+        return Image<uint32_t>{extent.width, extent.height, 4u, std::move(pixels)};
+    }
+
+    ExrChannel ExrChannel::fromImage(std::string name, const Image<float>& image, uint32_t channel)
+    {
+        std::vector<float> values(std::size_t(image.width) * image.height);
+        for (std::size_t i = 0; i < values.size(); i++)
+            values[i] = image.data[i * image.channels + channel];
+
+        return {std::move(name), std::move(values)};
+    }
+
+    bool writeExr(const vzt::Path& path, uint32_t width, uint32_t height, std::vector<ExrChannel> channels)
+    {
+        ScopedTimer timer{"writeExr"};
+
+        std::ofstream file{path, std::ios::binary};
+        if (!file)
+        {
+            vzt::logger::error("Failed to open {}", path.string());
+            return false;
+        }
+
+        // The specification requires channels sorted by name, both in the header and in the scanlines
+        std::sort(channels.begin(), channels.end(),
+                  [](const ExrChannel& a, const ExrChannel& b) { return a.name < b.name; });
+
+        constexpr uint8_t MagicNumber[4] = {0x76, 0x2f, 0x31, 0x01};
+        file.write(reinterpret_cast<const char*>(MagicNumber), sizeof(MagicNumber));
+        write(file, int32_t(2)); // Version 2, single-part scanline
+
+        std::vector<char> channelList{};
+        for (const ExrChannel& channel : channels)
+        {
+            const int32_t type        = std::holds_alternative<std::vector<uint32_t>>(channel.values) ? 0 : 2;
+            const int32_t sampling[2] = {1, 1};
+
+            channelList.insert(channelList.end(), channel.name.begin(), channel.name.end());
+            channelList.emplace_back('\0');
+            channelList.insert(channelList.end(), reinterpret_cast<const char*>(&type),
+                               reinterpret_cast<const char*>(&type) + sizeof(int32_t));
+            channelList.insert(channelList.end(), 4, '\0'); // pLinear and reserved
+            channelList.insert(channelList.end(), reinterpret_cast<const char*>(sampling),
+                               reinterpret_cast<const char*>(sampling) + sizeof(sampling));
+        }
+        channelList.emplace_back('\0');
+
+        const int32_t dataWindow[4]         = {0, 0, int32_t(width) - 1, int32_t(height) - 1};
+        const uint8_t compression           = 0; // None
+        const uint8_t lineOrder             = 0; // Increasing y
+        const float   pixelAspectRatio      = 1.f;
+        const float   screenWindowCenter[2] = {0.f, 0.f};
+        const float   screenWindowWidth     = 1.f;
+
+        writeAttribute(file, "channels", "chlist", channelList.data(), int32_t(channelList.size()));
+        writeAttribute(file, "compression", "compression", &compression, sizeof(compression));
+        writeAttribute(file, "dataWindow", "box2i", dataWindow, sizeof(dataWindow));
+        writeAttribute(file, "displayWindow", "box2i", dataWindow, sizeof(dataWindow));
+        writeAttribute(file, "lineOrder", "lineOrder", &lineOrder, sizeof(lineOrder));
+        writeAttribute(file, "pixelAspectRatio", "float", &pixelAspectRatio, sizeof(pixelAspectRatio));
+        writeAttribute(file, "screenWindowCenter", "v2f", screenWindowCenter, sizeof(screenWindowCenter));
+        writeAttribute(file, "screenWindowWidth", "float", &screenWindowWidth, sizeof(screenWindowWidth));
+        file.put('\0');
+
+        // Uncompressed files store one scanline per chunk, every value being 4 bytes here
+        const int32_t  lineSize    = int32_t(width * channels.size() * sizeof(uint32_t));
+        const uint64_t tableOffset = uint64_t(file.tellp());
+        for (uint32_t y = 0; y < height; y++)
+            write(file, tableOffset + height * sizeof(uint64_t) + y * (2 * sizeof(int32_t) + uint64_t(lineSize)));
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            write(file, int32_t(y));
+            write(file, lineSize);
+            for (const ExrChannel& channel : channels)
+            {
+                std::visit(
+                    [&](const auto& values) {
+                        file.write(reinterpret_cast<const char*>(values.data() + std::size_t(y) * width),
+                                   static_cast<std::streamsize>(width * sizeof(uint32_t)));
+                    },
+                    channel.values);
+            }
+        }
+
+        return bool(file);
+    }
+
+    bool snapshotLayers(vzt::View<vzt::Device> device, const HardwarePathTracingPass& pass, const vzt::Path& path)
+    {
+        const Image<float> beauty = readback(device, pass.getAccumulationImage());
+
+        std::vector<ExrChannel> channels{};
+        channels.emplace_back(ExrChannel::fromImage("R", beauty, 0));
+        channels.emplace_back(ExrChannel::fromImage("G", beauty, 1));
+        channels.emplace_back(ExrChannel::fromImage("B", beauty, 2));
+        channels.emplace_back(ExrChannel::fromImage("A", beauty, 3));
+
+        if (pass.getAovs())
+        {
+            const Image<float> albedo = readback(device, pass.getAlbedoImage());
+            channels.emplace_back(ExrChannel::fromImage("albedo.R", albedo, 0));
+            channels.emplace_back(ExrChannel::fromImage("albedo.G", albedo, 1));
+            channels.emplace_back(ExrChannel::fromImage("albedo.B", albedo, 2));
+
+            const Image<float> normal = readback(device, pass.getNormalImage());
+            channels.emplace_back(ExrChannel::fromImage("N.X", normal, 0));
+            channels.emplace_back(ExrChannel::fromImage("N.Y", normal, 1));
+            channels.emplace_back(ExrChannel::fromImage("N.Z", normal, 2));
+            channels.emplace_back(ExrChannel::fromImage("Z", normal, 3));
+
+            Image<uint32_t> instances = readbackUint(device, pass.getInstanceImage());
+            channels.emplace_back(ExrChannel{"id", std::move(instances.data)});
+        }
+
+        return writeExr(path, beauty.width, beauty.height, std::move(channels));
     }
 } // namespace lop
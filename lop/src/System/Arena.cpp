@@ -0,0 +1,76 @@
+#include "lop/System/Arena.hpp"
+
+#include <algorithm>
+
+namespace lop
+{
+    Arena::Arena(std::size_t blockSize, std::pmr::memory_resource* upstream)
+        : m_upstream(upstream), m_blockSize(blockSize)
+    {
+    }
+
+    Arena::~Arena() { releaseBlocks(); }
+
+    void Arena::reset()
+    {
+        m_block                           = 0;
+        m_offset                          = 0;
+        m_statistics.allocationNb         = 0;
+        m_statistics.upstreamAllocationNb = 0;
+        m_statistics.used                 = 0;
+
+        if (m_blocks.size() <= 1)
+            return;
+
+        // The merged block is accounted to the next cycle
+        const std::size_t capacity = m_statistics.capacity;
+        releaseBlocks();
+
+        std::byte* data = static_cast<std::byte*>(m_upstream->allocate(capacity, BlockAlignment));
+        m_blocks.emplace_back(Block{data, capacity});
+        m_statistics.upstreamAllocationNb = 1;
+        m_statistics.capacity             = capacity;
+    }
+
+    void* Arena::do_allocate(std::size_t bytes, std::size_t alignment)
+    {
+        // Following blocks are only reached before the next reset merged them
+        for (; m_block < m_blocks.size(); m_block++, m_offset = 0)
+        {
+            const Block&         block   = m_blocks[m_block];
+            const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(block.data) + m_offset;
+            const std::size_t    padding = (alignment - address % alignment) % alignment;
+            if (m_offset + padding + bytes > block.size)
+                continue;
+
+            m_offset += padding + bytes;
+            m_statistics.allocationNb++;
+            m_statistics.used += bytes;
+            return block.data + m_offset - bytes;
+        }
+
+        // Blocks grow with the arena so that a cycle only needs a few of them
+        const std::size_t size = std::max({m_blockSize, m_statistics.capacity, bytes + alignment});
+        m_blocks.emplace_back(Block{static_cast<std::byte*>(m_upstream->allocate(size, BlockAlignment)), size});
+        m_block  = m_blocks.size() - 1;
+        m_offset = 0;
+
+        m_statistics.upstreamAllocationNb++;
+        m_statistics.capacity += size;
+
+        return do_allocate(bytes, alignment);
+    }
+
+    void Arena::do_deallocate(void* /* pointer */, std::size_t /* bytes */, std::size_t /* alignment */) {}
+
+    bool Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept { return this == &other; }
+
+    void Arena::releaseBlocks()
+    {
+        for (const Block& block : m_blocks)
+            m_upstream->deallocate(block.data, block.size, BlockAlignment);
+
+        m_blocks.clear();
+        m_statistics.capacity = 0;
+    }
+} // namespace lop
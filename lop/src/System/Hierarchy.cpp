@@ -0,0 +1,436 @@
+#include "lop/System/Hierarchy.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+
+#include "lop/System/Parallel.hpp"
+
+namespace lop
+{
+    TransformHierarchy::TransformHierarchy(entt::registry& registry) : m_registry(&registry)
+    {
+        // Entities created before the hierarchy
+        for (entt::entity entity : registry.view<Transform>())
+            onConstruct(registry, entity);
+
+        registry.on_construct<Transform>().connect<&TransformHierarchy::onConstruct>(*this);
+        registry.on_destroy<Transform>().connect<&TransformHierarchy::onDestroy>(*this);
+        registry.on_update<Transform>().connect<&TransformHierarchy::onUpdate>(*this);
+
+        registry.on_construct<Hierarchy>().connect<&TransformHierarchy::onStructureUpdate>(*this);
+        registry.on_destroy<Hierarchy>().connect<&TransformHierarchy::onStructureUpdate>(*this);
+        registry.on_update<Hierarchy>().connect<&TransformHierarchy::onStructureUpdate>(*this);
+
+        for (entt::entity entity : registry.view<Motion>())
+            onMotionConstruct(registry, entity);
+
+        registry.on_construct<Motion>().connect<&TransformHierarchy::onMotionConstruct>(*this);
+        registry.on_destroy<Motion>().connect<&TransformHierarchy::onMotionDestroy>(*this);
+        registry.on_update<Motion>().connect<&TransformHierarchy::onMotionUpdate>(*this);
+    }
+
+    TransformHierarchy::~TransformHierarchy()
+    {
+        m_registry->on_construct<Transform>().disconnect(*this);
+        m_registry->on_destroy<Transform>().disconnect(*this);
+        m_registry->on_update<Transform>().disconnect(*this);
+
+        m_registry->on_construct<Hierarchy>().disconnect(*this);
+        m_registry->on_destroy<Hierarchy>().disconnect(*this);
+        m_registry->on_update<Hierarchy>().disconnect(*this);
+
+        m_registry->on_construct<Motion>().disconnect(*this);
+        m_registry->on_destroy<Motion>().disconnect(*this);
+        m_registry->on_update<Motion>().disconnect(*this);
+    }
+
+    void TransformHierarchy::update(uint32_t threadCount)
+    {
+        m_updated.clear();
+
+        // Every node is evaluated after a change of structure
+        if (m_outdated)
+        {
+            sort();
+            m_outdated = false;
+
+            m_updated.resize(getNodeNb());
+            std::iota(m_updated.begin(), m_updated.end(), 0u);
+            for (uint32_t level = 0; level < getLevelNb(); level++)
+            {
+                const uint32_t begin = m_levelOffsets[level];
+                evaluateLevel(m_updated.data() + begin, m_levelOffsets[level + 1] - begin, threadCount);
+            }
+
+            return;
+        }
+
+        if (m_pending.empty())
+            return;
+
+        // Gathers the subtrees of the patched nodes by level. A subtree reached from an ancestor is not visited again.
+        m_levels.resize(getLevelNb());
+        for (std::vector<uint32_t>& level : m_levels)
+            level.clear();
+
+        // The list of updated nodes is empty until the traversal ends, it serves as its stack
+        std::vector<uint32_t>& stack = m_updated;
+        for (const uint32_t root : m_pending)
+        {
+            stack.emplace_back(root);
+            while (!stack.empty())
+            {
+                const uint32_t node = stack.back();
+                stack.pop_back();
+                if (m_flags[node] & Visited)
+                    continue;
+
+                m_flags[node] |= Visited;
+                m_levels[m_depths[node]].emplace_back(node);
+                for (uint32_t child = m_childOffsets[node]; child < m_childOffsets[node + 1]; child++)
+                    stack.emplace_back(m_children[child]);
+            }
+        }
+        m_pending.clear();
+
+        for (const std::vector<uint32_t>& level : m_levels)
+        {
+            evaluateLevel(level.data(), level.size(), threadCount);
+            for (const uint32_t node : level)
+            {
+                m_flags[node] = 0;
+                m_updated.emplace_back(node);
+            }
+        }
+    }
+
+    void TransformHierarchy::onConstruct(entt::registry& registry, entt::entity entity)
+    {
+        const uint32_t    node = getNodeNb();
+        const std::size_t id   = static_cast<std::size_t>(entt::to_entity(entity));
+        if (id >= m_nodes.size())
+            m_nodes.resize(id + 1, NoNode);
+        m_nodes[id] = node;
+
+        m_entities.emplace_back(entity);
+        m_parents.emplace_back(NoNode);
+        m_depths.emplace_back(0);
+        m_flags.emplace_back(0);
+        for (std::vector<float>& position : m_positions)
+            position.emplace_back();
+        for (std::vector<float>& rotation : m_rotations)
+            rotation.emplace_back();
+        m_worlds.emplace_back();
+        for (std::vector<float>& position : m_closePositions)
+            position.emplace_back();
+        for (std::vector<float>& rotation : m_closeRotations)
+            rotation.emplace_back();
+        m_closeWorlds.emplace_back();
+
+        const Transform& transform = registry.get<Transform>(entity);
+        const Motion*    motion    = registry.try_get<Motion>(entity);
+        setLocal(node, transform, m_positions, m_rotations);
+        setLocal(node, motion ? motion->close : transform, m_closePositions, m_closeRotations);
+        m_outdated = true;
+    }
+
+    void TransformHierarchy::onDestroy(entt::registry& /* registry */, entt::entity entity)
+    {
+        const uint32_t node = getNode(entity);
+        if (node == NoNode)
+            return;
+
+        // The last node takes the place of the removed one, nodes are sorted again by the next update
+        const uint32_t last = getNodeNb() - 1;
+        if (node != last)
+        {
+            m_entities[node] = m_entities[last];
+            m_parents[node]  = m_parents[last];
+            m_depths[node]   = m_depths[last];
+            m_flags[node]    = m_flags[last];
+            for (std::vector<float>& position : m_positions)
+                position[node] = position[last];
+            for (std::vector<float>& rotation : m_rotations)
+                rotation[node] = rotation[last];
+            m_worlds[node] = m_worlds[last];
+            for (std::vector<float>& position : m_closePositions)
+                position[node] = position[last];
+            for (std::vector<float>& rotation : m_closeRotations)
+                rotation[node] = rotation[last];
+            m_closeWorlds[node] = m_closeWorlds[last];
+
+            m_nodes[static_cast<std::size_t>(entt::to_entity(m_entities[node]))] = node;
+        }
+
+        m_entities.pop_back();
+        m_parents.pop_back();
+        m_depths.pop_back();
+        m_flags.pop_back();
+        for (std::vector<float>& position : m_positions)
+            position.pop_back();
+        for (std::vector<float>& rotation : m_rotations)
+            rotation.pop_back();
+        m_worlds.pop_back();
+        for (std::vector<float>& position : m_closePositions)
+            position.pop_back();
+        for (std::vector<float>& rotation : m_closeRotations)
+            rotation.pop_back();
+        m_closeWorlds.pop_back();
+
+        m_nodes[static_cast<std::size_t>(entt::to_entity(entity))] = NoNode;
+        m_outdated = true;
+    }
+
+    void TransformHierarchy::onUpdate(entt::registry& registry, entt::entity entity)
+    {
+        const uint32_t node = getNode(entity);
+        if (node == NoNode)
+            return;
+
+        // Entities without Motion are static over the shutter interval
+        const Transform& transform = registry.get<Transform>(entity);
+        setLocal(node, transform, m_positions, m_rotations);
+        if (!registry.all_of<Motion>(entity))
+            setLocal(node, transform, m_closePositions, m_closeRotations);
+        markPending(node);
+    }
+
+    void TransformHierarchy::onStructureUpdate(entt::registry& /* registry */, entt::entity /* entity */)
+    {
+        m_outdated = true;
+    }
+
+    void TransformHierarchy::onMotionConstruct(entt::registry& registry, entt::entity entity)
+    {
+        // Transforms at shutter close were not evaluated while no entity moved
+        if (m_motionNb++ == 0)
+            m_outdated = true;
+
+        onMotionUpdate(registry, entity);
+    }
+
+    void TransformHierarchy::onMotionDestroy(entt::registry& registry, entt::entity entity)
+    {
+        m_motionNb--;
+
+        const uint32_t node = getNode(entity);
+        if (node == NoNode)
+            return;
+
+        setLocal(node, registry.get<Transform>(entity), m_closePositions, m_closeRotations);
+        markPending(node);
+    }
+
+    void TransformHierarchy::onMotionUpdate(entt::registry& registry, entt::entity entity)
+    {
+        const uint32_t node = getNode(entity);
+        if (node == NoNode)
+            return;
+
+        setLocal(node, registry.get<Motion>(entity).close, m_closePositions, m_closeRotations);
+        markPending(node);
+    }
+
+    void TransformHierarchy::markPending(uint32_t node)
+    {
+        if (!(m_flags[node] & Pending))
+        {
+            m_flags[node] |= Pending;
+            m_pending.emplace_back(node);
+        }
+    }
+
+    void TransformHierarchy::setLocal(uint32_t node, const Transform& transform, Positions& positions,
+                                      Rotations& rotations)
+    {
+        for (uint32_t i = 0; i < 3; i++)
+            positions[i][node] = transform.position[i];
+
+        rotations[0][node] = transform.rotation.x;
+        rotations[1][node] = transform.rotation.y;
+        rotations[2][node] = transform.rotation.z;
+        rotations[3][node] = transform.rotation.w;
+    }
+
+    void TransformHierarchy::sort()
+    {
+        const uint32_t nodeNb = getNodeNb();
+
+        for (uint32_t node = 0; node < nodeNb; node++)
+        {
+            m_parents[node] = NoNode;
+            if (const Hierarchy* hierarchy = m_registry->try_get<Hierarchy>(m_entities[node]))
+            {
+                const uint32_t parent = hierarchy->parent != entt::null ? getNode(hierarchy->parent) : NoNode;
+                m_parents[node]       = parent != node ? parent : NoNode;
+            }
+        }
+
+        // Depths are found by walking up to the first known ancestor. A walk coming back to one of its own nodes
+        // found a cycle, which is broken by making that node a root before walking again.
+        constexpr uint32_t Walking = NoNode - 1;
+        m_depths.assign(nodeNb, NoNode);
+
+        std::vector<uint32_t> chain{};
+        for (uint32_t start = 0; start < nodeNb; start++)
+        {
+            uint32_t ancestor = start;
+            while (ancestor != NoNode && m_depths[ancestor] == NoNode)
+            {
+                m_depths[ancestor] = Walking;
+                chain.emplace_back(ancestor);
+                ancestor = m_parents[ancestor];
+
+                if (ancestor != NoNode && m_depths[ancestor] == Walking)
+                {
+                    m_parents[ancestor] = NoNode;
+                    for (const uint32_t node : chain)
+                        m_depths[node] = NoNode;
+
+                    chain.clear();
+                    ancestor = start;
+                }
+            }
+
+            // The chain goes from start to the child of the ancestor
+            uint32_t depth = ancestor == NoNode ? 0 : m_depths[ancestor] + 1;
+            for (auto node = chain.rbegin(); node != chain.rend(); node++)
+                m_depths[*node] = depth++;
+            chain.clear();
+        }
+
+        // Counting sort of the nodes by depth
+        const uint32_t levelNb = nodeNb == 0 ? 0 : *std::max_element(m_depths.begin(), m_depths.end()) + 1;
+        m_levelOffsets.assign(levelNb + 1, 0);
+        for (const uint32_t depth : m_depths)
+            m_levelOffsets[depth + 1]++;
+        std::partial_sum(m_levelOffsets.begin(), m_levelOffsets.end(), m_levelOffsets.begin());
+
+        std::vector<uint32_t> sorted(nodeNb);
+        {
+            std::vector<uint32_t> offsets(m_levelOffsets.begin(), m_levelOffsets.end() - 1);
+            for (uint32_t node = 0; node < nodeNb; node++)
+                sorted[node] = offsets[m_depths[node]]++;
+        }
+
+        const auto permute = [&](auto& values) {
+            std::remove_reference_t<decltype(values)> permuted(values.size());
+            for (uint32_t node = 0; node < nodeNb; node++)
+                permuted[sorted[node]] = values[node];
+            values = std::move(permuted);
+        };
+
+        permute(m_entities);
+        permute(m_depths);
+        for (std::vector<float>& position : m_positions)
+            permute(position);
+        for (std::vector<float>& rotation : m_rotations)
+            permute(rotation);
+        for (std::vector<float>& position : m_closePositions)
+            permute(position);
+        for (std::vector<float>& rotation : m_closeRotations)
+            permute(rotation);
+
+        for (uint32_t& parent : m_parents)
+            parent = parent != NoNode ? sorted[parent] : NoNode;
+        permute(m_parents);
+
+        m_flags.assign(nodeNb, 0);
+        m_pending.clear();
+        for (uint32_t node = 0; node < nodeNb; node++)
+            m_nodes[static_cast<std::size_t>(entt::to_entity(m_entities[node]))] = node;
+
+        // Children are stored by parent, in the order of the nodes
+        m_childOffsets.assign(nodeNb + 1, 0);
+        for (const uint32_t parent : m_parents)
+        {
+            if (parent != NoNode)
+                m_childOffsets[parent + 1]++;
+        }
+        std::partial_sum(m_childOffsets.begin(), m_childOffsets.end(), m_childOffsets.begin());
+
+        m_children.resize(m_childOffsets.back());
+        {
+            std::vector<uint32_t> offsets(m_childOffsets.begin(), m_childOffsets.end() - 1);
+            for (uint32_t node = 0; node < nodeNb; node++)
+            {
+                if (m_parents[node] != NoNode)
+                    m_children[offsets[m_parents[node]]++] = node;
+            }
+        }
+    }
+
+    void TransformHierarchy::evaluateLevel(const uint32_t* nodes, std::size_t nodeNb, uint32_t threadCount)
+    {
+        if (nodeNb < ParallelNodeNb)
+        {
+            evaluate(nodes, nodeNb);
+            return;
+        }
+
+        threadCount                    = getThreadCount(threadCount);
+        const std::size_t nodesPerTask = (nodeNb + threadCount - 1) / threadCount;
+        parallelRows(threadCount, threadCount, [&](uint32_t task) {
+            const std::size_t begin = std::min(nodeNb, task * nodesPerTask);
+            const std::size_t end   = std::min(nodeNb, begin + nodesPerTask);
+            evaluate(nodes + begin, end - begin);
+        });
+    }
+
+    void TransformHierarchy::evaluate(const uint32_t* nodes, std::size_t nodeNb)
+    {
+        evaluate(nodes, nodeNb, m_positions, m_rotations, m_worlds);
+        if (m_motionNb != 0)
+            evaluate(nodes, nodeNb, m_closePositions, m_closeRotations, m_closeWorlds);
+    }
+
+    void TransformHierarchy::evaluate(const uint32_t* nodes, std::size_t nodeNb, const Positions& positions,
+                                      const Rotations& rotations, std::vector<InstanceTransform>& worlds) const
+    {
+        // Rotations are gathered and converted by blocks, in loops without dependencies which vectorize
+        constexpr std::size_t BlockSize = 64;
+
+        float q[4][BlockSize];
+        float r[9][BlockSize];
+        for (std::size_t start = 0; start < nodeNb; start += BlockSize)
+        {
+            const std::size_t size = std::min(BlockSize, nodeNb - start);
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                for (std::size_t i = 0; i < size; i++)
+                    q[c][i] = rotations[c][nodes[start + i]];
+            }
+
+            // Rows of glm::mat3_cast
+            for (std::size_t i = 0; i < size; i++)
+            {
+                const float x = q[0][i], y = q[1][i], z = q[2][i], w = q[3][i];
+
+                r[0][i] = 1.f - 2.f * (y * y + z * z);
+                r[1][i] = 2.f * (x * y - w * z);
+                r[2][i] = 2.f * (x * z + w * y);
+                r[3][i] = 2.f * (x * y + w * z);
+                r[4][i] = 1.f - 2.f * (x * x + z * z);
+                r[5][i] = 2.f * (y * z - w * x);
+                r[6][i] = 2.f * (x * z - w * y);
+                r[7][i] = 2.f * (y * z + w * x);
+                r[8][i] = 1.f - 2.f * (x * x + y * y);
+            }
+
+            for (std::size_t i = 0; i < size; i++)
+            {
+                const uint32_t          node  = nodes[start + i];
+                const InstanceTransform local = {{
+                    {r[0][i], r[1][i], r[2][i], positions[0][node]},
+                    {r[3][i], r[4][i], r[5][i], positions[1][node]},
+                    {r[6][i], r[7][i], r[8][i], positions[2][node]},
+                }};
+
+                const uint32_t parent = m_parents[node];
+                worlds[node]          = parent == NoNode ? local : InstanceTransform::compose(worlds[parent], local);
+            }
+        }
+    }
+} // namespace lop
@@ -0,0 +1,130 @@
+#include "lop/System/Memory.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace lop
+{
+    namespace
+    {
+        std::atomic<uint64_t> s_heapAllocationNb{0};
+
+        void* allocate(std::size_t size)
+        {
+            s_heapAllocationNb.fetch_add(1, std::memory_order_relaxed);
+
+            if (size == 0)
+                size = 1;
+
+            while (true)
+            {
+                if (void* pointer = std::malloc(size))
+                    return pointer;
+
+                const std::new_handler handler = std::get_new_handler();
+                if (!handler)
+                    throw std::bad_alloc{};
+
+                handler();
+            }
+        }
+
+        void* allocate(std::size_t size, std::align_val_t alignment)
+        {
+            s_heapAllocationNb.fetch_add(1, std::memory_order_relaxed);
+
+            // Aligned allocations require a size multiple of the alignment
+            const std::size_t alignmentSize = static_cast<std::size_t>(alignment);
+            size                            = (size + alignmentSize - 1) / alignmentSize * alignmentSize;
+            if (size == 0)
+                size = alignmentSize;
+
+            while (true)
+            {
+#ifdef _WIN32
+                if (void* pointer = _aligned_malloc(size, alignmentSize))
+                    return pointer;
+#else
+                if (void* pointer = std::aligned_alloc(alignmentSize, size))
+                    return pointer;
+#endif // _WIN32
+
+                const std::new_handler handler = std::get_new_handler();
+                if (!handler)
+                    throw std::bad_alloc{};
+
+                handler();
+            }
+        }
+
+        void deallocate(void* pointer, std::align_val_t)
+        {
+#ifdef _WIN32
+            _aligned_free(pointer);
+#else
+            std::free(pointer);
+#endif // _WIN32
+        }
+    } // namespace
+
+    uint64_t getHeapAllocationNb() { return s_heapAllocationNb.load(std::memory_order_relaxed); }
+} // namespace lop
+
+void* operator new(std::size_t size) { return lop::allocate(size); }
+void* operator new[](std::size_t size) { return lop::allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return lop::allocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return lop::allocate(size, alignment); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return lop::allocate(size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return lop::allocate(size, alignment);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, alignment, tag);
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t alignment) noexcept { lop::deallocate(pointer, alignment); }
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept { lop::deallocate(pointer, alignment); }
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+    lop::deallocate(pointer, alignment);
+}
+void operator delete[](void* pointer, std::size_t, std::align_val_t alignment) noexcept
+{
+    lop::deallocate(pointer, alignment);
+}
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    lop::deallocate(pointer, alignment);
+}
+void operator delete[](void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    lop::deallocate(pointer, alignment);
+}
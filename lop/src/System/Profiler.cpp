@@ -0,0 +1,164 @@
+#include "lop/System/Profiler.hpp"
+
+#include <cmath>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <vzt/Core/Logger.hpp>
+
+namespace lop
+{
+    namespace
+    {
+        // Scope names come from callers and may hold quotes, backslashes or control characters
+        std::string escapeJson(std::string_view value)
+        {
+            std::string escaped{};
+            escaped.reserve(value.size());
+            for (const char c : value)
+            {
+                switch (c)
+                {
+                case '"': escaped += "\\\""; break;
+                case '\\': escaped += "\\\\"; break;
+                case '\n': escaped += "\\n"; break;
+                case '\r': escaped += "\\r"; break;
+                case '\t': escaped += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                        escaped += fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+                    else
+                        escaped += c;
+                }
+            }
+
+            return escaped;
+        }
+
+        // JSON has no literal for NaN nor infinities, such as the timings of a failed query
+        std::string formatJson(float value) { return std::isfinite(value) ? fmt::format("{}", value) : "null"; }
+
+        // Quotes are doubled within quoted CSV fields
+        std::string escapeCsv(std::string_view value)
+        {
+            std::string escaped{};
+            escaped.reserve(value.size());
+            for (const char c : value)
+            {
+                escaped += c;
+                if (c == '"')
+                    escaped += c;
+            }
+
+            return escaped;
+        }
+    } // namespace
+
+    TimingStatistics TimingSeries::getStatistics() const
+    {
+        TimingStatistics statistics{};
+        statistics.count = total;
+        if (samples.size() == 0)
+            return statistics;
+
+        statistics.last = samples.back();
+        statistics.min  = samples[0];
+        statistics.max  = samples[0];
+
+        float sum = 0.f;
+        for (std::size_t i = 0; i < samples.size(); i++)
+        {
+            const float sample = samples[i];
+            statistics.min     = std::min(statistics.min, sample);
+            statistics.max     = std::max(statistics.max, sample);
+            sum += sample;
+        }
+        statistics.average = sum / static_cast<float>(samples.size());
+
+        return statistics;
+    }
+
+    Profiler& Profiler::get()
+    {
+        static Profiler profiler{};
+        return profiler;
+    }
+
+    void Profiler::record(std::string_view name, float milliseconds)
+    {
+        std::lock_guard lock{m_mutex};
+
+        auto it = m_series.find(name);
+        if (it == m_series.end())
+            it = m_series.emplace(std::string(name), TimingSeries{}).first;
+
+        it->second.samples.push(milliseconds);
+        it->second.total++;
+    }
+
+    TimingStatistics Profiler::getStatistics(std::string_view name) const
+    {
+        std::lock_guard lock{m_mutex};
+
+        const auto it = m_series.find(name);
+        if (it == m_series.end())
+            return {};
+
+        return it->second.getStatistics();
+    }
+
+    void Profiler::clear()
+    {
+        std::lock_guard lock{m_mutex};
+        m_series.clear();
+    }
+
+    bool Profiler::dump(const vzt::Path& path) const
+    {
+        std::ofstream file{path};
+        if (!file)
+        {
+            vzt::logger::error("Failed to open profiling dump at {}", path.string());
+            return false;
+        }
+
+        const bool csv = path.extension() == ".csv";
+        if (csv)
+            file << "name,count,last,average,min,max\n";
+        else
+            file << "{\n    \"series\": [";
+
+        bool first = true;
+        forEach([&](std::string_view name, const TimingSeries& series) {
+            const TimingStatistics statistics = series.getStatistics();
+            if (csv)
+            {
+                file << fmt::format("\"{}\",{},{},{},{},{}\n", escapeCsv(name), statistics.count, statistics.last,
+                                    statistics.average, statistics.min, statistics.max);
+                return;
+            }
+
+            file << fmt::format("{}\n        {{\"name\": \"{}\", \"count\": {}, \"last\": {}, \"average\": {}, "
+                                "\"min\": {}, \"max\": {}, \"samples\": [",
+                                first ? "" : ",", escapeJson(name), statistics.count, formatJson(statistics.last),
+                                formatJson(statistics.average), formatJson(statistics.min), formatJson(statistics.max));
+            for (std::size_t i = 0; i < series.samples.size(); i++)
+                file << fmt::format("{}{}", i == 0 ? "" : ", ", formatJson(series.samples[i]));
+            file << "]}";
+
+            first = false;
+        });
+
+        if (!csv)
+            file << "\n    ]\n}\n";
+
+        return true;
+    }
+
+    ScopedTimer::ScopedTimer(std::string_view name) : m_name(name), m_start(Clock::now()) {}
+    ScopedTimer::~ScopedTimer()
+    {
+        const std::chrono::duration<float, std::milli> duration = Clock::now() - m_start;
+        Profiler::get().record(m_name, duration.count());
+    }
+} // namespace lop
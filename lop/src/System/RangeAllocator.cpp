@@ -0,0 +1,266 @@
+#include "lop/System/RangeAllocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace lop
+{
+    namespace
+    {
+        uint32_t getLowestBit(uint64_t value)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward64(&index, value);
+            return static_cast<uint32_t>(index);
+#else
+            return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+        }
+
+        uint32_t getHighestBit(uint64_t value)
+        {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanReverse64(&index, value);
+            return static_cast<uint32_t>(index);
+#else
+            return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+        }
+    } // namespace
+
+    RangeStatistics& RangeStatistics::operator+=(const RangeStatistics& other)
+    {
+        allocationNb += other.allocationNb;
+        capacity += other.capacity;
+        used += other.used;
+        largestFree = std::max(largestFree, other.largestFree);
+        return *this;
+    }
+
+    RangeAllocator::RangeAllocator(uint64_t capacity, uint64_t granularity)
+        : m_capacity(capacity / granularity * granularity), m_granularity(granularity)
+    {
+        assert(granularity != 0 && (granularity & (granularity - 1)) == 0 && "Granularity must be a power of two");
+
+        m_bins.fill(None);
+        if (m_capacity != 0)
+            insertFree(createNode(0, m_capacity / m_granularity));
+    }
+
+    Range RangeAllocator::allocate(uint64_t size)
+    {
+        const uint64_t units = std::max(uint64_t(1), (size + m_granularity - 1) / m_granularity);
+
+        const uint32_t node = findFree(units);
+        if (node == None)
+            return {};
+
+        removeFree(node);
+
+        // The remainder stays available as a separate free range
+        if (m_nodes[node].size > units)
+        {
+            const uint32_t remainder = createNode(m_nodes[node].offset + units, m_nodes[node].size - units);
+            m_nodes[remainder].previous = node;
+            m_nodes[remainder].next     = m_nodes[node].next;
+            if (m_nodes[node].next != None)
+                m_nodes[m_nodes[node].next].previous = remainder;
+
+            m_nodes[node].next = remainder;
+            m_nodes[node].size = units;
+            insertFree(remainder);
+        }
+
+        m_used += units;
+        m_allocations++;
+        return {m_nodes[node].offset * m_granularity, units * m_granularity, node};
+    }
+
+    void RangeAllocator::release(Range range)
+    {
+        if (!range.isValid())
+            return;
+
+        uint32_t node = range.node;
+        assert(node < m_nodes.size() && !m_nodes[node].free && "Range is not allocated");
+
+        m_used -= m_nodes[node].size;
+        m_allocations--;
+
+        // Merge with the free physical neighbours
+        if (const uint32_t next = m_nodes[node].next; next != None && m_nodes[next].free)
+        {
+            removeFree(next);
+            m_nodes[node].size += m_nodes[next].size;
+            m_nodes[node].next = m_nodes[next].next;
+            if (m_nodes[next].next != None)
+                m_nodes[m_nodes[next].next].previous = node;
+
+            m_nodes[next] = {};
+            m_unusedNodes.emplace_back(next);
+        }
+
+        if (const uint32_t previous = m_nodes[node].previous; previous != None && m_nodes[previous].free)
+        {
+            removeFree(previous);
+            m_nodes[previous].size += m_nodes[node].size;
+            m_nodes[previous].next = m_nodes[node].next;
+            if (m_nodes[node].next != None)
+                m_nodes[m_nodes[node].next].previous = previous;
+
+            m_nodes[node] = {};
+            m_unusedNodes.emplace_back(node);
+            node = previous;
+        }
+
+        insertFree(node);
+    }
+
+    RangeStatistics RangeAllocator::getStatistics() const
+    {
+        RangeStatistics statistics{};
+        statistics.allocationNb = m_allocations;
+        statistics.capacity     = m_capacity;
+        statistics.used         = m_used * m_granularity;
+
+        // Only the highest non-empty bin may hold the largest free range
+        if (m_firstLevelBitmap != 0)
+        {
+            const uint32_t firstLevel  = getHighestBit(m_firstLevelBitmap);
+            const uint32_t secondLevel = getHighestBit(m_secondLevelBitmaps[firstLevel]);
+
+            uint64_t largest = 0;
+            uint32_t node    = m_bins[firstLevel * SecondLevelNb + secondLevel];
+            while (node != None)
+            {
+                largest = std::max(largest, m_nodes[node].size);
+                node    = m_nodes[node].nextFree;
+            }
+
+            statistics.largestFree = largest * m_granularity;
+        }
+
+        return statistics;
+    }
+
+    void RangeAllocator::getBin(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+    {
+        // Small sizes are binned linearly, larger ones in SecondLevelNb subdivisions of each power of two
+        if (size < SecondLevelNb)
+        {
+            firstLevel  = 0;
+            secondLevel = static_cast<uint32_t>(size);
+            return;
+        }
+
+        const uint32_t highest = getHighestBit(size);
+        firstLevel             = highest - SecondLevelBits + 1;
+        secondLevel            = static_cast<uint32_t>(size >> (highest - SecondLevelBits)) - SecondLevelNb;
+    }
+
+    uint32_t RangeAllocator::createNode(uint64_t offset, uint64_t size)
+    {
+        uint32_t node;
+        if (!m_unusedNodes.empty())
+        {
+            node = m_unusedNodes.back();
+            m_unusedNodes.pop_back();
+        }
+        else
+        {
+            node = static_cast<uint32_t>(m_nodes.size());
+            m_nodes.emplace_back();
+        }
+
+        m_nodes[node]        = {};
+        m_nodes[node].offset = offset;
+        m_nodes[node].size   = size;
+        return node;
+    }
+
+    void RangeAllocator::insertFree(uint32_t node)
+    {
+        uint32_t firstLevel, secondLevel;
+        getBin(m_nodes[node].size, firstLevel, secondLevel);
+
+        uint32_t& head             = m_bins[firstLevel * SecondLevelNb + secondLevel];
+        m_nodes[node].free         = true;
+        m_nodes[node].previousFree = None;
+        m_nodes[node].nextFree     = head;
+        if (head != None)
+            m_nodes[head].previousFree = node;
+        head = node;
+
+        m_firstLevelBitmap |= uint64_t(1) << firstLevel;
+        m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+    }
+
+    void RangeAllocator::removeFree(uint32_t node)
+    {
+        uint32_t firstLevel, secondLevel;
+        getBin(m_nodes[node].size, firstLevel, secondLevel);
+
+        const uint32_t previous = m_nodes[node].previousFree;
+        const uint32_t next     = m_nodes[node].nextFree;
+        if (previous != None)
+            m_nodes[previous].nextFree = next;
+        else
+            m_bins[firstLevel * SecondLevelNb + secondLevel] = next;
+
+        if (next != None)
+            m_nodes[next].previousFree = previous;
+
+        m_nodes[node].free         = false;
+        m_nodes[node].previousFree = None;
+        m_nodes[node].nextFree     = None;
+
+        if (m_bins[firstLevel * SecondLevelNb + secondLevel] == None)
+        {
+            m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+            if (m_secondLevelBitmaps[firstLevel] == 0)
+                m_firstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+        }
+    }
+
+    uint32_t RangeAllocator::findFree(uint64_t size) const
+    {
+        // Round up to the next bin so that any range of the found bin is large enough
+        uint64_t rounded = size;
+        if (size >= SecondLevelNb)
+            rounded += (uint64_t(1) << (getHighestBit(size) - SecondLevelBits)) - 1;
+
+        uint32_t firstLevel, secondLevel;
+        getBin(rounded, firstLevel, secondLevel);
+        if (firstLevel < FirstLevelNb)
+        {
+            uint32_t secondLevelBitmap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+            if (secondLevelBitmap == 0)
+            {
+                const uint64_t firstLevelBitmap =
+                    firstLevel + 1 < 64 ? m_firstLevelBitmap & (~uint64_t(0) << (firstLevel + 1)) : 0;
+                if (firstLevelBitmap != 0)
+                {
+                    firstLevel        = getLowestBit(firstLevelBitmap);
+                    secondLevelBitmap = m_secondLevelBitmaps[firstLevel];
+                }
+            }
+
+            if (secondLevelBitmap != 0)
+                return m_bins[firstLevel * SecondLevelNb + getLowestBit(secondLevelBitmap)];
+        }
+
+        // Larger bins are empty, a range of the bin of the exact size may still fit
+        getBin(size, firstLevel, secondLevel);
+
+        uint32_t node = m_bins[firstLevel * SecondLevelNb + secondLevel];
+        while (node != None && m_nodes[node].size < size)
+            node = m_nodes[node].nextFree;
+        return node;
+    }
+} // namespace lop
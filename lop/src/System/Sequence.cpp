@@ -0,0 +1,118 @@
+#include "lop/System/Sequence.hpp"
+
+#include <algorithm>
+
+#include <fmt/format.h>
+
+namespace lop
+{
+    namespace
+    {
+        bool isSame(const Transform& a, const Transform& b)
+        {
+            return a.position == b.position && a.rotation == b.rotation;
+        }
+
+        bool isEarlier(float time, const Keyframe& keyframe) { return time < keyframe.time; }
+    } // namespace
+
+    void TransformTrack::add(float time, const Transform& transform)
+    {
+        const auto next = std::upper_bound(keyframes.begin(), keyframes.end(), time, isEarlier);
+        keyframes.insert(next, Keyframe{time, transform});
+    }
+
+    Transform TransformTrack::evaluate(float time) const
+    {
+        if (keyframes.empty())
+            return {};
+        if (time <= keyframes.front().time)
+            return keyframes.front().transform;
+        if (time >= keyframes.back().time)
+            return keyframes.back().transform;
+
+        // Strictly between the first and the last keyframe, the interval is not empty
+        const auto      next = std::upper_bound(keyframes.begin(), keyframes.end(), time, isEarlier);
+        const Keyframe& b    = *next;
+        const Keyframe& a    = *(next - 1);
+        const float     t    = (time - a.time) / (b.time - a.time);
+
+        Transform transform{};
+        transform.position = a.transform.position + (b.transform.position - a.transform.position) * t;
+        transform.rotation = glm::slerp(a.transform.rotation, b.transform.rotation, t);
+        return transform;
+    }
+
+    TransformTrack TransformTrack::turntable(const Transform& start, float duration)
+    {
+        // Keys closer than a half turn, since rotations are interpolated along the shortest arc
+        TransformTrack track{};
+        for (uint32_t quarter = 0; quarter <= 4; quarter++)
+        {
+            Transform transform = start;
+            transform.rotation  = glm::angleAxis(vzt::Pi * .5f * static_cast<float>(quarter), Transform::Up) *
+                                 start.rotation;
+            track.keyframes.emplace_back(Keyframe{duration * static_cast<float>(quarter) / 4.f, transform});
+        }
+
+        return track;
+    }
+
+    uint32_t Sequence::apply(entt::registry& registry, uint32_t frame) const
+    {
+        const float open  = getTime(frame);
+        const float close = open + shutter / frameRate;
+
+        uint32_t patchedNb = 0;
+        for (const entt::entity entity : registry.view<Animation, Transform>())
+        {
+            const TransformTrack& track   = registry.get<Animation>(entity).track;
+            Transform&            current = registry.get<Transform>(entity);
+
+            bool            patched = false;
+            const Transform opened  = track.evaluate(open);
+            if (!isSame(opened, current))
+            {
+                current = opened;
+                registry.patch<Transform>(entity);
+                patched = true;
+            }
+
+            // Entities at rest during the shutter interval are not duplicated by the motion blur
+            const Transform closed = shutter > 0.f ? track.evaluate(close) : opened;
+            const Motion*   motion = registry.try_get<Motion>(entity);
+            if (isSame(closed, opened))
+            {
+                if (motion)
+                {
+                    registry.remove<Motion>(entity);
+                    patched = true;
+                }
+            }
+            else if (!motion || !isSame(closed, motion->close))
+            {
+                registry.emplace_or_replace<Motion>(entity, Motion{closed});
+                patched = true;
+            }
+
+            patchedNb += patched;
+        }
+
+        return patchedNb;
+    }
+
+    vzt::Path getFramePath(const std::string& pattern, uint32_t frame)
+    {
+        const std::size_t last = pattern.find_last_of('#');
+        if (last == std::string::npos)
+        {
+            vzt::Path path = pattern;
+            return path.replace_filename(
+                fmt::format("{}_{:04}{}", path.stem().string(), frame, path.extension().string()));
+        }
+
+        const std::size_t previous = pattern.find_last_not_of('#', last);
+        const std::size_t first    = previous == std::string::npos ? 0 : previous + 1;
+        return pattern.substr(0, first) + fmt::format("{:0{}}", frame, last - first + 1) + pattern.substr(last + 1);
+    }
+} // namespace lop
@@ -0,0 +1,243 @@
+#include "lop/System/Socket.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace lop
+{
+    namespace
+    {
+#ifdef _WIN32
+        using Handle = SOCKET;
+
+        // Winsock must be initialized before its first use in the process
+        bool initialize()
+        {
+            static const bool initialized = [] {
+                WSADATA data;
+                return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+            }();
+            return initialized;
+        }
+
+        void close(intptr_t handle) { closesocket(static_cast<Handle>(handle)); }
+
+        // Sizes are int on Winsock, the transfers being split in chunks that fit
+        int getAddressLength(const addrinfo& address) { return static_cast<int>(address.ai_addrlen); }
+        int getTransferSize(std::size_t size) { return static_cast<int>(size); }
+#else
+        using Handle = int;
+
+        bool initialize() { return true; }
+        void close(intptr_t handle) { ::close(static_cast<Handle>(handle)); }
+
+        socklen_t   getAddressLength(const addrinfo& address) { return address.ai_addrlen; }
+        std::size_t getTransferSize(std::size_t size) { return size; }
+#endif
+
+        // Messages are small and answered immediately, they are not delayed to be coalesced. Keepalive probes detect
+        // the peers whose host went down without closing the connection.
+        void setOptions(intptr_t handle)
+        {
+            const int enabled = 1;
+            setsockopt(static_cast<Handle>(handle), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enabled),
+                       sizeof(enabled));
+            setsockopt(static_cast<Handle>(handle), SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<const char*>(&enabled),
+                       sizeof(enabled));
+        }
+
+        timeval toTimeval(float seconds)
+        {
+            const auto microseconds = static_cast<int64_t>(static_cast<double>(seconds) * 1e6);
+
+            timeval result{};
+            result.tv_sec  = microseconds / 1'000'000;
+            result.tv_usec = microseconds % 1'000'000;
+            return result;
+        }
+
+        // Sent and received by chunks, a single call being limited to int sizes on Windows
+        constexpr std::size_t MaxTransferSize = 1u << 30;
+
+        // A peer closing the connection fails the send instead of raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+        constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+        constexpr int SendFlags = 0;
+#endif
+    } // namespace
+
+    Socket::Socket(intptr_t handle) : m_handle(handle) {}
+
+    Socket Socket::connect(const std::string& host, uint16_t port)
+    {
+        if (!initialize())
+            return {};
+
+        addrinfo hints{};
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+
+        addrinfo*         addresses = nullptr;
+        const std::string service   = std::to_string(port);
+        if (getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses) != 0)
+            return {};
+
+        Socket result{};
+        for (const addrinfo* address = addresses; address != nullptr; address = address->ai_next)
+        {
+            const Handle handle = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (static_cast<intptr_t>(handle) == Invalid)
+                continue;
+
+            if (::connect(handle, address->ai_addr, getAddressLength(*address)) == 0)
+            {
+                result = Socket{static_cast<intptr_t>(handle)};
+                break;
+            }
+
+            close(static_cast<intptr_t>(handle));
+        }
+        freeaddrinfo(addresses);
+
+        if (result.isValid())
+            setOptions(result.m_handle);
+
+        return result;
+    }
+
+    Socket::Socket(Socket&& other) noexcept : m_handle(std::exchange(other.m_handle, Invalid)) {}
+
+    Socket& Socket::operator=(Socket&& other) noexcept
+    {
+        std::swap(m_handle, other.m_handle);
+        return *this;
+    }
+
+    Socket::~Socket()
+    {
+        if (m_handle != Invalid)
+            close(m_handle);
+    }
+
+    bool Socket::setTimeout(float seconds)
+    {
+        if (m_handle == Invalid)
+            return false;
+
+        const Handle handle = static_cast<Handle>(m_handle);
+#ifdef _WIN32
+        const DWORD timeout = static_cast<DWORD>(seconds * 1000.f);
+#else
+        const timeval timeout = toTimeval(seconds);
+#endif
+
+        const char* value = reinterpret_cast<const char*>(&timeout);
+        return setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, value, sizeof(timeout)) == 0 &&
+               setsockopt(handle, SOL_SOCKET, SO_SNDTIMEO, value, sizeof(timeout)) == 0;
+    }
+
+    bool Socket::send(const void* data, std::size_t size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        while (m_handle != Invalid && size != 0)
+        {
+            const std::size_t chunk = std::min(size, MaxTransferSize);
+            const int         sent  = static_cast<int>(
+                ::send(static_cast<Handle>(m_handle), bytes, getTransferSize(chunk), SendFlags));
+            if (sent <= 0)
+                return false;
+
+            bytes += sent;
+            size -= static_cast<std::size_t>(sent);
+        }
+
+        return m_handle != Invalid;
+    }
+
+    bool Socket::receive(void* data, std::size_t size)
+    {
+        char* bytes = static_cast<char*>(data);
+        while (m_handle != Invalid && size != 0)
+        {
+            const std::size_t chunk    = std::min(size, MaxTransferSize);
+            const int         received = static_cast<int>(
+                ::recv(static_cast<Handle>(m_handle), bytes, getTransferSize(chunk), 0));
+            if (received <= 0)
+                return false;
+
+            bytes += received;
+            size -= static_cast<std::size_t>(received);
+        }
+
+        return m_handle != Invalid;
+    }
+
+    Listener::Listener(uint16_t port)
+    {
+        if (!initialize())
+            return;
+
+        Socket socket{static_cast<intptr_t>(::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP))};
+        if (!socket.isValid())
+            return;
+
+        // Restarting the coordinator does not wait for the connections of the previous one to time out
+        const int reuse = 1;
+        const Handle handle = static_cast<Handle>(socket.m_handle);
+        setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+        sockaddr_in address{};
+        address.sin_family      = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port        = htons(port);
+
+        if (::bind(handle, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+            return;
+        if (::listen(handle, SOMAXCONN) != 0)
+            return;
+
+        m_socket = std::move(socket);
+    }
+
+    Listener::~Listener() = default;
+
+    Socket Listener::accept(float timeout)
+    {
+        if (!m_socket.isValid())
+            return {};
+
+        const Handle listening = static_cast<Handle>(m_socket.m_handle);
+        if (timeout > 0.f)
+        {
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(listening, &readable);
+
+            // The first argument is ignored by Winsock
+            timeval remaining = toTimeval(timeout);
+            if (::select(static_cast<int>(listening) + 1, &readable, nullptr, nullptr, &remaining) <= 0)
+                return {};
+        }
+
+        const Handle handle = ::accept(listening, nullptr, nullptr);
+        if (static_cast<intptr_t>(handle) == Socket::Invalid)
+            return {};
+
+        setOptions(static_cast<intptr_t>(handle));
+        return Socket{static_cast<intptr_t>(handle)};
+    }
+} // namespace lop
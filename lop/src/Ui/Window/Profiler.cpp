@@ -0,0 +1,71 @@
+#include "lop/Ui/Window/Profiler.hpp"
+
+#include <fmt/format.h>
+#include <imgui.h>
+#include <portable-file-dialogs.h>
+
+#include "lop/System/Profiler.hpp"
+
+namespace lop
+{
+    void ProfilerWindow::render(Profiler& profiler)
+    {
+        ImGui::SetNextWindowBgAlpha(0.35f);
+        if (!ImGui::Begin("Profiler", nullptr, 0))
+        {
+            ImGui::End();
+            return;
+        }
+
+        constexpr ImGuiTableFlags tableFlags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV;
+        if (ImGui::BeginTable("##Timings", 5, tableFlags))
+        {
+            ImGui::TableSetupColumn("Scope");
+            ImGui::TableSetupColumn("Last (ms)");
+            ImGui::TableSetupColumn("Avg (ms)");
+            ImGui::TableSetupColumn("Max (ms)");
+            ImGui::TableSetupColumn("History", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableHeadersRow();
+
+            profiler.forEach([](std::string_view name, const TimingSeries& series) {
+                const TimingStatistics statistics = series.getStatistics();
+
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(name.data(), name.data() + name.size());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", statistics.last);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", statistics.average);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", statistics.max);
+                ImGui::TableNextColumn();
+
+                const std::string label = fmt::format("##{}", name);
+                ImGui::PlotLines(label.c_str(), series.samples.data(), static_cast<int>(series.samples.size()),
+                                 static_cast<int>(series.samples.offset()), nullptr, 0.f, statistics.max * 1.1f,
+                                 ImVec2(-1.f, 0.f));
+            });
+            ImGui::EndTable();
+        }
+
+        ImGui::SeparatorText("Dump");
+        if (ImGui::Button("Select dump file"))
+        {
+            auto fileDialog = pfd::save_file("Choose profiling dump file", pfd::path::home(),
+                                             {"JSON file (.json)", "*.json", "CSV file (.csv)", "*.csv"},
+                                             pfd::opt::force_overwrite);
+            m_dumpFile      = fileDialog.result();
+        }
+        ImGui::SameLine();
+        ImGui::InputText("##DumpFile", m_dumpFile.data(), m_dumpFile.size() + 1, ImGuiInputTextFlags_ReadOnly);
+
+        if (ImGui::Button("Dump") && !m_dumpFile.empty())
+            profiler.dump(m_dumpFile);
+        ImGui::SameLine();
+        if (ImGui::Button("Clear"))
+            profiler.clear();
+
+        ImGui::End();
+    }
+} // namespace lop
@@ -0,0 +1,535 @@
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+
+#include <fmt/format.h>
+#include <vzt/Core/Logger.hpp>
+#include <vzt/Data/Camera.hpp>
+#include <vzt/Vulkan/Command.hpp>
+#include <vzt/Vulkan/Device.hpp>
+#include <vzt/Vulkan/Instance.hpp>
+
+#include "lop/Math/Procedural.hpp"
+#include "lop/Renderer/Denoiser.hpp"
+#include "lop/Renderer/Geometry.hpp"
+#include "lop/Renderer/GpuProfiler.hpp"
+#include "lop/Renderer/Pass/HardwarePathTracing.hpp"
+#include "lop/Renderer/Snapshot.hpp"
+#include "lop/System/Profiler.hpp"
+#include "lop/System/System.hpp"
+#include "lop/System/Transform.hpp"
+
+// Benchmark suite rendering a fixed set of procedural scenes with fixed seeds, resolution and sample count.
+// Usage: LOPBench [--width w] [--height h] [--spp n] [--scene name] [--reference-dir dir] [--write-references]
+//                 [--baseline results.csv] [--tolerance 0.1] [--max-rmse x] [--output results.csv]
+//                 [--generic-kernel] [--sequence pcg|sobol|rank1] [--equal-error rmse] [--denoise]
+//                 [--radiance-cache off|on|validation]
+
+struct BenchmarkSettings
+{
+    uint32_t    width          = 512;
+    uint32_t    height         = 512;
+    uint32_t    spp            = 256;
+    std::string scene          = "";
+    vzt::Path   referenceDir   = "bench/references";
+    bool        writeReference = false;
+    vzt::Path   baseline       = "";
+    float       tolerance      = 0.1f;
+    float       maxRmse        = std::numeric_limits<float>::max();
+    vzt::Path   output         = "";
+    bool        genericKernel  = false;
+
+    lop::SampleSequence sequence       = lop::SampleSequence::Sobol;
+    float               equalErrorRmse = 0.f; // Disabled when 0
+
+    bool denoise = false; // Filter the accumulation with the CPU denoiser before measuring its error
+
+    // Compared against references rendered without it, validation also reports the bias of its first bounce
+    lop::RadianceCacheMode radianceCache = lop::RadianceCacheMode::Disabled;
+};
+
+struct BenchmarkScene
+{
+    std::string                                               name;
+    vzt::Vec3                                                 cameraPosition;
+    std::function<void(vzt::View<vzt::Device>, lop::System&)> populate;
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    float       timeMs         = 0.f;
+    double      mraysPerSecond = 0.;
+    float       traceMs        = 0.f;
+    float       peakMemoryMiB  = 0.f;
+    float       rmse           = std::numeric_limits<float>::quiet_NaN();
+    uint32_t    equalErrorSpp  = 0; // First power of two reaching the target RMSE, 0 if never reached
+    float       denoiseMs      = 0.f;
+};
+
+constexpr uint32_t Seed = 0x10b;
+
+void addEntity(vzt::View<vzt::Device> device, lop::System& system, std::string name, vzt::Mesh mesh,
+               lop::Transform transform, lop::Material material)
+{
+    entt::handle entity = system.create();
+    entity.emplace<lop::Name>(std::move(name));
+    entity.emplace<lop::Material>(material);
+    entity.emplace<lop::Transform>(transform);
+    auto& newMesh = entity.emplace<vzt::Mesh>(std::move(mesh));
+    entity.emplace<lop::MeshHolder>(device, newMesh);
+}
+
+std::vector<BenchmarkScene> getScenes()
+{
+    std::vector<BenchmarkScene> scenes{};
+
+    scenes.emplace_back(BenchmarkScene{
+        "spheres",
+        {0.f, -9.f, 0.f},
+        [](vzt::View<vzt::Device> device, lop::System& system) {
+            constexpr uint32_t GridSize = 8;
+            for (uint32_t x = 0; x < GridSize; x++)
+            {
+                for (uint32_t z = 0; z < GridSize; z++)
+                {
+                    lop::Transform transform{};
+                    transform.position = {static_cast<float>(x) - 3.5f, 0.f, static_cast<float>(z) - 3.5f};
+
+                    lop::Material material{};
+                    material.roughness = static_cast<float>(x) / static_cast<float>(GridSize - 1);
+                    material.metallic  = static_cast<float>(z) / static_cast<float>(GridSize - 1);
+
+                    addEntity(device, system, fmt::format("Sphere{}{}", x, z), lop::createSphere(.4f), transform,
+                              material);
+                }
+            }
+        },
+    });
+
+    scenes.emplace_back(BenchmarkScene{
+        "triangle-soup",
+        {0.f, -6.f, 0.f},
+        [](vzt::View<vzt::Device> device, lop::System& system) {
+            addEntity(device, system, "Soup", lop::createTriangleSoup(500'000, 2.f, .05f, Seed), {}, {});
+        },
+    });
+
+    scenes.emplace_back(BenchmarkScene{
+        "glass",
+        {0.f, -7.f, 0.f},
+        [](vzt::View<vzt::Device> device, lop::System& system) {
+            lop::Material glass{};
+            glass.baseColor            = {1.f, 1.f, 1.f};
+            glass.roughness            = 0.f;
+            glass.ior                  = 1.5f;
+            glass.specularTransmission = 1.f;
+            glass.transmittance        = {.9f, .95f, .8f};
+
+            constexpr uint32_t GridSize = 5;
+            for (uint32_t x = 0; x < GridSize; x++)
+            {
+                for (uint32_t z = 0; z < GridSize; z++)
+                {
+                    lop::Transform transform{};
+                    transform.position = {static_cast<float>(x) - 2.f, 0.f, static_cast<float>(z) - 2.f};
+                    addEntity(device, system, fmt::format("Glass{}{}", x, z), lop::createSphere(.45f), transform,
+                              glass);
+                }
+            }
+
+            lop::Transform backdrop{};
+            backdrop.position = {0.f, 3.f, 0.f};
+            backdrop.rotation = glm::angleAxis(vzt::Pi * .5f, vzt::Vec3(1.f, 0.f, 0.f));
+            addEntity(device, system, "Backdrop", lop::createQuad(6.f), backdrop, {});
+
+            lop::Transform ground{};
+            ground.position = {0.f, 0.f, -2.5f};
+            addEntity(device, system, "Ground", lop::createQuad(6.f), ground, {});
+        },
+    });
+
+    scenes.emplace_back(BenchmarkScene{
+        "sky",
+        {0.f, 0.f, 0.f},
+        [](vzt::View<vzt::Device>, lop::System&) {},
+    });
+
+    return scenes;
+}
+
+// Resets the peak resident set size of the process to its current size, false when not supported (Linux only)
+bool resetPeakMemory()
+{
+    std::ofstream clearRefs{"/proc/self/clear_refs"};
+    clearRefs << "5";
+    clearRefs.flush();
+    return static_cast<bool>(clearRefs);
+}
+
+float getPeakMemoryMiB()
+{
+    // Peak resident set size of the whole process since the last reset, only available on Linux
+    std::ifstream status{"/proc/self/status"};
+    std::string   line;
+    while (std::getline(status, line))
+    {
+        if (line.rfind("VmHWM:", 0) == 0)
+            return static_cast<float>(std::stod(line.substr(6))) / 1024.f;
+    }
+
+    return 0.f;
+}
+
+// Portable float map, RGB, rows stored bottom to top
+bool writePfm(const vzt::Path& path, const Image<float>& image)
+{
+    std::ofstream file{path, std::ios::binary};
+    if (!file)
+        return false;
+
+    file << fmt::format("PF\n{} {}\n-1.0\n", image.width, image.height);
+    for (uint32_t y = image.height; y > 0; y--)
+    {
+        for (uint32_t x = 0; x < image.width; x++)
+        {
+            const std::size_t pixel = ((y - 1) * image.width + x) * image.channels;
+            file.write(reinterpret_cast<const char*>(image.data.data() + pixel),
+                       static_cast<std::streamsize>(3 * sizeof(float)));
+        }
+    }
+
+    return true;
+}
+
+std::optional<Image<float>> readPfm(const vzt::Path& path)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+        return {};
+
+    std::string type;
+    uint32_t    width, height;
+    float       scale;
+    file >> type >> width >> height >> scale;
+    file.get();
+    if (type != "PF" || scale > 0.f)
+        return {};
+
+    Image<float> image{width, height, 4u, std::vector<float>(width * height * 4u, 1.f)};
+    for (uint32_t y = height; y > 0; y--)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const std::size_t pixel = ((y - 1) * width + x) * 4u;
+            file.read(reinterpret_cast<char*>(image.data.data() + pixel),
+                      static_cast<std::streamsize>(3 * sizeof(float)));
+        }
+    }
+
+    if (!file)
+        return {};
+
+    return image;
+}
+
+float getRmse(const Image<float>& image, const Image<float>& reference)
+{
+    if (image.width != reference.width || image.height != reference.height)
+        return std::numeric_limits<float>::quiet_NaN();
+
+    double sum = 0.;
+    for (std::size_t pixel = 0; pixel < std::size_t(image.width) * image.height; pixel++)
+    {
+        for (std::size_t c = 0; c < 3; c++)
+        {
+            const double difference = double(image.data[pixel * image.channels + c]) -
+                                      double(reference.data[pixel * reference.channels + c]);
+            sum += difference * difference;
+        }
+    }
+
+    return static_cast<float>(std::sqrt(sum / (3. * image.width * image.height)));
+}
+
+std::unordered_map<std::string, float> readBaseline(const vzt::Path& path)
+{
+    std::unordered_map<std::string, float> baseline{};
+
+    std::ifstream file{path};
+    std::string   line;
+    std::getline(file, line); // Header
+    while (std::getline(file, line))
+    {
+        const std::size_t nameEnd = line.find(',');
+        if (nameEnd == std::string::npos)
+            continue;
+
+        // scene,width,height,spp,time_ms,...
+        std::size_t column = nameEnd;
+        for (uint32_t i = 0; i < 4 && column != std::string::npos; i++)
+            column = line.find(',', column + 1);
+        if (column == std::string::npos)
+            continue;
+
+        baseline[line.substr(0, nameEnd)] = std::stof(line.substr(column + 1));
+    }
+
+    return baseline;
+}
+
+BenchmarkResult run(vzt::View<vzt::Device> device, const BenchmarkSettings& settings, const BenchmarkScene& scene)
+{
+    constexpr uint32_t FramesPerSubmission = 8;
+
+    // Without a reset, the process peak also covers the previous scenes
+    if (!resetPeakMemory())
+        vzt::logger::warn("{}: the peak memory can't be reset, it is the peak of the process so far", scene.name);
+
+    lop::System system{};
+    scene.populate(device, system);
+
+    lop::MeshHandler handler{device, system};
+
+    const vzt::Extent2D          extent{settings.width, settings.height};
+    lop::HardwarePathTracingPass pathtracingPass{
+        device, FramesPerSubmission, extent, handler,
+        lop::Environment::fromFunction(device, lop::proceduralSky, 1024, 1024),
+    };
+    pathtracingPass.setKernelVariants(!settings.genericKernel);
+    pathtracingPass.setAovs(settings.denoise);
+    lop::GpuProfiler gpuProfiler{device, FramesPerSubmission};
+
+    // Stands for the swapchain image
+    vzt::DeviceImage target{device, extent, vzt::ImageUsage::TransferDst, vzt::Format::B8G8R8A8UNorm};
+
+    vzt::Camera camera{};
+    camera.up          = lop::Transform::Up;
+    camera.front       = lop::Transform::Front;
+    camera.right       = lop::Transform::Right;
+    camera.aspectRatio = static_cast<float>(extent.width) / static_cast<float>(extent.height);
+
+    const lop::Transform cameraTransform = {scene.cameraPosition};
+    const vzt::Mat4      view            = camera.getViewMatrix(cameraTransform.position, cameraTransform.rotation);
+
+    lop::HardwarePathTracingPass::Properties properties{glm::inverse(view), camera.getProjectionMatrix(), 0};
+    properties.maxSample     = settings.spp;
+    properties.statistics    = 1;
+    properties.sequence      = settings.sequence;
+    properties.radianceCache = settings.radianceCache;
+
+    lop::Profiler::get().clear();
+    pathtracingPass.resetRayStatistics();
+
+    const auto queue = device->getQueue(vzt::QueueType::Compute);
+    const auto start = std::chrono::steady_clock::now();
+    while (properties.sampleId < settings.spp)
+    {
+        queue->oneShot([&](vzt::CommandBuffer& commands) {
+            for (uint32_t i = 0; i < FramesPerSubmission && properties.sampleId < settings.spp; i++)
+            {
+                gpuProfiler.begin(i, commands);
+                pathtracingPass.record(i, commands, target, properties, &gpuProfiler);
+                properties.sampleId++;
+            }
+        });
+    }
+    const std::chrono::duration<float, std::milli> duration = std::chrono::steady_clock::now() - start;
+
+    pathtracingPass.collectRayStatistics();
+    const auto& rays = pathtracingPass.getAccumulatedRayStatistics();
+
+    BenchmarkResult result{};
+    result.name           = scene.name;
+    result.timeMs         = duration.count();
+    result.mraysPerSecond = rays.getMraysPerSecond(result.timeMs);
+    result.traceMs        = lop::Profiler::get().getStatistics("GPU Trace rays").average;
+    result.peakMemoryMiB  = getPeakMemoryMiB();
+
+    if (settings.radianceCache != lop::RadianceCacheMode::Disabled)
+    {
+        vzt::logger::info("{}: radiance cache hit rate {:.1f}%, bias {:+.2f}%", scene.name,
+                          rays.getCacheHitRate() * 100., rays.getCacheBias() * 100.);
+    }
+
+    // Error is measured on what a preview would display, references are never denoised
+    const bool denoise  = settings.denoise && !settings.writeReference;
+    const auto getImage = [&]() {
+        Image<float> accumulation = lop::readback(device, pathtracingPass.getAccumulationImage());
+        if (!denoise)
+            return accumulation;
+
+        const Image<float> albedo = lop::readback(device, pathtracingPass.getAlbedoImage());
+        const Image<float> normal = lop::readback(device, pathtracingPass.getNormalImage());
+        return lop::denoise(accumulation, albedo, normal);
+    };
+
+    const Image<float> image = getImage();
+    if (denoise)
+        result.denoiseMs = lop::Profiler::get().getStatistics("denoise").last;
+
+    const vzt::Path referencePath = settings.referenceDir / fmt::format("{}.pfm", scene.name);
+    if (settings.writeReference)
+    {
+        std::filesystem::create_directories(settings.referenceDir);
+        if (!writePfm(referencePath, image))
+            vzt::logger::error("Failed to write reference {}", referencePath.string());
+    }
+    else if (const auto reference = readPfm(referencePath))
+    {
+        result.rmse = getRmse(image, *reference);
+
+        // Samples needed to reach a given error, the figure of merit when comparing sample sequences. Rendered again
+        // outside of the timed run since every checkpoint needs a readback.
+        if (settings.equalErrorRmse > 0.f)
+        {
+            properties.sampleId   = 0;
+            properties.statistics = 0;
+            for (uint32_t checkpoint = 1; checkpoint <= settings.spp; checkpoint *= 2)
+            {
+                while (properties.sampleId < checkpoint)
+                {
+                    queue->oneShot([&](vzt::CommandBuffer& commands) {
+                        for (uint32_t i = 0; i < FramesPerSubmission && properties.sampleId < checkpoint; i++)
+                        {
+                            pathtracingPass.record(i, commands, target, properties);
+                            properties.sampleId++;
+                        }
+                    });
+                }
+
+                const Image<float> current = getImage();
+                if (getRmse(current, *reference) <= settings.equalErrorRmse)
+                {
+                    result.equalErrorSpp = checkpoint;
+                    break;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    BenchmarkSettings settings{};
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+        const bool             hasValue = i + 1 < argc;
+        if (argument == "--width" && hasValue)
+            settings.width = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--height" && hasValue)
+            settings.height = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--spp" && hasValue)
+            settings.spp = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--scene" && hasValue)
+            settings.scene = argv[++i];
+        else if (argument == "--reference-dir" && hasValue)
+            settings.referenceDir = argv[++i];
+        else if (argument == "--write-references")
+            settings.writeReference = true;
+        else if (argument == "--baseline" && hasValue)
+            settings.baseline = argv[++i];
+        else if (argument == "--tolerance" && hasValue)
+            settings.tolerance = std::stof(argv[++i]);
+        else if (argument == "--max-rmse" && hasValue)
+            settings.maxRmse = std::stof(argv[++i]);
+        else if (argument == "--output" && hasValue)
+            settings.output = argv[++i];
+        else if (argument == "--generic-kernel")
+            settings.genericKernel = true;
+        else if (argument == "--denoise")
+            settings.denoise = true;
+        else if (argument == "--equal-error" && hasValue)
+            settings.equalErrorRmse = std::stof(argv[++i]);
+        else if (argument == "--sequence" && hasValue)
+        {
+            const std::string_view sequence = argv[++i];
+            if (sequence == "pcg")
+                settings.sequence = lop::SampleSequence::Pcg;
+            else if (sequence == "sobol")
+                settings.sequence = lop::SampleSequence::Sobol;
+            else if (sequence == "rank1")
+                settings.sequence = lop::SampleSequence::Rank1;
+            else
+                vzt::logger::warn("Unknown sequence {}", sequence);
+        }
+        else if (argument == "--radiance-cache" && hasValue)
+        {
+            const std::string_view mode = argv[++i];
+            if (mode == "off")
+                settings.radianceCache = lop::RadianceCacheMode::Disabled;
+            else if (mode == "on")
+                settings.radianceCache = lop::RadianceCacheMode::Enabled;
+            else if (mode == "validation")
+                settings.radianceCache = lop::RadianceCacheMode::Validation;
+            else
+                vzt::logger::warn("Unknown radiance cache mode {}", mode);
+        }
+        else
+            vzt::logger::warn("Unknown argument {}", argument);
+    }
+
+    auto instance = vzt::Instance{};
+    auto device   = instance.getDevice(vzt::DeviceBuilder::rt());
+
+    const auto baseline = settings.baseline.empty() ? std::unordered_map<std::string, float>{}
+                                                    : readBaseline(settings.baseline);
+
+    std::vector<BenchmarkResult> results{};
+    bool                         regression = false;
+
+    fmt::print("{:<16}{:>12}{:>12}{:>12}{:>16}{:>12}{:>16}{:>14}\n", "Scene", "Time (ms)", "Trace (ms)", "Mrays/s",
+               "Peak RSS (MiB)", "RMSE", "Equal-error spp", "Denoise (ms)");
+    for (const BenchmarkScene& scene : getScenes())
+    {
+        if (!settings.scene.empty() && scene.name != settings.scene)
+            continue;
+
+        const BenchmarkResult result = run(device, settings, scene);
+        fmt::print("{:<16}{:>12.1f}{:>12.3f}{:>12.1f}{:>16.1f}{:>12.5f}{:>16}{:>14.1f}\n", result.name, result.timeMs,
+                   result.traceMs, result.mraysPerSecond, result.peakMemoryMiB, result.rmse,
+                   result.equalErrorSpp == 0 ? std::string("-") : std::to_string(result.equalErrorSpp),
+                   result.denoiseMs);
+
+        if (result.rmse > settings.maxRmse)
+        {
+            vzt::logger::error("{}: RMSE {} is above the threshold {}", result.name, result.rmse, settings.maxRmse);
+            regression = true;
+        }
+
+        if (const auto it = baseline.find(result.name); it != baseline.end())
+        {
+            if (result.timeMs > it->second * (1.f + settings.tolerance))
+            {
+                vzt::logger::error("{}: {}ms is slower than the baseline {}ms", result.name, result.timeMs,
+                                   it->second);
+                regression = true;
+            }
+        }
+
+        results.emplace_back(result);
+    }
+
+    if (!settings.output.empty())
+    {
+        std::ofstream file{settings.output};
+        file << "scene,width,height,spp,time_ms,trace_ms,mrays_per_s,peak_rss_mib,rmse,equal_error_spp,"
+                "denoise_ms\n";
+        for (const BenchmarkResult& result : results)
+        {
+            file << fmt::format("{},{},{},{},{},{},{},{},{},{},{}\n", result.name, settings.width, settings.height,
+                                settings.spp, result.timeMs, result.traceMs, result.mraysPerSecond,
+                                result.peakMemoryMiB, result.rmse, result.equalErrorSpp, result.denoiseMs);
+        }
+    }
+
+    return regression ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,3 +1,7 @@
+#include <chrono>
+#include <memory_resource>
+#include <thread>
+
 #include <fmt/chrono.h>
 #include <imgui.h>
 #include <vzt/Core/Logger.hpp>
@@ -9,29 +13,26 @@
 #include <vzt/Vulkan/Swapchain.hpp>
 #include <vzt/Window.hpp>
 
+#include "lop/Math/Procedural.hpp"
 #include "lop/Renderer/Geometry.hpp"
+#include "lop/Renderer/GpuProfiler.hpp"
+#include "lop/Renderer/PipelineCache.hpp"
+#include "lop/Renderer/Pass/Denoiser.hpp"
 #include "lop/Renderer/Pass/HardwarePathTracing.hpp"
+#include "lop/Renderer/Pass/Tonemap.hpp"
 #include "lop/Renderer/Pass/UserInterface.hpp"
 #include "lop/Renderer/Snapshot.hpp"
+#include "lop/System/Hierarchy.hpp"
+#include "lop/System/Memory.hpp"
+#include "lop/System/Profiler.hpp"
 #include "lop/System/System.hpp"
 #include "lop/System/Transform.hpp"
 #include "lop/Ui/Controller/Camera.hpp"
 #include "lop/Ui/Window/Overlay.hpp"
+#include "lop/Ui/Window/Profiler.hpp"
 
 #include <portable-file-dialogs.h>
 
-auto proceduralSky(const vzt::Vec3 rd) -> vzt::Vec3
-{
-    const vzt::Vec3 palette[2] = {vzt::Vec3(0.557f, 0.725f, 0.984f) * 1.1f, vzt::Vec3(0.957f, 0.573f, 0.445f) * 1.2f};
-    const float     angle      = std::acos(glm::dot(rd, vzt::Vec3(0.f, 0.f, 1.f)));
-
-    vzt::Vec3 color = glm::pow(glm::mix(palette[0], palette[1], std::abs(angle) / (vzt::Pi)), vzt::Vec3(1.5f));
-    if (angle < 0.3f)
-        color += glm::smoothstep(0.f, 0.3f, 0.3f - angle) * 100.f;
-
-    return color;
-}
-
 int main(int argc, char** argv)
 {
     const std::string ApplicationName = "Launcher of particle";
@@ -46,16 +47,20 @@ int main(int argc, char** argv)
 
     lop::System system{};
 
-    lop::MeshHandler geometryHandler{device, system};
+    lop::MeshHandler geometryHandler{device, system, swapchain.getImageNb()};
 
+    lop::PipelineCache           pipelineCache{device};
     lop::HardwarePathTracingPass pathtracingPass{
         device,
         swapchain.getImageNb(),
         window.getExtent(),
         geometryHandler,
-        lop::Environment::fromFunction(device, proceduralSky),
+        lop::Environment::fromFunction(device, lop::proceduralSky),
+        pipelineCache.getHandle(),
     };
-    lop::UserInterfacePass userInterfacePass{window, instance, device, swapchain};
+    lop::DenoiserPass      denoiserPass{device, swapchain.getImageNb(), window.getExtent(), pathtracingPass};
+    lop::TonemapPass       tonemapPass{device, swapchain.getImageNb(), pathtracingPass, denoiserPass};
+    lop::UserInterfacePass userInterfacePass{window, instance, device, swapchain, pipelineCache.getHandle()};
 
     vzt::Camera camera{};
     camera.up    = lop::Transform::Up;
@@ -67,7 +72,9 @@ int main(int argc, char** argv)
     lop::ControllerList cameraControllers{};
     cameraControllers.add<lop::CameraController>(cameraTransform);
 
-    lop::Overlay overlay{};
+    lop::Overlay        overlay{};
+    lop::ProfilerWindow profilerWindow{};
+    lop::GpuProfiler    gpuProfiler{device, swapchain.getImageNb()};
 
     const auto queue       = device.getQueue(vzt::QueueType::Compute);
     auto       commandPool = vzt::CommandPool(device, queue, swapchain.getImageNb());
@@ -75,9 +82,31 @@ int main(int argc, char** argv)
     vzt::Mat4 view = camera.getViewMatrix(cameraTransform.position, cameraTransform.rotation);
     lop::HardwarePathTracingPass::Properties properties{glm::inverse(view), camera.getProjectionMatrix(), 0};
 
+    bool                  denoise    = false;
+    bool                  exportAovs = false;
+    lop::DenoiserSettings denoiserSettings{};
+    lop::TonemapSettings  tonemapSettings{};
+
+    // Set when the displayed image must be updated while the accumulation is complete
+    bool displayOutdated = true;
+
+    // Frame rate of the viewer once the accumulation is complete, 0 to disable throttling
+    int32_t idleFrameRate = 10;
+
+    // Allocations through the global operator new between the starts of the two last frames
+    uint64_t heapAllocationNb      = lop::getHeapAllocationNb();
+    uint64_t frameHeapAllocationNb = 0;
+
     bool forceUpdate = false;
     while (window.update())
     {
+        const auto       frameStart = std::chrono::steady_clock::now();
+        lop::ScopedTimer frameTimer{"Frame"};
+
+        const uint64_t frameHeapAllocationStart = lop::getHeapAllocationNb();
+        frameHeapAllocationNb                   = frameHeapAllocationStart - heapAllocationNb;
+        heapAllocationNb                        = frameHeapAllocationStart;
+
         const auto& inputs = window.getInputs();
         if (inputs.windowResized)
             swapchain.setExtent(inputs.windowSize);
@@ -86,11 +115,13 @@ int main(int argc, char** argv)
         if (!submission)
             continue;
 
+        geometryHandler.nextFrame();
+
         const vzt::View<vzt::DeviceImage> backBuffer = swapchain.getImage(submission->imageId);
 
         vzt::Extent2D extent = window.getExtent();
 
-        // Per frame update
+        // Per frame update. With temporal accumulation, resetting the sample count keeps the reprojected history.
         vzt::Quat orientation = {1.f, 0.f, 0.f, 0.f};
         if (cameraControllers.update(inputs) || inputs.windowResized || forceUpdate)
         {
@@ -127,8 +158,34 @@ int main(int argc, char** argv)
             ImGui::Separator();
             ImGui::Text("Framerate: (%.1f)", io.Framerate);
             ImGui::Text("SPP: (%d)", properties.sampleId);
+
+            if (properties.statistics != 0)
+            {
+                const auto& rays      = pathtracingPass.getRayStatistics();
+                const auto  traceTime = lop::Profiler::get().getStatistics("GPU Trace rays");
+
+                ImGui::Separator();
+                ImGui::Text("Rays: %.1f Mrays/s", rays.getMraysPerSecond(traceTime.last));
+                ImGui::Text("Primary: %u", rays.primary);
+                ImGui::Text("Continuation: %u", rays.continuation);
+                ImGui::Text("NEE: %u", rays.lightSampling);
+                ImGui::Text("BSDF MIS: %u", rays.bsdfSampling);
+                ImGui::Text("Terminations: %u", rays.terminations);
+            }
+
+            if (properties.radianceCache != lop::RadianceCacheMode::Disabled)
+            {
+                const auto& rays = pathtracingPass.getRayStatistics();
+
+                ImGui::Separator();
+                ImGui::Text("Cache hit rate: %.1f%%", rays.getCacheHitRate() * 100.);
+                if (properties.radianceCache == lop::RadianceCacheMode::Validation)
+                    ImGui::Text("Cache bias: %+.2f%%", rays.getCacheBias() * 100.);
+            }
         });
 
+        profilerWindow.render(lop::Profiler::get());
+
         // Main window
         {
             ImGui::SetNextWindowBgAlpha(0.35f);
@@ -139,10 +196,132 @@ int main(int argc, char** argv)
                 if (ImGui::InputInt("Max sample", &maxSample, 0, 100))
                     properties.maxSample = maxSample;
 
+                ImGui::SliderInt("Idle frame rate", &idleFrameRate, 0, 60, idleFrameRate == 0 ? "Unlimited" : "%d");
+
                 int32_t bounces = properties.bounces;
                 if (ImGui::InputInt("Bounces", &bounces, 0, 128))
                     properties.bounces = bounces;
 
+                bool statistics = properties.statistics;
+                if (ImGui::Checkbox("Ray statistics", &statistics))
+                    properties.statistics = statistics;
+
+                constexpr const char* Sequences[] = {"PCG", "Sobol", "Rank-1 blue noise"};
+                int32_t               sequence    = static_cast<int32_t>(properties.sequence);
+                if (ImGui::Combo("Sampler", &sequence, Sequences, IM_ARRAYSIZE(Sequences)))
+                {
+                    properties.sequence = static_cast<lop::SampleSequence>(sequence);
+                    properties.sampleId = 0;
+                }
+
+                // Camera motions reproject the previous frames instead of restarting the accumulation
+                bool temporal = pathtracingPass.getTemporalAccumulation();
+                if (ImGui::Checkbox("Temporal accumulation", &temporal))
+                {
+                    pathtracingPass.setTemporalAccumulation(temporal);
+                    properties.sampleId = 0;
+                }
+
+                int32_t maxHistory = properties.temporalMaxHistory;
+                if (ImGui::SliderInt("Max history", &maxHistory, 1, 256))
+                    properties.temporalMaxHistory = maxHistory;
+
+                // Moving entities are traced at a random time of the shutter interval
+                int32_t       motionBlur   = static_cast<int32_t>(geometryHandler.getMotionBlur());
+                const int32_t maxSegmentNb = static_cast<int32_t>(lop::MeshHandler::MaxMotionSegmentNb);
+                if (ImGui::SliderInt("Motion segments", &motionBlur, 1, maxSegmentNb))
+                {
+                    geometryHandler.setMotionBlur(static_cast<uint32_t>(motionBlur));
+                    geometryHandler.update();
+                    pathtracingPass.update();
+                    properties.sampleId = 0;
+                }
+
+                static bool kernelVariants = true;
+                if (ImGui::Checkbox("Kernel variants", &kernelVariants))
+                    pathtracingPass.setKernelVariants(kernelVariants);
+
+                ImGui::SeparatorText("Radiance cache");
+                {
+                    constexpr const char* Modes[] = {"Disabled", "Enabled", "Validation"};
+                    int32_t               mode    = static_cast<int32_t>(properties.radianceCache);
+                    if (ImGui::Combo("Cache mode", &mode, Modes, IM_ARRAYSIZE(Modes)))
+                    {
+                        properties.radianceCache = static_cast<lop::RadianceCacheMode>(mode);
+                        properties.sampleId      = 0;
+                    }
+
+                    // Cells of another size no longer match the table
+                    if (ImGui::SliderFloat("Cell size", &properties.radianceCacheCellSize, .005f, 1.f, "%.3f",
+                                           ImGuiSliderFlags_Logarithmic))
+                    {
+                        pathtracingPass.update();
+                        properties.sampleId = 0;
+                    }
+
+                    const std::size_t footprint = pathtracingPass.getRadianceCache().getMemoryFootprint();
+                    ImGui::Text("Memory: %.1f MB", static_cast<double>(footprint) / (1024. * 1024.));
+                }
+
+                ImGui::SeparatorText("Memory");
+                {
+                    const lop::GeometryMemoryStatistics memory = geometryHandler.getMemoryStatistics();
+                    ImGui::Text("Geometry allocations (estimate): %u", memory.estimatedAllocationNb);
+                    ImGui::Text("Pool: %.1f / %.1f MB (%llu ranges)",
+                                static_cast<double>(memory.pool.used) / (1024. * 1024.),
+                                static_cast<double>(memory.pool.capacity) / (1024. * 1024.),
+                                static_cast<unsigned long long>(memory.pool.allocationNb));
+                    ImGui::Text("Fragmentation: %.1f%%", 100. * memory.pool.getFragmentation());
+                    ImGui::Text("Scratch: %.1f MB", static_cast<double>(memory.scratchSize) / (1024. * 1024.));
+                    ImGui::Text("Last update: %llu heap allocations (arena: %llu served, %llu blocks)",
+                                static_cast<unsigned long long>(memory.heapAllocationNb),
+                                static_cast<unsigned long long>(memory.arena.allocationNb),
+                                static_cast<unsigned long long>(memory.arena.upstreamAllocationNb));
+                    ImGui::Text("Last frame: %llu heap allocations",
+                                static_cast<unsigned long long>(frameHeapAllocationNb));
+                }
+
+                ImGui::SeparatorText("Denoiser");
+                {
+                    displayOutdated |= ImGui::Checkbox("Denoise", &denoise);
+
+                    int32_t iterations = denoiserSettings.iterations;
+                    if (ImGui::SliderInt("Iterations", &iterations, 1, lop::DenoiserPass::MaxIterations))
+                    {
+                        denoiserSettings.iterations = iterations;
+                        displayOutdated             = true;
+                    }
+
+                    displayOutdated |= ImGui::SliderFloat("Color phi", &denoiserSettings.colorPhi, 0.01f, 4.f, "%.3f");
+                    displayOutdated |=
+                        ImGui::SliderFloat("Normal phi", &denoiserSettings.normalPhi, 1.f, 256.f, "%.1f");
+                    displayOutdated |=
+                        ImGui::SliderFloat("Depth phi", &denoiserSettings.depthPhi, 0.001f, 1.f, "%.3f");
+                }
+
+                // Only applied to the accumulated image, changes do not restart the accumulation
+                ImGui::SeparatorText("Display");
+                {
+                    displayOutdated |=
+                        ImGui::SliderFloat("Exposure (EV)", &tonemapSettings.exposure, -8.f, 8.f, "%.2f");
+
+                    constexpr const char* Operators[] = {"ACES", "AgX", "Reinhard"};
+                    int32_t tonemapOperator           = static_cast<int32_t>(tonemapSettings.tonemapOperator);
+                    if (ImGui::Combo("Tonemap", &tonemapOperator, Operators, IM_ARRAYSIZE(Operators)))
+                    {
+                        tonemapSettings.tonemapOperator = static_cast<lop::TonemapOperator>(tonemapOperator);
+                        displayOutdated                 = true;
+                    }
+
+                    constexpr const char* Transforms[]    = {"Linear", "sRGB"};
+                    int32_t               outputTransform = static_cast<int32_t>(tonemapSettings.outputTransform);
+                    if (ImGui::Combo("Output", &outputTransform, Transforms, IM_ARRAYSIZE(Transforms)))
+                    {
+                        tonemapSettings.outputTransform = static_cast<lop::OutputTransform>(outputTransform);
+                        displayOutdated                 = true;
+                    }
+                }
+
                 ImGui::SeparatorText("Export");
                 {
                     bool transparentBackground = properties.transparentBackground;
@@ -168,6 +347,24 @@ int main(int argc, char** argv)
                         pfd::message("Export done!", fmt::format("{} has been saved.", fileName), pfd::choice::ok,
                                      pfd::icon::info);
                     }
+
+                    // Beauty pass with albedo, normal, depth and instance id layers
+                    ImGui::Checkbox("AOVs", &exportAovs);
+                    ImGui::SameLine();
+                    if (ImGui::Button("Export layers") && !fileName.empty())
+                    {
+                        const vzt::Path layersPath = vzt::Path(fileName).replace_extension(".exr");
+                        if (lop::snapshotLayers(device, pathtracingPass, layersPath))
+                        {
+                            pfd::message("Export done!", fmt::format("{} has been saved.", layersPath.string()),
+                                         pfd::choice::ok, pfd::icon::info);
+                        }
+                        else
+                        {
+                            pfd::message("Export failed!", fmt::format("{} could not be saved.", layersPath.string()),
+                                         pfd::choice::ok, pfd::icon::error);
+                        }
+                    }
                 }
 
                 ImGui::Separator();
@@ -227,7 +424,11 @@ int main(int argc, char** argv)
                                 entity.emplace<lop::Material>();
                                 entity.emplace<lop::Transform>();
                                 auto& newMesh = entity.emplace<vzt::Mesh>(vzt::readObj(result));
-                                entity.emplace<lop::MeshHolder>(device, newMesh);
+
+                                // Vertex staging is only needed by the load, the handler arena outlives it
+                                std::pmr::monotonic_buffer_resource staging{};
+                                entity.emplace<lop::MeshHolder>(device, newMesh, &staging,
+                                                                 &geometryHandler.getBuildScratch());
 
                                 selected = entity;
                             }
@@ -261,6 +462,57 @@ int main(int argc, char** argv)
                         update |= ImGui::InputFloat("Y", &position.y, 0.01f, 1.0f, "%.3f");
                         update |= ImGui::InputFloat("Z", &position.z, 0.01f, 1.0f, "%.3f");
 
+                        // The transform becomes relative to the new parent
+                        const lop::Hierarchy* hierarchy = system.registry.try_get<lop::Hierarchy>(selected);
+                        const entt::entity    parent    = hierarchy ? hierarchy->parent : entt::null;
+                        const lop::Name*      parentName =
+                            parent != entt::null ? system.registry.try_get<lop::Name>(parent) : nullptr;
+                        if (ImGui::BeginCombo("Parent", parentName ? parentName->value.c_str() : "None"))
+                        {
+                            if (ImGui::Selectable("None", parent == entt::null) && hierarchy)
+                            {
+                                system.registry.remove<lop::Hierarchy>(selected);
+                                update = true;
+                            }
+
+                            for (const entt::entity entity : system.registry.view<lop::Name, lop::Transform>())
+                            {
+                                if (entity == selected)
+                                    continue;
+
+                                const auto& candidate = system.registry.get<lop::Name>(entity);
+                                const auto  label = fmt::format("{}##{}", candidate.value, vzt::toUnderlying(entity));
+                                if (ImGui::Selectable(label.c_str(), entity == parent))
+                                {
+                                    system.registry.emplace_or_replace<lop::Hierarchy>(selected, entity);
+                                    update = true;
+                                }
+                            }
+                            ImGui::EndCombo();
+                        }
+
+                        // The transform above is the one at shutter open
+                        lop::Motion* motion = system.registry.try_get<lop::Motion>(selected);
+                        bool         moving = motion != nullptr;
+                        if (ImGui::Checkbox("Motion", &moving))
+                        {
+                            if (moving)
+                                system.registry.emplace<lop::Motion>(selected, transform);
+                            else
+                                system.registry.remove<lop::Motion>(selected);
+
+                            motion = system.registry.try_get<lop::Motion>(selected);
+                            update = true;
+                        }
+
+                        if (motion)
+                        {
+                            glm::vec3& closePosition = motion->close.position;
+                            update |= ImGui::InputFloat("Close X", &closePosition.x, 0.01f, 1.0f, "%.3f");
+                            update |= ImGui::InputFloat("Close Y", &closePosition.y, 0.01f, 1.0f, "%.3f");
+                            update |= ImGui::InputFloat("Close Z", &closePosition.z, 0.01f, 1.0f, "%.3f");
+                        }
+
                         ImGui::Text("Material");
 
                         glm::vec3& baseColor = material.baseColor;
@@ -290,6 +542,12 @@ int main(int argc, char** argv)
 
                         if (update)
                         {
+                            // Notifies the render scene of the changes made in place
+                            system.registry.patch<lop::Transform>(selected);
+                            system.registry.patch<lop::Material>(selected);
+                            if (motion)
+                                system.registry.patch<lop::Motion>(selected);
+
                             geometryHandler.update();
                             pathtracingPass.update();
                             properties.sampleId = 0;
@@ -300,12 +558,38 @@ int main(int argc, char** argv)
             }
         }
 
+        // The denoiser is guided by the AOVs
+        if (const bool aovs = denoise || exportAovs; aovs != pathtracingPass.getAovs())
+        {
+            device.wait();
+            pathtracingPass.setAovs(aovs);
+            denoiserPass.resize(pathtracingPass.getExtent());
+            tonemapPass.resize();
+            properties.sampleId = 0;
+        }
+
         vzt::CommandBuffer commands = commandPool[submission->imageId];
         {
             commands.begin();
             {
-                pathtracingPass.record(submission->imageId, commands, backBuffer, properties);
-                userInterfacePass.record(submission->imageId, commands, backBuffer);
+                gpuProfiler.begin(submission->imageId, commands);
+
+                // Once the accumulation is complete, nothing is traced and the render image is kept until the display
+                // settings change
+                pathtracingPass.trace(submission->imageId, commands, properties, &gpuProfiler);
+                if (!properties.isConverged() || displayOutdated)
+                {
+                    using Source = lop::TonemapPass::Source;
+                    if (denoise)
+                        denoiserPass.record(submission->imageId, commands, denoiserSettings, &gpuProfiler);
+
+                    tonemapPass.record(submission->imageId, commands, denoise ? Source::Denoised : Source::Accumulation,
+                                       tonemapSettings, &gpuProfiler);
+                    displayOutdated = false;
+                }
+
+                pathtracingPass.copy(submission->imageId, commands, backBuffer, &gpuProfiler);
+                userInterfacePass.record(submission->imageId, commands, backBuffer, &gpuProfiler);
             }
             commands.end();
         }
@@ -315,7 +599,8 @@ int main(int argc, char** argv)
         // Handle resize
         if (!swapchain.present())
         {
-            // Wait all commands execution
+            // Only the swapchain images and the UI framebuffers require every frame to be complete, path tracing
+            // targets are retired by the pass itself.
             device.wait();
 
             // Apply screen size update
@@ -323,13 +608,23 @@ int main(int argc, char** argv)
             camera.aspectRatio   = static_cast<float>(extent.width) / static_cast<float>(extent.height);
 
             pathtracingPass.resize(extent);
+            denoiserPass.resize(extent);
+            tonemapPass.resize();
             userInterfacePass.resize(extent);
 
             forceUpdate = true;
         }
 
-        if (properties.maxSample == 0 || properties.sampleId < properties.maxSample)
+        if (properties.isConverged())
+        {
+            // Only the interface is still drawn, no need to run at the refresh rate
+            if (idleFrameRate > 0)
+                std::this_thread::sleep_until(frameStart + std::chrono::microseconds(1'000'000 / idleFrameRate));
+        }
+        else
+        {
             properties.sampleId++;
+        }
     }
 
     return EXIT_SUCCESS;
@@ -0,0 +1,560 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include "lop/Math/Sampling.hpp"
+#include "lop/Renderer/LightTree.hpp"
+#include "lop/System/Hierarchy.hpp"
+#include "lop/System/Parallel.hpp"
+#include "lop/System/RangeAllocator.hpp"
+
+// CPU micro-benchmarks of the sampling distributions, on a synthetic environment-like luminance with a few hot spots,
+// of the light selection strategies on walls of emissive triangles of increasing size, of the range allocator
+// suballocating device buffers on a random allocation churn, and of the evaluation of transform hierarchies.
+// Usage: LOPMicroBench [--width w] [--height h] [--samples n] [--threads t] [--repetitions r] [--light-samples n]
+//        [--allocations n]
+
+struct MicroBenchmarkSettings
+{
+    uint32_t width       = 4096;
+    uint32_t height      = 2048;
+    uint32_t samples     = 1u << 22;
+    uint32_t threads     = 0; // Every hardware thread when 0
+    uint32_t repetitions = 5;
+
+    uint32_t lightPoints  = 256; // Shading points of each light selection test
+    uint32_t lightSamples = 256; // Light samples per shading point
+
+    uint32_t allocations = 1u << 20; // Operations of the range allocator churn
+};
+
+// Best time of several runs, in milliseconds
+template <class Task>
+double measure(uint32_t repetitions, Task&& task)
+{
+    double best = std::numeric_limits<double>::max();
+    for (uint32_t i = 0; i < repetitions; i++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        task();
+        const auto end = std::chrono::steady_clock::now();
+        best           = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    return best;
+}
+
+// Row cdfs as built before Distribution2D: serial, with a division per element in both passes
+float getScalarCumulativeDistributionFunctions(vzt::CSpan<float> data, vzt::Span<float> cdf)
+{
+    const float weight = static_cast<float>(data.size);
+    cdf[0]             = 0.f;
+    for (std::size_t i = 1; i < data.size + 1; i++)
+        cdf[i] = cdf[i - 1] + data[i - 1] / weight;
+
+    const float sum    = cdf[data.size];
+    cdf[data.size + 1] = sum;
+    for (std::size_t i = 1; i < data.size + 1; i++)
+        cdf[i] /= sum;
+
+    return sum;
+}
+
+std::vector<float> getLuminance(uint32_t width, uint32_t height)
+{
+    std::mt19937                          generator{42};
+    std::uniform_real_distribution<float> noise{0.f, 1.f};
+
+    std::vector<float> luminance{};
+    luminance.resize(std::size_t(width) * height);
+    for (uint32_t y = 0; y < height; y++)
+    {
+        const float sinTheta = std::sin(3.14159265f * (static_cast<float>(y) + .5f) / static_cast<float>(height));
+        for (uint32_t x = 0; x < width; x++)
+            luminance[std::size_t(y) * width + x] = (1.f + .1f * noise(generator)) * sinTheta;
+    }
+
+    // Sun-like spots concentrating most of the energy
+    for (uint32_t spot = 0; spot < 4; spot++)
+    {
+        const uint32_t cx = static_cast<uint32_t>(noise(generator) * static_cast<float>(width - 16));
+        const uint32_t cy = static_cast<uint32_t>(noise(generator) * static_cast<float>(height - 16));
+        for (uint32_t y = cy; y < cy + 16; y++)
+            for (uint32_t x = cx; x < cx + 16; x++)
+                luminance[std::size_t(y) * width + x] = 1e4f;
+    }
+
+    return luminance;
+}
+
+// Grid of small emitters facing +Z, like a LED wall, whose emission spans two orders of magnitude
+std::vector<lop::EmissiveTriangle> getLightWall(uint32_t lightNb)
+{
+    std::mt19937                          generator{lightNb};
+    std::uniform_real_distribution<float> uniform{0.f, 1.f};
+
+    const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(lightNb))));
+    const float    cell = 20.f / static_cast<float>(side);
+
+    std::vector<lop::EmissiveTriangle> lights{};
+    lights.reserve(lightNb);
+    for (uint32_t i = 0; i < lightNb; i++)
+    {
+        const float     x      = static_cast<float>(i % side);
+        const float     y      = static_cast<float>(i / side);
+        const vzt::Vec3 corner = {-10.f + cell * x, -10.f + cell * y, 0.f};
+
+        lop::EmissiveTriangle light{};
+        light.p0       = corner;
+        light.p1       = corner + vzt::Vec3(cell * .5f, 0.f, 0.f);
+        light.p2       = corner + vzt::Vec3(0.f, cell * .5f, 0.f);
+        light.area     = .5f * glm::length(glm::cross(light.p1 - light.p0, light.p2 - light.p0));
+        light.emission = vzt::Vec3(std::pow(10.f, 2.f * uniform(generator) - 1.f));
+        lights.emplace_back(light);
+    }
+
+    return lights;
+}
+
+// Contribution of a light to a shading point, the light being reduced to its centroid so that the only remaining
+// variance comes from the selection
+float getContribution(const lop::EmissiveTriangle& light, vzt::Vec3 p, vzt::Vec3 n)
+{
+    const vzt::Vec3 toLight  = (light.p0 + light.p1 + light.p2) / 3.f - p;
+    const float     d2       = glm::dot(toLight, toLight);
+    const vzt::Vec3 wi       = toLight / std::sqrt(d2);
+    const vzt::Vec3 normal   = glm::normalize(glm::cross(light.p1 - light.p0, light.p2 - light.p0));
+    const float     geometry = std::abs(glm::dot(wi, normal)) * std::abs(glm::dot(wi, n)) / d2;
+    return light.getPower() * geometry;
+}
+
+// Relative RMSE of a single sample estimate of the direct lighting, with lights selected proportionally to their
+// power or through the light tree. Returns the number of inconsistent probabilities.
+uint32_t benchmarkLightSelection(const MicroBenchmarkSettings& settings)
+{
+    fmt::print("{:<32}{:>16}{:>16}{:>16}{:>16}{:>16}\n", "Light selection", "Build (ms)", "Power (rel.)",
+               "Tree (rel.)", "Sample (ns)", "Spp ratio");
+
+    uint32_t failures = 0;
+    for (const uint32_t lightNb : {16u, 256u, 4096u, 65536u})
+    {
+        const std::vector<lop::EmissiveTriangle> lights = getLightWall(lightNb);
+
+        lop::LightTree tree{};
+        const double   buildMs = measure(settings.repetitions, [&]() { tree.build(lights); });
+
+        std::vector<float> powers{};
+        powers.reserve(lights.size());
+        for (const lop::EmissiveTriangle& light : lights)
+            powers.emplace_back(light.getPower());
+        const lop::Distribution1D powerDistribution{powers};
+
+        std::mt19937                          generator{7};
+        std::uniform_real_distribution<float> uniform{0.f, 1.f};
+
+        double powerError = 0.;
+        double treeError  = 0.;
+        double treeMs     = 0.;
+        for (uint32_t i = 0; i < settings.lightPoints; i++)
+        {
+            const vzt::Vec3 p = {24.f * uniform(generator) - 12.f, 24.f * uniform(generator) - 12.f,
+                                 .05f + 4.f * uniform(generator)};
+
+            const float     z   = 2.f * uniform(generator) - 1.f;
+            const float     phi = 6.2831853f * uniform(generator);
+            const float     r   = std::sqrt(std::max(0.f, 1.f - z * z));
+            const vzt::Vec3 n   = {r * std::cos(phi), r * std::sin(phi), z};
+
+            double reference = 0.;
+            for (const lop::EmissiveTriangle& light : lights)
+                reference += getContribution(light, p, n);
+
+            std::vector<float> u(settings.lightSamples);
+            for (float& value : u)
+                value = std::min(uniform(generator), 0x1.fffffep-1f);
+
+            double powerSquaredError = 0.;
+            for (const float value : u)
+            {
+                float          probability;
+                const uint32_t lightId  = powerDistribution.sampleDiscrete(value, probability);
+                const double   estimate = getContribution(lights[lightId], p, n) / probability;
+                powerSquaredError += (estimate - reference) * (estimate - reference);
+            }
+
+            std::vector<uint32_t> lightIds(u.size());
+            std::vector<float>    probabilities(u.size());
+            treeMs += measure(1, [&]() {
+                for (std::size_t j = 0; j < u.size(); j++)
+                    lightIds[j] = tree.sample(p, n, u[j], probabilities[j]);
+            });
+
+            double treeSquaredError = 0.;
+            for (std::size_t j = 0; j < u.size(); j++)
+            {
+                double estimate = 0.;
+                if (lightIds[j] != lop::LightTree::NoLight)
+                    estimate = getContribution(lights[lightIds[j]], p, n) / probabilities[j];
+                treeSquaredError += (estimate - reference) * (estimate - reference);
+
+                // Probabilities evaluated from the bit trails are the ones of the MIS weights of BSDF samples
+                if (lightIds[j] != lop::LightTree::NoLight)
+                {
+                    const float probability = tree.getProbability(p, n, lightIds[j]);
+                    failures += std::abs(probability - probabilities[j]) > 1e-4f * probabilities[j];
+                }
+            }
+
+            // The tree must select every contributing light
+            if (lightNb <= 4096 && i < 8)
+            {
+                double sum = 0.;
+                for (uint32_t lightId = 0; lightId < lightNb; lightId++)
+                    sum += tree.getProbability(p, n, lightId);
+                failures += std::abs(sum - 1.) > 1e-3;
+            }
+
+            const double samples = static_cast<double>(settings.lightSamples);
+            powerError += powerSquaredError / (samples * reference * reference);
+            treeError += treeSquaredError / (samples * reference * reference);
+        }
+
+        const double points = static_cast<double>(settings.lightPoints);
+        powerError          = std::sqrt(powerError / points);
+        treeError           = std::sqrt(treeError / points);
+
+        const double samples = points * static_cast<double>(settings.lightSamples);
+        fmt::print("{:<32}{:>16.2f}{:>16.3f}{:>16.3f}{:>16.2f}{:>16.1f}\n", fmt::format("{} lights", lightNb), buildMs,
+                   powerError, treeError, 1e6 * treeMs / samples, (powerError * powerError) / (treeError * treeError));
+    }
+
+    return failures;
+}
+
+// Random allocations and releases of sizes spread between 256B and 1MB, as the per-update buffers of the geometry.
+// Returns the number of overlapping or lost ranges and of failed allocations which would have fit.
+uint32_t benchmarkRangeAllocator(const MicroBenchmarkSettings& settings)
+{
+    fmt::print("{:<32}{:>16}{:>16}{:>16}{:>16}\n", "Range allocator", "Operation (ns)", "Live", "Used (%)",
+               "Fragmentation");
+
+    constexpr uint64_t Capacity = uint64_t(1) << 30;
+
+    uint32_t failures = 0;
+    for (const uint32_t liveNb : {64u, 1024u, 16384u})
+    {
+        std::mt19937                          generator{7};
+        std::uniform_real_distribution<float> uniform{0.f, 1.f};
+
+        std::vector<uint64_t> sizes(settings.allocations);
+        for (uint64_t& size : sizes)
+            size = static_cast<uint64_t>(256.f * std::exp2(12.f * uniform(generator)));
+
+        // Releases pick a random live range, allocations are made while there are less than liveNb of them
+        std::vector<uint32_t> picks(settings.allocations);
+        for (uint32_t& pick : picks)
+            pick = static_cast<uint32_t>(generator());
+
+        lop::RangeAllocator    allocator{Capacity};
+        std::vector<lop::Range> live{};
+        live.reserve(liveNb);
+
+        const double churnMs = measure(1, [&]() {
+            for (uint32_t i = 0; i < settings.allocations; i++)
+            {
+                if (live.size() < liveNb && (live.empty() || picks[i] % 4 != 0))
+                {
+                    // Allocations may only fail when every free range is too small
+                    const lop::Range range = allocator.allocate(sizes[i]);
+                    if (range.isValid())
+                        live.emplace_back(range);
+                    else
+                        failures += allocator.getStatistics().largestFree >= sizes[i];
+                    continue;
+                }
+
+                const std::size_t id = picks[i] % live.size();
+                allocator.release(live[id]);
+                live[id] = live.back();
+                live.pop_back();
+            }
+        });
+
+        const lop::RangeStatistics statistics = allocator.getStatistics();
+
+        // Live ranges must be disjoint and accounted for
+        std::sort(live.begin(), live.end(),
+                  [](const lop::Range& a, const lop::Range& b) { return a.offset < b.offset; });
+
+        uint64_t used = 0;
+        for (std::size_t i = 0; i < live.size(); i++)
+        {
+            used += live[i].size;
+            failures += live[i].offset + live[i].size > Capacity;
+            failures += i + 1 < live.size() && live[i].offset + live[i].size > live[i + 1].offset;
+        }
+        failures += used != statistics.used || live.size() != statistics.allocationNb;
+
+        fmt::print("{:<32}{:>16.2f}{:>16}{:>16.2f}{:>16.3f}\n", fmt::format("{} live ranges", liveNb),
+                   1e6 * churnMs / static_cast<double>(settings.allocations), live.size(),
+                   100. * static_cast<double>(statistics.used) / static_cast<double>(Capacity),
+                   statistics.getFragmentation());
+
+        // Every free range must merge back
+        for (const lop::Range& range : live)
+            allocator.release(range);
+        failures += !allocator.isEmpty() || allocator.getStatistics().largestFree != Capacity;
+    }
+
+    return failures;
+}
+
+// Assemblies made of 32 sub-assemblies of 32 parts. The per-entity evaluation composes the matrices of Transform::get
+// up to the root for every entity, the hierarchy evaluates every node, the subtree of an assembly, or 1% of the parts.
+// Returns the number of world transforms differing from the per-entity ones.
+uint32_t benchmarkHierarchy(const MicroBenchmarkSettings& settings)
+{
+    fmt::print("{:<32}{:>16}{:>16}{:>16}{:>16}\n", "Transform hierarchy", "Per entity (ms)", "Full (ms)",
+               "Subtree (ms)", "Parts (ms)");
+
+    constexpr uint32_t Width = 32;
+
+    uint32_t failures = 0;
+    for (const uint32_t assemblyNb : {1u, 16u, 128u})
+    {
+        std::mt19937                          generator{7};
+        std::uniform_real_distribution<float> uniform{-1.f, 1.f};
+
+        const auto getTransform = [&]() {
+            lop::Transform transform{};
+            transform.position = {uniform(generator), uniform(generator), uniform(generator)};
+            transform.rotation = glm::normalize(
+                vzt::Quat{uniform(generator), uniform(generator), uniform(generator), uniform(generator)});
+            return transform;
+        };
+
+        entt::registry           registry{};
+        lop::TransformHierarchy  hierarchy{registry};
+        std::vector<entt::entity> roots{};
+        std::vector<entt::entity> parts{};
+        for (uint32_t a = 0; a < assemblyNb; a++)
+        {
+            const entt::entity root = roots.emplace_back(registry.create());
+            registry.emplace<lop::Transform>(root, getTransform());
+            for (uint32_t s = 0; s < Width; s++)
+            {
+                const entt::entity subAssembly = registry.create();
+                registry.emplace<lop::Transform>(subAssembly, getTransform());
+                registry.emplace<lop::Hierarchy>(subAssembly, root);
+                for (uint32_t p = 0; p < Width; p++)
+                {
+                    const entt::entity part = parts.emplace_back(registry.create());
+                    registry.emplace<lop::Transform>(part, getTransform());
+                    registry.emplace<lop::Hierarchy>(part, subAssembly);
+                }
+            }
+        }
+
+        std::vector<entt::entity> entities{};
+        for (const entt::entity entity : registry.view<lop::Transform>())
+            entities.emplace_back(entity);
+
+        std::vector<glm::mat4> references(entities.size());
+        const double           perEntityMs = measure(settings.repetitions, [&]() {
+            for (std::size_t i = 0; i < entities.size(); i++)
+            {
+                entt::entity entity = entities[i];
+                glm::mat4    world  = registry.get<lop::Transform>(entity).get();
+                while (const lop::Hierarchy* parent = registry.try_get<lop::Hierarchy>(entity))
+                {
+                    entity = parent->parent;
+                    world  = registry.get<lop::Transform>(entity).get() * world;
+                }
+                references[i] = world;
+            }
+        });
+
+        const double fullMs = measure(settings.repetitions, [&]() {
+            registry.patch<lop::Hierarchy>(registry.view<lop::Hierarchy>().front());
+            hierarchy.update(settings.threads);
+        });
+
+        const double subtreeMs = measure(settings.repetitions, [&]() {
+            registry.patch<lop::Transform>(roots[0]);
+            hierarchy.update(settings.threads);
+        });
+
+        std::vector<entt::entity> patched(parts.size() / 100);
+        for (entt::entity& entity : patched)
+            entity = parts[generator() % parts.size()];
+        const double partsMs = measure(settings.repetitions, [&]() {
+            for (const entt::entity entity : patched)
+                registry.patch<lop::Transform>(entity);
+            hierarchy.update(settings.threads);
+        });
+
+        for (std::size_t i = 0; i < entities.size(); i++)
+        {
+            const lop::InstanceTransform& world = hierarchy.getWorld(hierarchy.getNode(entities[i]));
+            for (uint32_t r = 0; r < 3; r++)
+            {
+                for (uint32_t c = 0; c < 4; c++)
+                    failures += std::abs(world.rows[r][c] - references[i][c][r]) > 1e-4f;
+            }
+        }
+
+        fmt::print("{:<32}{:>16.3f}{:>16.3f}{:>16.3f}{:>16.3f}\n", fmt::format("{} nodes", entities.size()),
+                   perEntityMs, fullMs, subtreeMs, partsMs);
+    }
+
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    MicroBenchmarkSettings settings{};
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+        const bool             hasValue = i + 1 < argc;
+        if (argument == "--width" && hasValue)
+            settings.width = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--height" && hasValue)
+            settings.height = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--samples" && hasValue)
+            settings.samples = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--threads" && hasValue)
+            settings.threads = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--repetitions" && hasValue)
+            settings.repetitions = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+        else if (argument == "--light-samples" && hasValue)
+            settings.lightSamples = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+        else if (argument == "--allocations" && hasValue)
+            settings.allocations = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+    }
+
+    const uint32_t           width     = settings.width;
+    const uint32_t           height    = settings.height;
+    const uint32_t           threads   = lop::getThreadCount(settings.threads);
+    const std::vector<float> luminance = getLuminance(width, height);
+
+    fmt::print("{}x{} function, {} samples, {} threads\n", width, height, settings.samples, threads);
+    fmt::print("{:<32}{:>16}\n", "Construction", "Time (ms)");
+
+    std::vector<float> cdfs((width + 2ul) * height);
+    const double       scalarMs = measure(settings.repetitions, [&]() {
+        for (uint32_t y = 0; y < height; y++)
+        {
+            getScalarCumulativeDistributionFunctions(
+                vzt::CSpan<float>(luminance.data() + std::size_t(y) * width, width),
+                vzt::Span<float>(cdfs.data() + std::size_t(y) * (width + 2ul), width + 2ul));
+        }
+    });
+    fmt::print("{:<32}{:>16.2f}\n", "Scalar row cdfs", scalarMs);
+
+    const double singleMs = measure(settings.repetitions, [&]() {
+        for (uint32_t y = 0; y < height; y++)
+        {
+            lop::getCumulativeDistributionFunctions(
+                vzt::CSpan<float>(luminance.data() + std::size_t(y) * width, width),
+                vzt::Span<float>(cdfs.data() + std::size_t(y) * (width + 2ul), width + 2ul));
+        }
+    });
+    fmt::print("{:<32}{:>16.2f}\n", "Row cdfs", singleMs);
+
+    lop::Distribution2D distribution{};
+    const double        distributionMs = measure(settings.repetitions, [&]() {
+        distribution = lop::Distribution2D(luminance, width, height, threads);
+    });
+    fmt::print("{:<32}{:>16.2f}\n", "Distribution2D", distributionMs);
+
+    // Lookups are compared on the marginal and on the conditional of the row holding the most energy
+    std::mt19937                          generator{7};
+    std::uniform_real_distribution<float> uniform{0.f, 1.f};
+    std::vector<float>                    u(settings.samples);
+    for (float& value : u)
+        value = std::min(uniform(generator), 0x1.fffffep-1f);
+
+    // Both lookups must find the same segments, their sums also keep them from being optimized out
+    uint32_t   mismatches = 0;
+    const auto lookup     = [&](const lop::Distribution1D& target) {
+        uint64_t     binarySum = 0;
+        const double binaryMs  = measure(settings.repetitions, [&]() {
+            binarySum = 0;
+            for (const float value : u)
+                binarySum += target.findBinary(value);
+        });
+
+        uint64_t     guidedSum = 0;
+        const double guidedMs  = measure(settings.repetitions, [&]() {
+            guidedSum = 0;
+            for (const float value : u)
+                guidedSum += target.find(value);
+        });
+
+        for (const float value : u)
+            mismatches += target.find(value) != target.findBinary(value);
+        mismatches += binarySum != guidedSum;
+
+        const double samples = static_cast<double>(settings.samples);
+        return std::make_pair(1e6 * binaryMs / samples, 1e6 * guidedMs / samples);
+    };
+
+    uint32_t   hotRow = 0;
+    const auto cdf    = distribution.getMarginal().getCdf();
+    for (uint32_t y = 1; y < height; y++)
+        hotRow = cdf[y + 1] - cdf[y] > cdf[hotRow + 1] - cdf[hotRow] ? y : hotRow;
+
+    fmt::print("{:<32}{:>16}{:>16}\n", "Lookup", "Binary (ns)", "Guide (ns)");
+    const auto [marginalBinary, marginalGuided] = lookup(distribution.getMarginal());
+    fmt::print("{:<32}{:>16.2f}{:>16.2f}\n", "Marginal", marginalBinary, marginalGuided);
+    const auto [conditionalBinary, conditionalGuided] = lookup(distribution.getConditional(hotRow));
+    fmt::print("{:<32}{:>16.2f}{:>16.2f}\n", "Conditional (hot row)", conditionalBinary, conditionalGuided);
+
+    float      pdfError = 0.f;
+    const auto sampleMs = measure(settings.repetitions, [&]() {
+        pdfError = 0.f;
+        for (std::size_t i = 0; i + 1 < u.size(); i += 2)
+        {
+            float           pdf;
+            const vzt::Vec2 uv = distribution.sample({u[i], u[i + 1]}, pdf);
+            pdfError           = std::max(pdfError, std::abs(pdf - distribution.getPdf(uv)) / pdf);
+        }
+    });
+    fmt::print("{:<32}{:>16.2f}\n", "Sample + pdf (ns)", 2e6 * sampleMs / static_cast<double>(settings.samples));
+
+    if (mismatches != 0 || pdfError > 1e-4f)
+    {
+        fmt::print("Guide table lookups differ from the binary search ({} mismatches), or pdfs differ ({})\n",
+                   mismatches, pdfError);
+        return EXIT_FAILURE;
+    }
+
+    if (const uint32_t failures = benchmarkLightSelection(settings); failures != 0)
+    {
+        fmt::print("Light tree probabilities are inconsistent ({} failures)\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    if (const uint32_t failures = benchmarkRangeAllocator(settings); failures != 0)
+    {
+        fmt::print("Range allocator lost or overlapped ranges ({} failures)\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    if (const uint32_t failures = benchmarkHierarchy(settings); failures != 0)
+    {
+        fmt::print("Transform hierarchy differs from the per-entity evaluation ({} failures)\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
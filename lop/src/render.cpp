@@ -0,0 +1,978 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include <fmt/format.h>
+#include <vzt/Core/Logger.hpp>
+#include <vzt/Data/Camera.hpp>
+#include <vzt/Utils/IOMesh.hpp>
+#include <vzt/Vulkan/Command.hpp>
+#include <vzt/Vulkan/Device.hpp>
+#include <vzt/Vulkan/Instance.hpp>
+
+#include "lop/Math/Procedural.hpp"
+#include "lop/Renderer/Accumulation.hpp"
+#include "lop/Renderer/Geometry.hpp"
+#include "lop/Renderer/ImageWriter.hpp"
+#include "lop/Renderer/Pass/Denoiser.hpp"
+#include "lop/Renderer/Pass/HardwarePathTracing.hpp"
+#include "lop/Renderer/Pass/Tonemap.hpp"
+#include "lop/Renderer/Snapshot.hpp"
+#include "lop/System/Sequence.hpp"
+#include "lop/System/Socket.hpp"
+#include "lop/System/System.hpp"
+#include "lop/System/Transform.hpp"
+
+// Offline renderer of animated sequences: each frame is accumulated to a fixed sample count, then written to a
+// numbered file by a background writer while the next one is traced. Between frames, only the entities patched by the
+// sequence are updated: meshes and their bottom level structures, the environment and the pipelines are kept.
+// Usage: LOPRender [--width w] [--height h] [--spp n] [--frames n] [--fps f] [--shutter s] [--motion-segments n]
+//                  [--mesh file.obj]... [--environment file.exr] [--camera x y z] [--keyframes file] [--turntable]
+//                  [--seed s] [--samples first:end] [--output frames/frame_####.png|.exr|.acc]
+//                  [--checkpoint seconds] [--resume]
+//        LOPRender --listen port [--workers n] [--chunk spp] [--timeout seconds] [--width w] [--height h] [--spp n]
+//                  [--frames n] [--seed s] [--samples first:end] [--output frames/frame_####.exr|.acc]
+//        LOPRender --connect host:port <scene options of the first form>
+//        LOPRender --merge partial_a/frame_####.acc --merge partial_b/frame_####.acc... [--frames n]
+//                  [--output frames/frame_####.exr|.acc]
+//
+// Keyframes are read one per line as "<target> <time> <x> <y> <z> [<angle> <axis x> <axis y> <axis z>]", the target
+// being either camera or the name of an entity, that is the stem of its mesh file. Angles are in degrees, lines
+// starting with '#' are ignored.
+//
+// Each frame traces the samples [first, end) of the sequence of the seed, [0, spp) by default. Radiance is summed in
+// fixed point, see lop::RawAccumulation: with an .acc output, the raw sums of each frame are written with their sample
+// range, and --merge adds the files of disjoint ranges or seeds into the exact sums of a single run of every range.
+// Frames are then written as raw sums again, or as OpenEXR averages.
+//
+// With --checkpoint, the sums traced so far and the hash of the scene and camera of the frame are saved every given
+// seconds next to the output of an OpenEXR or raw frame, as frame_####.checkpoint.acc. --resume skips the frames
+// already written and continues a frame from its checkpoint when it was saved with the same scene, camera, seed and
+// samples.
+//
+// With --listen, the process coordinates the rendering of workers started with --connect and the same scene options,
+// on this host or others. Samples of each frame are split in ranges of --chunk samples, handed to the workers as they
+// become idle so that faster nodes render more of them. Each range is traced into fresh sums, which the coordinator
+// merges. The coordinator needs no device and writes OpenEXR or raw frames. It drops the workers whose settings differ
+// from the ones of the first worker, or whose scene hash of a frame differs from the one of the samples merged so far.
+// Workers have --timeout seconds to connect and to answer each job, 0 waiting indefinitely. A worker timing out is
+// handled as a lost one, and the coordinator goes on with the workers connected by then.
+
+struct RenderSettings
+{
+    uint32_t               width           = 1280;
+    uint32_t               height          = 720;
+    uint32_t               spp             = 256;
+    uint32_t               frameNb         = 1;
+    float                  frameRate       = 24.f;
+    float                  shutter         = 0.f;
+    uint32_t               motionSegmentNb = 4;
+    std::vector<vzt::Path> meshes          = {};
+    vzt::Path              environment     = "";
+    vzt::Vec3              cameraPosition  = {0.f, -10.f, 0.f};
+    vzt::Path              keyframes       = "";
+    bool                   turntable       = false;
+    uint32_t               seed            = 0;
+    uint32_t               firstSample     = 0;
+    std::string            output          = "frames/frame_####.png";
+    float                  checkpoint      = 0.f; // Seconds between checkpoints, disabled when 0
+    bool                   resume          = false;
+
+    // Raw sums of disjoint sample ranges to merge, see above
+    std::vector<std::string> merged = {};
+
+    // Distributed rendering, see above
+    uint16_t    listenPort  = 0;
+    uint32_t    workerNb    = 1;
+    uint32_t    chunkSpp    = 64;
+    float       timeout     = 600.f;
+    std::string coordinator = "";
+};
+
+constexpr uint32_t ProtocolVersion = 3;
+
+// Raw sums, as written by lop::writeRawAccumulation
+constexpr const char* RawExtension = ".acc";
+
+// Sent by a worker once connected, to check that it renders the same sequence. The coordinator has no scene, workers
+// must share the settings hash of the first one.
+struct WorkerHello
+{
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t frameNb;
+    uint32_t seed;
+    uint32_t spp;
+    uint64_t settingsHash;
+};
+
+// Samples [firstSample, firstSample + sampleNb) of a frame. Answered by the worker with the job itself, the scene hash
+// of the frame and the raw RGBA sums of the range, a job without sample ends the worker.
+struct Job
+{
+    uint32_t frame       = 0;
+    uint32_t firstSample = 0;
+    uint32_t sampleNb    = 0;
+};
+
+void addEntity(vzt::View<vzt::Device> device, lop::System& system, std::string name, vzt::Mesh mesh,
+               lop::Transform transform, lop::Material material)
+{
+    entt::handle entity = system.create();
+    entity.emplace<lop::Name>(std::move(name));
+    entity.emplace<lop::Material>(material);
+    entity.emplace<lop::Transform>(transform);
+    auto& newMesh = entity.emplace<vzt::Mesh>(std::move(mesh));
+    entity.emplace<lop::MeshHolder>(device, newMesh);
+}
+
+// Spheres of varying roughness on a ground plane, rendered when no mesh is given
+void populateDefault(vzt::View<vzt::Device> device, lop::System& system)
+{
+    constexpr uint32_t SphereNb = 5;
+    for (uint32_t i = 0; i < SphereNb; i++)
+    {
+        lop::Transform transform{};
+        transform.position = {(static_cast<float>(i) - 2.f) * 1.2f, 0.f, 0.f};
+
+        lop::Material material{};
+        material.baseColor = {.8f, .3f + .1f * static_cast<float>(i), .2f};
+        material.roughness = static_cast<float>(i) / static_cast<float>(SphereNb - 1);
+
+        addEntity(device, system, fmt::format("Sphere{}", i), lop::createSphere(.5f), transform, material);
+    }
+
+    lop::Transform ground{};
+    ground.position = {0.f, 0.f, -.5f};
+    addEntity(device, system, "Ground", lop::createQuad(8.f), ground, {});
+}
+
+bool readKeyframes(const vzt::Path& path, lop::System& system, lop::Sequence& sequence)
+{
+    std::ifstream file{path};
+    if (!file)
+    {
+        vzt::logger::error("Failed to open {}", path.string());
+        return false;
+    }
+
+    std::string line;
+    uint32_t    lineId = 0;
+    while (std::getline(file, line))
+    {
+        lineId++;
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream stream{line};
+        std::string        target;
+        float              time;
+        lop::Transform     transform{};
+        stream >> target >> time >> transform.position.x >> transform.position.y >> transform.position.z;
+        if (!stream)
+        {
+            vzt::logger::error("{}:{}: expected a target, a time and a position", path.string(), lineId);
+            return false;
+        }
+
+        float     angle;
+        vzt::Vec3 axis;
+        if (stream >> angle >> axis.x >> axis.y >> axis.z)
+            transform.rotation = glm::angleAxis(glm::radians(angle), glm::normalize(axis));
+
+        if (target == "camera")
+        {
+            sequence.camera.add(time, transform);
+            continue;
+        }
+
+        entt::entity entity = entt::null;
+        for (const entt::entity candidate : system.registry.view<lop::Name, lop::Transform>())
+        {
+            if (system.registry.get<lop::Name>(candidate).value == target)
+                entity = candidate;
+        }
+
+        if (entity == entt::null)
+        {
+            vzt::logger::error("{}:{}: unknown entity {}", path.string(), lineId, target);
+            return false;
+        }
+
+        system.registry.get_or_emplace<lop::Animation>(entity).track.add(time, transform);
+    }
+
+    return true;
+}
+
+bool populate(vzt::View<vzt::Device> device, const RenderSettings& settings, lop::System& system,
+              lop::Sequence& sequence)
+{
+    if (settings.meshes.empty())
+        populateDefault(device, system);
+
+    for (const vzt::Path& mesh : settings.meshes)
+        addEntity(device, system, mesh.stem().string(), vzt::readObj(mesh), {}, {});
+
+    sequence.frameNb   = settings.frameNb;
+    sequence.frameRate = settings.frameRate;
+    sequence.shutter   = settings.shutter;
+
+    // The scene turns around a root entity: a single node is patched per frame, its children follow through the
+    // hierarchy
+    if (settings.turntable)
+    {
+        std::vector<entt::entity> roots{};
+        for (const entt::entity entity : system.registry.view<lop::Transform>())
+            roots.emplace_back(entity);
+
+        entt::handle turntable = system.create();
+        turntable.emplace<lop::Name>("Turntable");
+        turntable.emplace<lop::Transform>();
+        turntable.emplace<lop::Animation>(lop::TransformTrack::turntable({}, sequence.getDuration()));
+
+        for (const entt::entity entity : roots)
+            system.registry.emplace<lop::Hierarchy>(entity, turntable.entity());
+    }
+
+    return settings.keyframes.empty() || readKeyframes(settings.keyframes, system, sequence);
+}
+
+std::vector<lop::ExrChannel> getChannels(const Image<float>& beauty)
+{
+    std::vector<lop::ExrChannel> channels{};
+    channels.emplace_back(lop::ExrChannel::fromImage("R", beauty, 0));
+    channels.emplace_back(lop::ExrChannel::fromImage("G", beauty, 1));
+    channels.emplace_back(lop::ExrChannel::fromImage("B", beauty, 2));
+    channels.emplace_back(lop::ExrChannel::fromImage("A", beauty, 3));
+    return channels;
+}
+
+// Raw sums are kept for later merges, any other output is written as an OpenEXR average
+vzt::Path getAccumulationPath(const std::string& pattern, uint32_t frame)
+{
+    vzt::Path path = lop::getFramePath(pattern, frame);
+    if (path.extension() != RawExtension)
+        path.replace_extension(".exr");
+
+    return path;
+}
+
+void writeAccumulation(lop::AsyncImageWriter& writer, vzt::Path path, lop::RawAccumulation accumulation)
+{
+    if (path.extension() == RawExtension)
+    {
+        writer.writeRawAccumulation(std::move(path), std::move(accumulation));
+        return;
+    }
+
+    const Image<float> average = accumulation.getAverage();
+    writer.writeExr(std::move(path), average.width, average.height, getChannels(average));
+}
+
+// 64-bit FNV-1a
+uint64_t hashBytes(uint64_t hash, const void* data, std::size_t size)
+{
+    constexpr uint64_t FnvPrime = 0x100000001b3;
+
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (std::size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FnvPrime;
+    }
+
+    return hash;
+}
+
+template <class Type>
+uint64_t hashValue(uint64_t hash, const Type& value)
+{
+    static_assert(std::is_trivially_copyable_v<Type>, "Values are hashed as raw bytes");
+    return hashBytes(hash, &value, sizeof(Type));
+}
+
+// Files are identified by their name and size, their directory may differ between nodes
+uint64_t hashFile(uint64_t hash, const vzt::Path& path)
+{
+    std::error_code error;
+    const std::string name = path.filename().string();
+    const uintmax_t   size = std::filesystem::file_size(path, error);
+
+    hash = hashBytes(hash, name.data(), name.size());
+    return hashValue(hash, error ? uintmax_t(0) : size);
+}
+
+// Scene options of a sequence, besides its samples
+uint64_t hashSettings(const RenderSettings& settings)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    hash          = hashValue(hash, settings.width);
+    hash          = hashValue(hash, settings.height);
+    hash          = hashValue(hash, settings.frameNb);
+    hash          = hashValue(hash, settings.frameRate);
+    hash          = hashValue(hash, settings.shutter);
+    hash          = hashValue(hash, settings.motionSegmentNb);
+    hash          = hashValue(hash, settings.cameraPosition);
+    hash          = hashValue(hash, settings.turntable);
+    hash          = hashFile(hash, settings.environment);
+    hash          = hashFile(hash, settings.keyframes);
+    for (const vzt::Path& mesh : settings.meshes)
+        hash = hashFile(hash, mesh);
+
+    return hash;
+}
+
+// Device data, passes and camera of a sequence, kept across its frames
+class FrameRenderer
+{
+  public:
+    FrameRenderer(vzt::View<vzt::Device> device, const RenderSettings& settings, lop::System& system,
+                  const lop::Sequence& sequence);
+
+    // Moves the animated entities and the camera to the frame, returns the number of patched entities. Untouched
+    // entities keep their instances, structures are only rebuilt when an entity moved.
+    uint32_t setFrame(uint32_t frame);
+
+    // Replaces the accumulation by samples [firstSample, firstSample + sampleNb) of the current frame. submitted is
+    // called once the samples of each submission are traced, the device being idle.
+    void trace(uint32_t firstSample, uint32_t sampleNb, const std::function<void()>& submitted = {});
+
+    // Samples traced since the last call to trace, whose range ends at the next sample to trace
+    lop::RawAccumulation readbackRaw() const;
+    Image<uint8_t>       readbackDisplay();
+
+    // Settings, camera and entities the image of the current frame depends on, besides its samples
+    uint64_t getSceneHash() const;
+
+  private:
+    static constexpr uint32_t FramesPerSubmission = 8;
+
+    vzt::View<vzt::Device> m_device;
+    vzt::View<vzt::Queue>  m_queue;
+    lop::System*           m_system;
+    const lop::Sequence*   m_sequence;
+    lop::Transform         m_cameraStart;
+
+    lop::MeshHandler             m_handler;
+    lop::HardwarePathTracingPass m_pathtracingPass;
+    lop::DenoiserPass            m_denoiserPass;
+    lop::TonemapPass             m_tonemapPass;
+    lop::TonemapSettings         m_tonemapSettings{};
+
+    vzt::Camera                              m_camera{};
+    lop::HardwarePathTracingPass::Properties m_properties;
+    uint64_t                                 m_settingsHash;
+};
+
+FrameRenderer::FrameRenderer(vzt::View<vzt::Device> device, const RenderSettings& settings, lop::System& system,
+                             const lop::Sequence& sequence)
+    : m_device(device), m_queue(device->getQueue(vzt::QueueType::Graphics | vzt::QueueType::Compute)),
+      m_system(&system), m_sequence(&sequence), m_cameraStart{settings.cameraPosition}, m_handler(device, system),
+      m_pathtracingPass(device, FramesPerSubmission, {settings.width, settings.height}, m_handler,
+                        settings.environment.empty() ? lop::Environment::fromFunction(device, lop::proceduralSky)
+                                                     : lop::Environment::fromFile(device, settings.environment)),
+      m_denoiserPass(device, 1, {settings.width, settings.height}, m_pathtracingPass),
+      m_tonemapPass(device, 1, m_pathtracingPass, m_denoiserPass)
+{
+    m_handler.setMotionBlur(settings.shutter > 0.f ? settings.motionSegmentNb : 1);
+
+    // Frames are read back as raw sums, whose merges are exact. The float accumulation only feeds the display image.
+    m_pathtracingPass.setRawAccumulation(true);
+    m_tonemapSettings.outputTransform = lop::OutputTransform::Srgb;
+
+    m_camera.up          = lop::Transform::Up;
+    m_camera.front       = lop::Transform::Front;
+    m_camera.right       = lop::Transform::Right;
+    m_camera.aspectRatio = static_cast<float>(settings.width) / static_cast<float>(settings.height);
+
+    m_properties      = {vzt::Mat4{1.f}, m_camera.getProjectionMatrix(), 0};
+    m_properties.seed = settings.seed;
+
+    m_settingsHash = hashValue(hashSettings(settings), m_handler.getMotionSegmentNb());
+}
+
+uint32_t FrameRenderer::setFrame(uint32_t frame)
+{
+    const uint32_t patchedNb = m_sequence->apply(m_system->registry, frame);
+    if (patchedNb != 0)
+    {
+        m_handler.update();
+        m_pathtracingPass.update();
+    }
+
+    const lop::TransformTrack& track  = m_sequence->camera;
+    const lop::Transform       camera = track.isEmpty() ? m_cameraStart : track.evaluate(m_sequence->getTime(frame));
+    m_properties.view = glm::inverse(m_camera.getViewMatrix(camera.position, camera.rotation));
+
+    return patchedNb;
+}
+
+void FrameRenderer::trace(uint32_t firstSample, uint32_t sampleNb, const std::function<void()>& submitted)
+{
+    m_properties.sampleOffset = firstSample;
+    m_properties.sampleId     = 0;
+    m_properties.maxSample    = sampleNb;
+    while (m_properties.sampleId < sampleNb)
+    {
+        m_queue->oneShot([&](vzt::CommandBuffer& commands) {
+            for (uint32_t i = 0; i < FramesPerSubmission && m_properties.sampleId < sampleNb; i++)
+            {
+                m_pathtracingPass.trace(i, commands, m_properties);
+                m_properties.sampleId++;
+            }
+        });
+
+        if (submitted)
+            submitted();
+    }
+}
+
+lop::RawAccumulation FrameRenderer::readbackRaw() const
+{
+    const Image<uint32_t> low  = lop::readbackUint4(m_device, m_pathtracingPass.getSumLowImage());
+    const Image<uint32_t> high = lop::readbackUint4(m_device, m_pathtracingPass.getSumHighImage());
+    const lop::SampleRange range{m_properties.seed, m_properties.sampleOffset, m_properties.sampleId};
+
+    lop::RawAccumulation accumulation = lop::RawAccumulation::fromWords(low, high, range);
+    accumulation.setSceneHash(getSceneHash());
+    return accumulation;
+}
+
+uint64_t FrameRenderer::getSceneHash() const
+{
+    uint64_t hash = hashValue(m_settingsHash, m_properties.view);
+    hash          = hashValue(hash, m_properties.projection);
+    hash          = hashValue(hash, m_properties.bounces);
+    hash          = hashValue(hash, m_properties.jittering);
+    hash          = hashValue(hash, m_properties.sequence);
+
+    const entt::registry& registry = m_system->registry;
+    for (const entt::entity entity : registry.view<lop::Transform>())
+    {
+        hash = hashValue(hash, entity);
+        hash = hashValue(hash, registry.get<lop::Transform>(entity));
+        if (const auto* motion = registry.try_get<lop::Motion>(entity))
+            hash = hashValue(hash, *motion);
+        if (const auto* material = registry.try_get<lop::Material>(entity))
+            hash = hashValue(hash, *material);
+        if (const auto* hierarchy = registry.try_get<lop::Hierarchy>(entity))
+            hash = hashValue(hash, hierarchy->parent);
+        if (const auto* mesh = registry.try_get<vzt::Mesh>(entity))
+        {
+            hash = hashValue(hash, mesh->vertices.size());
+            hash = hashValue(hash, mesh->indices.size());
+        }
+    }
+
+    return hash;
+}
+
+Image<uint8_t> FrameRenderer::readbackDisplay()
+{
+    m_queue->oneShot([&](vzt::CommandBuffer& commands) {
+        m_tonemapPass.record(0, commands, lop::TonemapPass::Source::Accumulation, m_tonemapSettings);
+    });
+
+    return lop::readbackDisplay(m_device, m_pathtracingPass.getRenderImage());
+}
+
+// Sums of the frame saved by a previous run, when they continue the requested samples of the same scene
+std::optional<lop::RawAccumulation> readCheckpoint(const vzt::Path& path, const RenderSettings& settings,
+                                                   uint64_t sceneHash)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(path, error))
+        return std::nullopt;
+
+    std::optional<lop::RawAccumulation> checkpoint = lop::readRawAccumulation(path);
+    if (!checkpoint)
+    {
+        vzt::logger::warn("Failed to read {}, the frame restarts", path.string());
+        return std::nullopt;
+    }
+
+    const std::vector<lop::SampleRange>& ranges = checkpoint->getRanges();
+    if (checkpoint->getSceneHash() != sceneHash || checkpoint->getWidth() != settings.width ||
+        checkpoint->getHeight() != settings.height || ranges.size() != 1 || ranges[0].seed != settings.seed ||
+        ranges[0].firstSample != settings.firstSample || ranges[0].getEnd() > settings.firstSample + settings.spp)
+    {
+        vzt::logger::warn("{} was saved with another scene, camera or samples, the frame restarts", path.string());
+        return std::nullopt;
+    }
+
+    return checkpoint;
+}
+
+int render(const RenderSettings& settings, FrameRenderer& renderer)
+{
+    const bool            png = vzt::Path(settings.output).extension() == ".png";
+    lop::AsyncImageWriter writer{};
+
+    // The display accumulation of PNG frames can not be restored
+    const bool checkpoints = settings.checkpoint > 0.f && !png;
+    if (settings.checkpoint > 0.f && png)
+        vzt::logger::warn("PNG frames are not checkpointed");
+
+    using Seconds                = std::chrono::duration<float>;
+    const Seconds checkpointStep = Seconds{settings.checkpoint};
+
+    const auto     start      = std::chrono::steady_clock::now();
+    const uint32_t end        = settings.firstSample + settings.spp;
+    uint32_t       renderedNb = 0;
+    for (uint32_t frame = 0; frame < settings.frameNb; frame++)
+    {
+        std::error_code error;
+        const vzt::Path path = png ? lop::getFramePath(settings.output, frame)
+                                   : getAccumulationPath(settings.output, frame);
+        if (settings.resume && std::filesystem::exists(path, error))
+        {
+            fmt::print("Frame {:>4}/{}: already rendered -> {}\n", frame + 1, settings.frameNb, path.string());
+            continue;
+        }
+
+        const auto     frameStart = std::chrono::steady_clock::now();
+        const uint32_t patchedNb  = renderer.setFrame(frame);
+
+        // Samples of a previous run are merged with the ones traced from the next sample of their range on
+        const vzt::Path      checkpointPath = vzt::Path{path}.replace_extension(".checkpoint.acc");
+        lop::RawAccumulation accumulation{settings.width, settings.height};
+        if (checkpoints && settings.resume)
+        {
+            if (std::optional<lop::RawAccumulation> checkpoint =
+                    readCheckpoint(checkpointPath, settings, renderer.getSceneHash()))
+                accumulation = std::move(*checkpoint);
+        }
+
+        const uint32_t resumedNb = accumulation.getSampleNb();
+        const uint32_t first     = settings.firstSample + resumedNb;
+
+        // Sums are read back between submissions, while the device is idle, and written in the background
+        auto       lastCheckpoint = std::chrono::steady_clock::now();
+        const auto checkpoint     = [&] {
+            if (!checkpoints || std::chrono::steady_clock::now() - lastCheckpoint < checkpointStep)
+                return;
+
+            lop::RawAccumulation state = renderer.readbackRaw();
+            state.merge(accumulation);
+            writer.writeRawAccumulation(checkpointPath, std::move(state));
+            lastCheckpoint = std::chrono::steady_clock::now();
+        };
+
+        const auto traceStart = std::chrono::steady_clock::now();
+        if (first < end)
+            renderer.trace(first, end - first, checkpoint);
+        const auto traceEnd = std::chrono::steady_clock::now();
+
+        if (png)
+        {
+            writer.writePng(path, renderer.readbackDisplay());
+        }
+        else
+        {
+            if (first < end)
+                accumulation.merge(renderer.readbackRaw());
+
+            writeAccumulation(writer, path, std::move(accumulation));
+        }
+
+        // The writer works in submission order: the checkpoint is only removed once the frame is written, and is kept
+        // when writing the frame fails
+        if (checkpoints)
+            writer.remove(checkpointPath);
+
+        renderedNb++;
+
+        using Milliseconds          = std::chrono::duration<float, std::milli>;
+        const Milliseconds setup    = traceStart - frameStart;
+        const Milliseconds trace    = traceEnd - traceStart;
+        const Milliseconds readback = std::chrono::steady_clock::now() - traceEnd;
+        fmt::print("Frame {:>4}/{}: {} patched, {} resumed samples, setup {:.1f}ms, trace {:.1f}ms, readback {:.1f}ms "
+                   "-> {}\n",
+                   frame + 1, settings.frameNb, patchedNb, resumedNb, setup.count(), trace.count(), readback.count(),
+                   path.string());
+    }
+
+    writer.wait();
+
+    const Seconds duration = std::chrono::steady_clock::now() - start;
+    fmt::print("{} frames in {:.1f}s, {:.2f}s per frame\n", renderedNb, duration.count(),
+               duration.count() / static_cast<float>(std::max(renderedNb, 1u)));
+
+    return writer.getFailureNb() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int work(const RenderSettings& settings, FrameRenderer& renderer)
+{
+    const std::size_t separator = settings.coordinator.rfind(':');
+    if (separator == std::string::npos)
+    {
+        vzt::logger::error("Expected host:port, got {}", settings.coordinator);
+        return EXIT_FAILURE;
+    }
+
+    const std::string host   = settings.coordinator.substr(0, separator);
+    const auto        port   = static_cast<uint16_t>(std::stoul(settings.coordinator.substr(separator + 1)));
+    lop::Socket       socket = lop::Socket::connect(host, port);
+    const WorkerHello hello{
+        ProtocolVersion, settings.width, settings.height, settings.frameNb, settings.seed, settings.spp,
+        hashSettings(settings),
+    };
+    if (!socket.isValid() || !socket.send(hello))
+    {
+        vzt::logger::error("Failed to connect to {}", settings.coordinator);
+        return EXIT_FAILURE;
+    }
+
+    Job job{};
+    while (socket.receive(job))
+    {
+        if (job.sampleNb == 0)
+            return EXIT_SUCCESS;
+
+        const auto start = std::chrono::steady_clock::now();
+        renderer.setFrame(job.frame);
+        renderer.trace(job.firstSample, job.sampleNb);
+
+        const lop::RawAccumulation   accumulation = renderer.readbackRaw();
+        const std::vector<uint64_t>& sums         = accumulation.getSums();
+        if (!socket.send(job) || !socket.send(accumulation.getSceneHash()) ||
+            !socket.send(sums.data(), sums.size() * sizeof(uint64_t)))
+            break;
+
+        const std::chrono::duration<float, std::milli> duration = std::chrono::steady_clock::now() - start;
+        fmt::print("Frame {:>4}: samples [{}, {}) in {:.1f}ms\n", job.frame + 1, job.firstSample,
+                   job.firstSample + job.sampleNb, duration.count());
+    }
+
+    vzt::logger::error("Lost the connection to {}", settings.coordinator);
+    return EXIT_FAILURE;
+}
+
+int coordinate(const RenderSettings& settings)
+{
+    lop::Listener listener{settings.listenPort};
+    if (!listener.isValid())
+    {
+        vzt::logger::error("Failed to listen on port {}", settings.listenPort);
+        return EXIT_FAILURE;
+    }
+
+    if (vzt::Path(settings.output).extension() == ".png")
+        vzt::logger::warn("Distributed frames are written as OpenEXR");
+
+    // Frames are split in order, so that they complete one after the other and only a few are merged at once
+    std::deque<Job> jobs{};
+    const uint32_t  chunkSpp = std::max(settings.chunkSpp, 1u);
+    const uint32_t  end      = settings.firstSample + settings.spp;
+    for (uint32_t frame = 0; frame < settings.frameNb; frame++)
+    {
+        for (uint32_t first = settings.firstSample; first < end; first += chunkSpp)
+            jobs.emplace_back(Job{frame, first, std::min(chunkSpp, end - first)});
+    }
+
+    std::mutex                                          mutex;
+    std::condition_variable                             available;
+    uint32_t                                            runningNb = 0;
+    std::optional<uint64_t>                             settingsHash{}; // Of the first worker
+    std::unordered_map<uint32_t, lop::RawAccumulation> accumulations{};
+    lop::AsyncImageWriter                               writer{};
+
+    const std::size_t pixelNb = std::size_t(settings.width) * settings.height * 4;
+
+    const auto serve = [&](lop::Socket socket, uint32_t workerId) {
+        // A worker that hangs with its connection open would otherwise keep its job forever
+        socket.setTimeout(settings.timeout);
+
+        WorkerHello hello{};
+        if (!socket.receive(hello) || hello.version != ProtocolVersion || hello.width != settings.width ||
+            hello.height != settings.height || hello.frameNb != settings.frameNb || hello.seed != settings.seed ||
+            hello.spp != settings.spp)
+        {
+            vzt::logger::error("Worker {} does not render the same sequence", workerId);
+            return;
+        }
+
+        {
+            std::lock_guard lock{mutex};
+            if (!settingsHash)
+                settingsHash = hello.settingsHash;
+
+            if (*settingsHash != hello.settingsHash)
+            {
+                vzt::logger::error("Worker {} does not render the same scene as the first one", workerId);
+                return;
+            }
+        }
+
+        std::vector<uint64_t> sums(pixelNb);
+        while (true)
+        {
+            Job job{};
+            {
+                // Jobs of a lost worker are handed back, the queue is only final once no job is running
+                std::unique_lock lock{mutex};
+                available.wait(lock, [&] { return !jobs.empty() || runningNb == 0; });
+                if (jobs.empty())
+                    break;
+
+                job = jobs.front();
+                jobs.pop_front();
+                runningNb++;
+            }
+
+            Job        answer{};
+            uint64_t   sceneHash = 0;
+            const bool done      = socket.send(job) && socket.receive(answer) && answer.frame == job.frame &&
+                                   answer.firstSample == job.firstSample && answer.sampleNb == job.sampleNb &&
+                                   socket.receive(sceneHash) &&
+                                   socket.receive(sums.data(), sums.size() * sizeof(uint64_t));
+
+            // Sums are copied out of the lock, their buffer is reused by the next job
+            std::optional<lop::RawAccumulation> received{};
+            if (done)
+            {
+                const lop::SampleRange range{settings.seed, job.firstSample, job.sampleNb};
+                received.emplace(settings.width, settings.height, range, sums);
+                received->setSceneHash(sceneHash);
+            }
+
+            // Complete frames are written once the lock is released, the writer may block while its queue is full
+            std::optional<lop::RawAccumulation> finished{};
+            {
+                std::lock_guard lock{mutex};
+                runningNb--;
+                available.notify_all();
+                if (!done)
+                {
+                    vzt::logger::error("Lost worker {}, its samples are handed to the others", workerId);
+                    jobs.emplace_front(job);
+                    return;
+                }
+
+                // Jobs never share samples, a merge only fails when the frame was rendered from another scene
+                auto& accumulation =
+                    accumulations.try_emplace(job.frame, settings.width, settings.height).first->second;
+                if (!accumulation.merge(*received))
+                {
+                    vzt::logger::error("Worker {} rendered frame {} from another scene, its samples are handed back",
+                                       workerId, job.frame + 1);
+                    jobs.emplace_front(job);
+                    return;
+                }
+
+                if (accumulation.getSampleNb() == settings.spp)
+                {
+                    finished = std::move(accumulation);
+                    accumulations.erase(job.frame);
+                }
+            }
+
+            if (finished)
+            {
+                const vzt::Path path = getAccumulationPath(settings.output, job.frame);
+                writeAccumulation(writer, path, std::move(*finished));
+
+                fmt::print("Frame {:>4}/{} -> {}\n", job.frame + 1, settings.frameNb, path.string());
+            }
+        }
+
+        socket.send(Job{});
+    };
+
+    fmt::print("Waiting for {} workers on port {}\n", settings.workerNb, settings.listenPort);
+
+    // Connected workers start rendering while the others are awaited. Once the deadline passed, only the pending
+    // connections are accepted.
+    using Seconds = std::chrono::duration<float>;
+
+    const auto               start    = std::chrono::steady_clock::now();
+    const auto               deadline = start + Seconds{settings.timeout};
+    std::vector<std::thread> workers{};
+    for (uint32_t i = 0; i < settings.workerNb; i++)
+    {
+        const Seconds remaining = deadline - std::chrono::steady_clock::now();
+        const float   timeout   = settings.timeout > 0.f ? std::max(remaining.count(), 1e-3f) : 0.f;
+
+        lop::Socket socket = listener.accept(timeout);
+        if (!socket.isValid())
+        {
+            vzt::logger::warn("{} of {} workers connected", workers.size(), settings.workerNb);
+            break;
+        }
+
+        workers.emplace_back(serve, std::move(socket), i);
+    }
+
+    if (workers.empty())
+    {
+        vzt::logger::error("No worker connected within {}s", settings.timeout);
+        return EXIT_FAILURE;
+    }
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    writer.wait();
+
+    const Seconds duration = std::chrono::steady_clock::now() - start;
+    fmt::print("{} frames in {:.1f}s with {} workers\n", writer.getWrittenNb(), duration.count(), workers.size());
+
+    if (!jobs.empty())
+    {
+        vzt::logger::error("{} sample ranges were not rendered", jobs.size());
+        return EXIT_FAILURE;
+    }
+
+    return writer.getFailureNb() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int merge(const RenderSettings& settings)
+{
+    if (vzt::Path(settings.output).extension() == ".png")
+        vzt::logger::warn("Merged frames are written as OpenEXR");
+
+    lop::AsyncImageWriter writer{};
+    uint32_t              failureNb = 0;
+    for (uint32_t frame = 0; frame < settings.frameNb; frame++)
+    {
+        lop::RawAccumulation accumulation{};
+        bool                 complete = true;
+        for (std::size_t i = 0; i < settings.merged.size() && complete; i++)
+        {
+            const vzt::Path                     path    = lop::getFramePath(settings.merged[i], frame);
+            std::optional<lop::RawAccumulation> partial = lop::readRawAccumulation(path);
+            if (!partial)
+            {
+                vzt::logger::error("Failed to read {}", path.string());
+                complete = false;
+            }
+            else if (i == 0)
+            {
+                accumulation = std::move(*partial);
+            }
+            else if (!accumulation.merge(*partial))
+            {
+                vzt::logger::error("{} differs in size or shares samples with the previous files", path.string());
+                complete = false;
+            }
+        }
+
+        if (!complete)
+        {
+            failureNb++;
+            continue;
+        }
+
+        const uint32_t  sampleNb = accumulation.getSampleNb();
+        const vzt::Path path     = getAccumulationPath(settings.output, frame);
+        writeAccumulation(writer, path, std::move(accumulation));
+        fmt::print("Frame {:>4}/{}: {} samples -> {}\n", frame + 1, settings.frameNb, sampleNb, path.string());
+    }
+
+    writer.wait();
+    return failureNb == 0 && writer.getFailureNb() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char** argv)
+{
+    RenderSettings settings{};
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+        const bool             hasValue = i + 1 < argc;
+        if (argument == "--width" && hasValue)
+            settings.width = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--height" && hasValue)
+            settings.height = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--spp" && hasValue)
+            settings.spp = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--frames" && hasValue)
+            settings.frameNb = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--fps" && hasValue)
+            settings.frameRate = std::stof(argv[++i]);
+        else if (argument == "--shutter" && hasValue)
+            settings.shutter = std::stof(argv[++i]);
+        else if (argument == "--motion-segments" && hasValue)
+            settings.motionSegmentNb = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--mesh" && hasValue)
+            settings.meshes.emplace_back(argv[++i]);
+        else if (argument == "--environment" && hasValue)
+            settings.environment = argv[++i];
+        else if (argument == "--camera" && i + 3 < argc)
+        {
+            settings.cameraPosition.x = std::stof(argv[++i]);
+            settings.cameraPosition.y = std::stof(argv[++i]);
+            settings.cameraPosition.z = std::stof(argv[++i]);
+        }
+        else if (argument == "--keyframes" && hasValue)
+            settings.keyframes = argv[++i];
+        else if (argument == "--turntable")
+            settings.turntable = true;
+        else if (argument == "--seed" && hasValue)
+            settings.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--samples" && hasValue)
+        {
+            const std::string range     = argv[++i];
+            const std::size_t separator = range.find(':');
+            if (separator == std::string::npos)
+            {
+                vzt::logger::warn("Expected first:end, got {}", range);
+                continue;
+            }
+
+            const auto end       = static_cast<uint32_t>(std::stoul(range.substr(separator + 1)));
+            settings.firstSample = static_cast<uint32_t>(std::stoul(range.substr(0, separator)));
+            settings.spp         = end > settings.firstSample ? end - settings.firstSample : 0;
+        }
+        else if (argument == "--checkpoint" && hasValue)
+            settings.checkpoint = std::stof(argv[++i]);
+        else if (argument == "--resume")
+            settings.resume = true;
+        else if (argument == "--merge" && hasValue)
+            settings.merged.emplace_back(argv[++i]);
+        else if (argument == "--output" && hasValue)
+            settings.output = argv[++i];
+        else if (argument == "--listen" && hasValue)
+            settings.listenPort = static_cast<uint16_t>(std::stoul(argv[++i]));
+        else if (argument == "--workers" && hasValue)
+            settings.workerNb = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--chunk" && hasValue)
+            settings.chunkSpp = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else if (argument == "--timeout" && hasValue)
+            settings.timeout = std::stof(argv[++i]);
+        else if (argument == "--connect" && hasValue)
+            settings.coordinator = argv[++i];
+        else
+            vzt::logger::warn("Unknown argument {}", argument);
+    }
+
+    if (!settings.merged.empty())
+        return merge(settings);
+    if (settings.listenPort != 0)
+        return coordinate(settings);
+
+    auto instance = vzt::Instance{};
+    auto device   = instance.getDevice(vzt::DeviceBuilder::rt());
+
+    lop::System   system{};
+    lop::Sequence sequence{};
+    if (!populate(device, settings, system, sequence))
+        return EXIT_FAILURE;
+
+    FrameRenderer renderer{device, settings, system, sequence};
+    if (!settings.coordinator.empty())
+        return work(settings, renderer);
+
+    return render(settings, renderer);
+}